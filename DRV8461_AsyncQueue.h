@@ -0,0 +1,208 @@
+#ifndef DRV8461_ASYNCQUEUE_H
+#define DRV8461_ASYNCQUEUE_H
+
+/*  DRV8461_AsyncQueue.h
+
+    Fixed-capacity, allocation-free queue of register accesses that are
+    carried out later, away from the code that requested them.
+
+*/
+#pragma once
+
+#include <atomic>
+
+#include "DRV8461_Registers.h"
+
+
+/// A handle that can be polled for the outcome of a queued register access.
+/// The caller owns it and must keep it alive until complete() returns true.
+struct DRV8461AsyncResult
+{
+  /// Returns true once the access has been carried out.
+  bool complete() const
+  {
+    return done.load(std::memory_order_acquire);
+  }
+
+  /// The status byte of the frame.  Valid once complete() is true.
+  uint8_t status = 0;
+
+  /// The register contents (read) or old contents (write).  Valid once
+  /// complete() is true.
+  uint8_t data = 0;
+
+  std::atomic<bool> done{false};
+};
+
+/// Called when a queued access has been carried out, with the context pointer
+/// given at submission and the frame's result.
+typedef void (*DRV8461AsyncCallback)(void * context, const DRV8461RegResult & result);
+
+
+/// This class queues register reads and writes for a BasicDRV8434SSPI so the
+/// code that needs them does not wait for the bus.  submitRead() and
+/// submitWrite() only copy a descriptor into a ring buffer, so they take the
+/// same short time however many requests are already waiting.
+///
+/// The queue is drained by calling service(), typically from a timer or
+/// SPI-ready interrupt, or from an RTOS task.  Each call sends up to
+/// `BatchSize` queued accesses with one BasicDRV8434SSPI::transferBatch(),
+/// then fills in the result handles and runs the callbacks.
+///
+/// The queue has a single producer and a single consumer: submissions must
+/// all come from one context (for example the main loop) and service() from
+/// another (for example an interrupt).  Nothing is allocated, and the indices
+/// are lock-free atomics, so both sides are safe in an interrupt.
+///
+/// Once service() runs in an interrupt or another task, it can start a
+/// transfer in the middle of one made directly by the main loop (a DRV8434S
+/// setter, readReg(), or another device on the same SPI bus), which would
+/// garble both.  Either make every access to the bus through the queue, or
+/// bracket the direct ones with lockBus() and unlockBus(): while the bus is
+/// locked, service() leaves the queue alone and returns 0, and the accesses
+/// go out on a later call.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461AsyncQueue<DRV8434SSPI, 16> queue(sd.driver);
+/// DRV8461AsyncResult fault;
+/// queue.submitRead(DRV8461_REG_ADDR::DRV8461_REG_FAULT, &fault);
+/// // ... later, in the timer interrupt:
+/// queue.service();
+/// // ... later, in the main loop:
+/// if (fault.complete() && fault.data) { /* handle fault */ }
+/// queue.lockBus();
+/// sd.setStepMode(16);   // a direct access, safe from service()
+/// queue.unlockBus();
+/// ~~~
+template <class Driver, uint8_t Capacity, uint8_t BatchSize = 8>
+class DRV8461AsyncQueue
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+  static_assert(BatchSize >= 1, "batch size must be at least 1");
+
+public:
+  explicit DRV8461AsyncQueue(Driver & driver) : driver(driver)
+  {
+  }
+
+  /// Queues a read of the given register.  `result` (if not null) is marked
+  /// complete and `callback` (if not null) is called once it has been read.
+  ///
+  /// @return false if the queue is full.
+  bool submitRead(DRV8461_REG_ADDR address, DRV8461AsyncResult * result = nullptr,
+    DRV8461AsyncCallback callback = nullptr, void * context = nullptr)
+  {
+    return submit(DRV8461RegOp::read(address), result, callback, context);
+  }
+
+  /// Queues a write of the given register.
+  ///
+  /// @return false if the queue is full.
+  bool submitWrite(DRV8461_REG_ADDR address, uint8_t value, DRV8461AsyncResult * result = nullptr,
+    DRV8461AsyncCallback callback = nullptr, void * context = nullptr)
+  {
+    return submit(DRV8461RegOp::write(address, value), result, callback, context);
+  }
+
+  /// Carries out up to `BatchSize` queued accesses in one bus transaction.
+  ///
+  /// The callbacks run with the bus locked, so they must not call lockBus().
+  ///
+  /// @return The number of accesses carried out: 0 if there were none, or
+  /// if the bus is locked (see lockBus()).
+  uint8_t service()
+  {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    uint8_t h = head.load(std::memory_order_acquire);
+    uint8_t n = (uint8_t)(h - t);
+    if (n > BatchSize) { n = BatchSize; }
+    if (n == 0) { return 0; }
+    if (busLocked.exchange(true, std::memory_order_acquire)) { return 0; }
+
+    DRV8461RegOp ops[BatchSize];
+    DRV8461RegResult results[BatchSize];
+    for (uint8_t i = 0; i < n; i++)
+    {
+      ops[i] = entries[(uint8_t)(t + i) & (Capacity - 1)].op;
+    }
+    driver.transferBatch(ops, n, results);
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+      Entry & e = entries[(uint8_t)(t + i) & (Capacity - 1)];
+      if (e.result)
+      {
+        e.result->status = results[i].status;
+        e.result->data = results[i].data;
+        e.result->done.store(true, std::memory_order_release);
+      }
+      if (e.callback) { e.callback(e.context, results[i]); }
+    }
+
+    tail.store((uint8_t)(t + n), std::memory_order_release);
+    busLocked.store(false, std::memory_order_release);
+    return n;
+  }
+
+  /// Keeps service() off the bus until unlockBus(), so the caller can access
+  /// it directly.  If service() is running on another core or task, this
+  /// waits for it to finish; when service() runs in an interrupt on the same
+  /// core, it never has to wait.
+  void lockBus()
+  {
+    while (busLocked.exchange(true, std::memory_order_acquire)) {}
+  }
+
+  /// Lets service() use the bus again.
+  void unlockBus()
+  {
+    busLocked.store(false, std::memory_order_release);
+  }
+
+  /// Returns the number of accesses waiting.
+  uint8_t pending() const
+  {
+    return (uint8_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+
+  /// Returns true if no more accesses can be queued.
+  bool full() const
+  {
+    return pending() >= Capacity;
+  }
+
+private:
+
+  struct Entry
+  {
+    DRV8461RegOp op;
+    DRV8461AsyncResult * result;
+    DRV8461AsyncCallback callback;
+    void * context;
+  };
+
+  bool submit(DRV8461RegOp op, DRV8461AsyncResult * result, DRV8461AsyncCallback callback, void * context)
+  {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    if ((uint8_t)(h - tail.load(std::memory_order_acquire)) >= Capacity) { return false; }
+
+    if (result) { result->done.store(false, std::memory_order_relaxed); }
+    entries[h & (Capacity - 1)] = { op, result, callback, context };
+    head.store((uint8_t)(h + 1), std::memory_order_release);
+    return true;
+  }
+
+  Driver & driver;
+  Entry entries[Capacity];
+
+  // Free-running indices; the difference is the number of queued entries.
+  std::atomic<uint8_t> head{0};
+  std::atomic<uint8_t> tail{0};
+
+  // Set while service() or the holder of lockBus() is using the bus.
+  std::atomic<bool> busLocked{false};
+};
+
+
+#endif                                    // #ifndef DRV8461_ASYNCQUEUE_H
@@ -0,0 +1,598 @@
+#ifndef DRV8461_BENCHMARK_H
+#define DRV8461_BENCHMARK_H
+
+/*  DRV8461_Benchmark.h
+
+    Measuring the CPU and SPI bus cost of driver operations against
+    DRV8461SimBus, on Linux.
+
+*/
+#pragma once
+
+#if defined(__linux__)
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#include "DRV8461_Instrumentation.h"
+#include "DRV8461_MultiAxis.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_SpiDev.h"
+#include "DRV8461_StepEngine.h"
+#include "DRV8461_Telemetry.h"
+
+
+/// The cost of one benchmarked operation, averaged over its iterations.
+struct DRV8461BenchResult
+{
+  const char * name;
+  uint32_t iterations;
+
+  /// CPU time per operation in nanoseconds, including the emulated device.
+  double cpuTime;
+
+  /// SPI transfer() calls, chip select pulses (frames) and bytes per
+  /// operation.
+  double transactions;
+  double frames;
+  double bytes;
+
+  /// Bus time per operation in nanoseconds, as modelled by DRV8461SimBus at
+  /// `clockHz`.
+  double busTime;
+  uint32_t clockHz;
+};
+
+/// A figure measured by a benchmark that is not the cost of one bus
+/// operation, such as a step rate or a timing error.
+struct DRV8461BenchMetric
+{
+  const char * name;
+  double value;
+  const char * unit;
+};
+
+
+/// This class runs operations on a driver whose bus is a DRV8461SimBus and
+/// records what each one costs: CPU time, and what it asked of the SPI bus.
+///
+/// write() prints a JSON document with one result per line, so the output of
+/// two builds can be compared with a JSON tool or a line-oriented one; print()
+/// prints a table for people.  Figures other than bus costs are recorded with
+/// metric().  DRV8461_benchmarkDriver() runs the driver's common operations,
+/// DRV8461_benchmarkSpiDev() the same on the spidev backend,
+/// DRV8461_benchmarkFields() the typed field accessors,
+/// DRV8461_benchmarkStepEngine() the step engine,
+/// DRV8461_benchmarkMultiAxis() coordinated motion,
+/// DRV8461_benchmarkWavetable() the wavetable generators and
+/// DRV8461_benchmarkTelemetry() the telemetry recorder;
+/// bench/DRV8461_bench.cpp is the benchmark program.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461Benchmark bench;
+/// DRV8461_benchmarkDriver(bench, 100000);
+/// bench.print(stderr);
+/// bench.write(stdout);
+/// ~~~
+class DRV8461Benchmark
+{
+public:
+  /// The most results one benchmark holds.
+  static const uint8_t capacity = 64;
+
+  /// Calls `op` `iterations` times and records its cost as `name`.  `bus`
+  /// must be the bus `op` talks to.
+  ///
+  /// @return The result, or nullptr if the results are full.
+  template <class Op>
+  const DRV8461BenchResult * run(const char * name, DRV8461SimBus & bus, uint32_t iterations, Op op)
+  {
+    if (count == capacity || iterations == 0) { return nullptr; }
+
+    uint32_t transactions = bus.transactions, frames = bus.frames, bytes = bus.bytes;
+    uint64_t busTime = bus.busTime;
+    uint64_t start = now();
+    for (uint32_t i = 0; i < iterations; i++) { op(); }
+    uint64_t elapsed = now() - start;
+
+    DRV8461BenchResult & r = results[count++];
+    r.name = name;
+    r.iterations = iterations;
+    r.cpuTime = (double)elapsed / iterations;
+    r.transactions = (double)(bus.transactions - transactions) / iterations;
+    r.frames = (double)(bus.frames - frames) / iterations;
+    r.bytes = (double)(bus.bytes - bytes) / iterations;
+    r.busTime = (double)(bus.busTime - busTime) / iterations;
+    r.clockHz = bus.clockHz;
+    return &r;
+  }
+
+  /// Records a metric.
+  ///
+  /// @return false if the metrics are full.
+  bool metric(const char * name, double value, const char * unit)
+  {
+    if (metricCount == capacity) { return false; }
+    metrics[metricCount++] = { name, value, unit };
+    return true;
+  }
+
+  /// Returns the number of results recorded.
+  uint8_t size() const
+  {
+    return count;
+  }
+
+  /// Returns a recorded result.
+  const DRV8461BenchResult & operator[](uint8_t i) const
+  {
+    return results[i];
+  }
+
+  /// Writes the results as a JSON document, one result per line.
+  void write(FILE * out) const
+  {
+    fprintf(out, "{\"results\":[\n");
+    for (uint8_t i = 0; i < count; i++)
+    {
+      const DRV8461BenchResult & r = results[i];
+      fprintf(out, "{\"name\":\"%s\",\"iterations\":%u,\"cpu_ns\":%.1f,\"transactions\":%.2f,"
+        "\"cs_toggles\":%.2f,\"bytes\":%.2f,\"bus_ns\":%.0f,\"clock_hz\":%u}%s\n",
+        r.name, r.iterations, r.cpuTime, r.transactions, r.frames, r.bytes, r.busTime, r.clockHz,
+        i + 1 < count ? "," : "");
+    }
+    fprintf(out, "],\"metrics\":[\n");
+    for (uint8_t i = 0; i < metricCount; i++)
+    {
+      const DRV8461BenchMetric & m = metrics[i];
+      fprintf(out, "{\"name\":\"%s\",\"value\":%.6g,\"unit\":\"%s\"}%s\n",
+        m.name, m.value, m.unit, i + 1 < metricCount ? "," : "");
+    }
+    fprintf(out, "]}\n");
+  }
+
+  /// Writes the results as a table.
+  void print(FILE * out) const
+  {
+    fprintf(out, "%-24s %10s %8s %8s %8s %10s\n", "operation", "cpu ns", "xfers", "cs", "bytes", "bus ns");
+    for (uint8_t i = 0; i < count; i++)
+    {
+      const DRV8461BenchResult & r = results[i];
+      fprintf(out, "%-24s %10.1f %8.2f %8.2f %8.2f %10.0f\n",
+        r.name, r.cpuTime, r.transactions, r.frames, r.bytes, r.busTime);
+    }
+    if (metricCount) { fprintf(out, "\n%-32s %14s %s\n", "metric", "value", "unit"); }
+    for (uint8_t i = 0; i < metricCount; i++)
+    {
+      fprintf(out, "%-32s %14.6g %s\n", metrics[i].name, metrics[i].value, metrics[i].unit);
+    }
+  }
+
+  /// Returns the monotonic time in nanoseconds.
+  static uint64_t now()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
+private:
+
+  DRV8461BenchResult results[capacity];
+  uint8_t count = 0;
+  DRV8461BenchMetric metrics[capacity];
+  uint8_t metricCount = 0;
+};
+
+
+/// Benchmarks the common operations of BasicDRV8434S on a fresh emulated
+/// driver, `iterations` times each, at the given SPI clock.
+inline void DRV8461_benchmarkDriver(DRV8461Benchmark & bench, uint32_t iterations, uint32_t clockHz = 5000000)
+{
+  BasicDRV8434S<DRV8461SimBus> sd;
+  DRV8461SimBus & bus = sd.driver.bus;
+  bus.setClock(clockHz);
+  DRV8461DriverStatus status;
+  volatile uint8_t sink = 0;
+  bool toggle = false;
+
+  bench.run("applySettings", bus, iterations, [&] { sd.applySettings(); });
+  bench.run("restoreSettings", bus, iterations, [&] { sd.restoreSettings(); });
+  bench.run("restoreSettings/1 lost", bus, iterations, [&] {
+    bus.corrupt(1);
+    sd.restoreSettings();
+  });
+  bench.run("applySettings/1 lost", bus, iterations, [&] {
+    bus.corrupt(1);
+    sd.applySettings();
+  });
+  bench.run("verifySettings", bus, iterations, [&] { sink = sink + sd.verifySettings(); });
+  bench.run("setStepMode", bus, iterations, [&] {
+    sd.setStepMode((toggle = !toggle) ? 32 : 16);
+  });
+  bench.run("setCurrentMilliamps", bus, iterations, [&] {
+    sd.setCurrentMilliamps((toggle = !toggle) ? 1200 : 800, 1500);
+  });
+  bench.run("step", bus, iterations, [&] { sd.step(); });
+  bench.run("readFault", bus, iterations, [&] { sink = sink + sd.readFault(); });
+  bench.run("readStatus", bus, iterations, [&] { sd.readStatus(status, 0); });
+  bench.run("transaction", bus, iterations, [&] {
+    sd.beginTransaction();
+    sd.setStepMode((toggle = !toggle) ? 32 : 16);
+    sd.setCurrentPercent(toggle ? 60 : 40);
+    sd.setDecayMode(DRV8461_Decay_Mode::DRV8461_DECAY_SMART_RIPPLE);
+    sd.commit();
+  });
+  bench.run("setWavetable", bus, iterations, [&] {
+    sd.setWavetable((toggle = !toggle) ? DRV8461_sineWavetable() : DRV8461_harmonicWavetable(8, 0));
+  });
+
+  // The cost of DRV8461BusStats over DRV8461NoStats, per transfer and per
+  // frame: the same operations on a driver that keeps statistics.
+  BasicDRV8434S<DRV8461SimBus, DRV8461BusStats<DRV8461SteadyClock>> counted;
+  DRV8461SimBus & countedBus = counted.driver.bus;
+  countedBus.setClock(clockHz);
+  const DRV8461BenchResult * plainRead = bench.run("readFault/NoStats", bus, iterations, [&] {
+    sink = sink + sd.readFault();
+  });
+  const DRV8461BenchResult * countedRead = bench.run("readFault/BusStats", countedBus, iterations, [&] {
+    sink = sink + counted.readFault();
+  });
+  const DRV8461BenchResult * plainApply = bench.run("applySettings/NoStats", bus, iterations, [&] {
+    sd.applySettings();
+  });
+  const DRV8461BenchResult * countedApply = bench.run("applySettings/BusStats", countedBus, iterations, [&] {
+    counted.applySettings();
+  });
+  if (plainRead && countedRead && plainApply && countedApply && plainApply->frames > 1)
+  {
+    // A one-frame transfer gives the fixed cost; the extra frames of a batch
+    // give the cost of each further frame.
+    double perTransfer = countedRead->cpuTime - plainRead->cpuTime;
+    bench.metric("BusStats cost per transfer", perTransfer, "ns");
+    bench.metric("BusStats cost per frame",
+      (countedApply->cpuTime - plainApply->cpuTime - perTransfer) / (plainApply->frames - 1), "ns");
+  }
+}
+
+
+/// Benchmarks the spidev backend (BasicDRV8461SpiDevBus) on its in-process
+/// loopback, `iterations` times each: the CPU cost of packing frames into
+/// spi_ioc_transfers, and the number of ioctls each operation makes.  The
+/// emulated device sees one transfer() call per chip select pulse, so its
+/// transactions and frames columns are equal here.
+inline void DRV8461_benchmarkSpiDev(DRV8461Benchmark & bench, uint32_t iterations, uint32_t clockHz = 5000000)
+{
+  BasicDRV8434S<BasicDRV8461SpiDevBus<DRV8461SpiDevLoopback>> sd;
+  DRV8461SpiDevLoopback & io = sd.driver.bus.io;
+  io.device.setClock(clockHz);
+  volatile uint8_t sink = 0;
+
+  uint32_t messages = io.messages;
+  bench.run("spidev/applySettings", io.device, iterations, [&] { sd.applySettings(); });
+  bench.metric("spidev/applySettings ioctls", (double)(io.messages - messages) / iterations, "ioctls");
+  bench.run("spidev/verifySettings", io.device, iterations, [&] { sink = sink + sd.verifySettings(); });
+  bench.run("spidev/readFault", io.device, iterations, [&] { sink = sink + sd.readFault(); });
+}
+
+/// Benchmarks the typed field accessors of DRV8461_Field.h against the
+/// hand-written masking code they replace, `iterations` times each.  The
+/// values come from a volatile buffer so neither side can be folded away;
+/// the typed and hand-written times of each pair should be the same.
+inline void DRV8461_benchmarkFields(DRV8461Benchmark & bench, uint32_t iterations)
+{
+  typedef DRV8461Fields::TOFF TOFF;
+  typedef DRV8461Fields::STALL_TH STALL_TH;
+  const uint8_t ctrl1 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1;
+  const uint8_t ctrl5 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL5;
+  const uint8_t ctrl6 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL6;
+  const uint8_t toffMask = (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL1_TOFF;
+  const uint8_t stallHighMask = (uint8_t)DRV8461_CTRL6_Reg_Val::DRV8461_CTRL6_STL_REP;
+
+  volatile uint8_t input[16];
+  for (uint8_t i = 0; i < 16; i++) { input[i] = (uint8_t)(i * 37); }
+  uint8_t regs[DRV8461_REG_ADDR_COUNT] = {};
+  uint32_t sum = 0;
+
+  auto time = [&](const char * name, auto op) {
+    uint64_t start = DRV8461Benchmark::now();
+    for (uint32_t i = 0; i < iterations; i++) { op(input[i & 15]); }
+    bench.metric(name, (double)(DRV8461Benchmark::now() - start) / iterations, "ns");
+  };
+
+  time("fields/set_typed", [&](uint8_t v) {
+    TOFF::set(regs, (DRV8461_PWM_TOFF)(v & 3));
+    sum += regs[ctrl1];
+  });
+  time("fields/set_hand", [&](uint8_t v) {
+    regs[ctrl1] = (uint8_t)((regs[ctrl1] & ~toffMask) | (((v & 3) << 3) & toffMask));
+    sum += regs[ctrl1];
+  });
+  time("fields/get_typed", [&](uint8_t v) {
+    regs[ctrl1] = v;
+    sum += (uint8_t)TOFF::get(regs);
+  });
+  time("fields/get_hand", [&](uint8_t v) {
+    regs[ctrl1] = v;
+    sum += (uint8_t)((regs[ctrl1] & toffMask) >> 3);
+  });
+  time("fields/modify_typed", [&](uint8_t v) {
+    uint8_t raw = v;
+    TOFF::modify(raw, (DRV8461_PWM_TOFF)(v >> 6));
+    sum += raw;
+  });
+  time("fields/modify_hand", [&](uint8_t v) {
+    uint8_t raw = v;
+    raw = (uint8_t)((raw & ~toffMask) | (((v >> 6) << 3) & toffMask));
+    sum += raw;
+  });
+  time("fields/wide_set_typed", [&](uint8_t v) {
+    STALL_TH::set(regs, (uint16_t)(v * 13));
+    sum += regs[ctrl5] + regs[ctrl6];
+  });
+  time("fields/wide_set_hand", [&](uint8_t v) {
+    uint16_t value = (uint16_t)(v * 13);
+    regs[ctrl5] = (uint8_t)value;
+    regs[ctrl6] = (uint8_t)((regs[ctrl6] & ~stallHighMask) | ((value >> 8) & stallHighMask));
+    sum += regs[ctrl5] + regs[ctrl6];
+  });
+
+  volatile uint32_t sink = sum;
+  (void)sink;
+}
+
+
+/// Benchmarks DRV8461StepEngine on a simulated timer running at `timerHz`:
+/// a trapezoidal move of `steps` steps is generated and timed.
+///
+/// It records the CPU time per step and the step rate that makes sustainable
+/// (stepEngine/steps_per_s), and how far each step interval is from the
+/// exact profile: the largest and RMS errors in timer ticks, and the largest
+/// as a fraction of the exact interval.
+inline void DRV8461_benchmarkStepEngine(DRV8461Benchmark & bench, uint32_t steps, uint32_t timerHz = 72000000)
+{
+  const uint32_t maxSpeed = 50000, acceleration = 100000;
+  DRV8461SimStepHal hal;
+  DRV8461StepEngine<DRV8461SimStepHal> engine(hal, timerHz);
+
+  // CPU cost per step.
+  engine.plan(steps, maxSpeed, acceleration);
+  uint64_t start = DRV8461Benchmark::now();
+  engine.start();
+  hal.run(engine);
+  double cpuTime = (double)(DRV8461Benchmark::now() - start) / steps;
+  bench.metric("stepEngine/cpu_ns_per_step", cpuTime, "ns");
+  bench.metric("stepEngine/steps_per_s", 1e9 / cpuTime, "steps/s");
+
+  // Interval errors against the exact trapezoid: step i of the ramp is at
+  // sqrt(2 i / a).
+  struct Timing
+  {
+    uint64_t last;
+    uint32_t index;
+    uint32_t count;
+    uint32_t rampSteps;
+    uint32_t cruiseSteps;
+    double maxSpeed;
+    double acceleration;
+    double timerHz;
+    double maxError;
+    double maxRelative;
+    double sumSquares;
+  } timing = {};
+  uint32_t rampSteps = (uint32_t)((double)maxSpeed * maxSpeed / acceleration / 2);
+  timing.count = steps;
+  timing.rampSteps = rampSteps < (steps - 1) / 2 ? rampSteps : (steps - 1) / 2;
+  timing.cruiseSteps = steps - 1 - 2 * timing.rampSteps;
+  timing.maxSpeed = maxSpeed;
+  timing.acceleration = acceleration;
+  timing.timerHz = timerHz;
+
+  hal.stepContext = &timing;
+  hal.stepCallback = [](void * context, uint64_t time) {
+    Timing & t = *static_cast<Timing *>(context);
+    if (t.index > 0)
+    {
+      uint32_t gap = t.index - 1;
+      uint32_t i = gap < t.rampSteps ? gap :
+        gap < t.rampSteps + t.cruiseSteps ? UINT32_MAX : t.count - 2 - gap;
+      double exact = t.timerHz * (i == UINT32_MAX ? 1.0 / t.maxSpeed :
+        sqrt(2.0 / t.acceleration) * (sqrt(i + 1.0) - sqrt((double)i)));
+      double error = fabs((double)(time - t.last) - exact);
+      if (error > t.maxError) { t.maxError = error; }
+      if (error / exact > t.maxRelative) { t.maxRelative = error / exact; }
+      t.sumSquares += error * error;
+    }
+    t.last = time;
+    t.index++;
+  };
+  engine.plan(steps, maxSpeed, acceleration);
+  engine.start();
+  hal.run(engine);
+
+  bench.metric("stepEngine/interval_error_max", timing.maxError, "ticks");
+  bench.metric("stepEngine/interval_error_rms", sqrt(timing.sumSquares / (steps - 1)), "ticks");
+  bench.metric("stepEngine/interval_error_rel_max", timing.maxRelative, "ratio");
+}
+
+/// Benchmarks DRV8461MultiAxis with `axes` axes (at most 32) on a simulated
+/// timer running at `timerHz`: a linear move in which the dominant axis takes
+/// `steps` steps and axis i takes (i + 1) / axes of that.
+///
+/// It records the CPU time per tick of the timebase and the aggregate step
+/// rate over all axes that makes sustainable (multiAxis/steps_per_s), and
+/// how far each axis's steps are from their exact times on the straight
+/// line: the largest and RMS errors in timer ticks, and the largest as a
+/// fraction of the step interval of the dominant axis.
+inline void DRV8461_benchmarkMultiAxis(DRV8461Benchmark & bench, uint32_t steps, uint8_t axes = 16,
+  uint32_t timerHz = 2000000)
+{
+  typedef BasicDRV8434S<DRV8461SimBus> Driver;
+  typedef DRV8461SimMultiStepHal<32> Hal;
+  const uint32_t maxSpeed = 50000, acceleration = 200000;
+
+  static Driver drivers[32];
+  Hal hal;
+  DRV8461MultiAxis<Driver, Hal, 32> multi(hal, timerHz);
+  int32_t target[32];
+  for (uint8_t i = 0; i < axes; i++)
+  {
+    multi.addAxis(drivers[i]);
+    target[i] = (int32_t)((uint64_t)steps * (i + 1) / axes);
+  }
+
+  // CPU cost per tick.
+  multi.moveLinear(target, maxSpeed, acceleration);
+  uint64_t start = DRV8461Benchmark::now();
+  hal.run(multi);
+  double cpuTime = (double)(DRV8461Benchmark::now() - start);
+  bench.metric("multiAxis/cpu_ns_per_tick", cpuTime / steps, "ns");
+  bench.metric("multiAxis/steps_per_s", 1e9 * hal.steps / cpuTime, "steps/s");
+
+  // Step times, for the error of each axis against the straight line.  The
+  // DDA keeps every axis at the whole step nearest the line, so step k of an
+  // axis taking n steps is due when the line crosses k - 1/2, that is when
+  // the dominant axis is at (k - 1/2) * N / n.  The dominant axis's first
+  // step is the start of the move.
+  struct Record
+  {
+    std::vector<uint64_t> times;
+    std::vector<uint32_t> masks;
+  } record;
+  record.times.reserve(steps);
+  record.masks.reserve(steps);
+  hal.stepContext = &record;
+  hal.stepCallback = [](void * context, uint32_t mask, uint64_t time) {
+    Record & r = *static_cast<Record *>(context);
+    r.times.push_back(time);
+    r.masks.push_back(mask);
+  };
+  for (uint8_t i = 0; i < axes; i++) { target[i] = 0; }
+  multi.moveLinear(target, maxSpeed, acceleration);
+  hal.run(multi);
+
+  double maxError = 0, maxRelative = 0, sumSquares = 0;
+  uint32_t count = 0;
+  const uint32_t ticks = record.times.size();
+  for (uint8_t i = 0; i < axes; i++)
+  {
+    uint32_t n = (uint32_t)((uint64_t)steps * (i + 1) / axes), k = 0;
+    for (uint32_t m = 0; m < ticks; m++)
+    {
+      if (!(record.masks[m] & ((uint32_t)1 << i))) { continue; }
+      k++;
+      double x = (k - 0.5) * ticks / n - 1;
+      if (x < 0) { x = 0; }
+      uint32_t lo = (uint32_t)x;
+      if (lo + 1 >= ticks) { lo = ticks - 2; }
+      double interval = (double)(record.times[lo + 1] - record.times[lo]);
+      double exact = record.times[lo] + (x - lo) * interval;
+      double error = fabs((double)record.times[m] - exact);
+      if (error > maxError) { maxError = error; }
+      if (error / interval > maxRelative) { maxRelative = error / interval; }
+      sumSquares += error * error;
+      count++;
+    }
+  }
+
+  bench.metric("multiAxis/axis_error_max", maxError, "ticks");
+  bench.metric("multiAxis/axis_error_rms", sqrt(sumSquares / (count ? count : 1)), "ticks");
+  bench.metric("multiAxis/axis_error_rel_max", maxRelative, "ratio");
+}
+
+
+/// Benchmarks generating each kind of microstep wavetable at run time,
+/// `iterations` times each, with inputs the compiler cannot fold.  (At
+/// compile time the cost is zero; uploading is measured by
+/// DRV8461_benchmarkDriver() as setWavetable.)  Every entry of each table is
+/// used, so no part of the computation can be dropped.
+inline void DRV8461_benchmarkWavetable(DRV8461Benchmark & bench, uint32_t iterations)
+{
+  static const double measured[] = { 0, 0.3, 0.62, 0.85, 1.0 };
+  auto fold = [](const DRV8461Wavetable & table) {
+    uint8_t sum = 0;
+    for (uint8_t j = 0; j < DRV8461_WAVETABLE_POINTS; j++) { sum = sum + table.current[j]; }
+    return sum;
+  };
+  volatile int8_t third = 8, fifth = 0;
+  volatile uint8_t sink = 0;
+  double points[5];
+
+  uint64_t start = DRV8461Benchmark::now();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    sink = sink + fold(DRV8461_harmonicWavetable(third, fifth));
+  }
+  bench.metric("wavetable/harmonic_ns", (double)(DRV8461Benchmark::now() - start) / iterations, "ns");
+
+  start = DRV8461Benchmark::now();
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    for (uint8_t j = 0; j < 5; j++) { points[j] = *(volatile const double *)&measured[j]; }
+    sink = sink + fold(DRV8461_pointsWavetable(points));
+  }
+  bench.metric("wavetable/points_ns", (double)(DRV8461Benchmark::now() - start) / iterations, "ns");
+}
+
+
+/// Benchmarks DRV8461TelemetryRecorder and the telemetry stream format with
+/// four channels (FAULT, DIAG2, CTRL14, ATQ_CTRL1) over `samples` samples, in
+/// which the load count changes every few samples as it would under load.
+///
+/// It records the cost of sample() (the part that runs at the sampling rate)
+/// and the rate it would sustain, and the cost of encoding and decoding a
+/// sample and the stream size per sample.
+inline void DRV8461_benchmarkTelemetry(DRV8461Benchmark & bench, uint32_t samples)
+{
+  struct Buffer
+  {
+    std::vector<uint8_t> bytes;
+    void write(const uint8_t * data, size_t length) { bytes.insert(bytes.end(), data, data + length); }
+  };
+
+  BasicDRV8434SSPI<DRV8461SimBus> driver;
+  DRV8461TelemetryRecorder<BasicDRV8434SSPI<DRV8461SimBus>, 1024> recorder(driver);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_DIAG2);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_CTRL14);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1);
+  Buffer buffer;
+  DRV8461TelemetryEncoder<Buffer> encoder(buffer);
+  encoder.begin(recorder);
+
+  uint64_t sampleTime = 0, encodeTime = 0;
+  DRV8461TelemetrySample s;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    DRV8461Fields::ATQ_CNT::set(driver.bus.regs, (i / 4) % 2048);
+    uint64_t start = DRV8461Benchmark::now();
+    recorder.sample(i * 100);
+    uint64_t sampled = DRV8461Benchmark::now();
+    recorder.pop(s);
+    encoder.add(s);
+    encodeTime += DRV8461Benchmark::now() - sampled;
+    sampleTime += sampled - start;
+  }
+  encoder.finish();
+
+  DRV8461TelemetryDecoder decoder;
+  decoder.attach(buffer.bytes.data(), buffer.bytes.size());
+  const DRV8461TelemetrySample * sample;
+  uint64_t start = DRV8461Benchmark::now();
+  uint32_t decoded = 0;
+  while (decoder.next(sample)) { decoded++; }
+  uint64_t decodeTime = DRV8461Benchmark::now() - start;
+
+  bench.metric("telemetry/sample_cpu_ns", (double)sampleTime / samples, "ns");
+  bench.metric("telemetry/max_sample_rate", 1e9 * samples / (sampleTime ? sampleTime : 1), "samples/s");
+  bench.metric("telemetry/encode_cpu_ns", (double)encodeTime / samples, "ns");
+  bench.metric("telemetry/decode_cpu_ns", (double)decodeTime / (decoded ? decoded : 1), "ns");
+  bench.metric("telemetry/bytes_per_sample", (double)buffer.bytes.size() / samples, "bytes");
+}
+
+#endif                                    // #if defined(__linux__)
+
+#endif                                    // #ifndef DRV8461_BENCHMARK_H
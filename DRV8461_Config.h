@@ -0,0 +1,311 @@
+#ifndef DRV8461_CONFIG_H
+#define DRV8461_CONFIG_H
+
+/*  DRV8461_Config.h
+
+    A complete DRV8461 register image built and checked at compile time, to
+    be written with DRV8434S::applyConfig().
+
+*/
+#pragma once
+
+#include <cstdint>
+
+#include "DRV8461_Register_Address_Locations.h"
+#include "DRV8461_Register_Table.h"
+#include "DRV8461_Field.h"
+#include "DRV8461_Wavetable.h"
+
+
+/// Problems found in a DRV8461DriverConfig, as returned by errors().
+enum DRV8461_CONFIG_ERROR : uint8_t {
+  DRV8461_CONFIG_RANGE      = 0x01,     // A value did not fit its field (or a percentage was not 1-100).
+  DRV8461_CONFIG_RES_AUTO   = 0x02,     // An auto microstep resolution was chosen without EN_AUTO.
+  DRV8461_CONFIG_ATQ_LIMITS = 0x04,     // ATQ_LL is above ATQ_UL.
+  DRV8461_CONFIG_ATQ_RANGE  = 0x08,     // ATQ_TRQ_MIN is above ATQ_TRQ_MAX.
+  DRV8461_CONFIG_HOLD       = 0x10,     // Standstill power saving would raise the current (ISTSL above TRQ_DAC).
+};
+
+
+/// Converts a current to the scale of TRQ_DAC and ISTSL, where code n gives
+/// (n + 1) / 256 of `fullCurrent`.  Returns the highest code that does not
+/// exceed `current`, limited to 0-255.
+constexpr uint8_t DRV8461_currentToDac(uint32_t current, uint32_t fullCurrent)
+{
+  uint32_t steps = fullCurrent ? current * 256 / fullCurrent : 0;
+  return steps == 0 ? 0 : steps > 256 ? 255 : (uint8_t)(steps - 1);
+}
+
+/// Converts a current in percent of full scale to the scale of TRQ_DAC and
+/// ISTSL (see DRV8461_currentToDac()).
+constexpr uint8_t DRV8461_currentPercentToDac(uint8_t percent)
+{
+  return DRV8461_currentToDac(percent, 100);
+}
+
+
+/// Converts a delay in milliseconds to the nearest TSTSL_DLY setting at or
+/// above it, from 16 ms to 1008 ms in steps of 16 ms.
+constexpr DRV8461_Delay_Until_Standstill DRV8461_standstillDelay(uint16_t milliseconds)
+{
+  return (DRV8461_Delay_Until_Standstill)(milliseconds <= 16 ? 1 : milliseconds >= 1008 ? 63 : (milliseconds + 15) / 16);
+}
+
+/// Converts a fall time in milliseconds to a TSTSL_FALL setting, from 1 ms
+/// to 15 ms.
+constexpr DRV8461_Current_Reduction_Time DRV8461_standstillFallTime(uint8_t milliseconds)
+{
+  return (DRV8461_Current_Reduction_Time)(milliseconds < 1 ? 1 : milliseconds > 15 ? 15 : milliseconds);
+}
+
+/// A complete set of DRV8461 settings, built by chaining calls on a default
+/// (power-on) configuration.  Every call returns a modified copy and can run
+/// at compile time, so a constexpr configuration is only a table of register
+/// bytes in the program; DRV8434S::applyConfig() copies it to the cache and
+/// writes it in one batch.
+///
+/// Values that do not fit, and combinations that make no sense, are recorded
+/// in errors() rather than clipped; check them with a static_assert on
+/// valid() next to the definition.  Fields without a named setter can be set
+/// with field().
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// constexpr DRV8461DriverConfig config = DRV8461DriverConfig()
+///   .decay(DRV8461_Decay_Mode::DRV8461_DECAY_SMART_RIPPLE)
+///   .toff(DRV8461_PWM_TOFF::DRV8461_TOFF_19US)
+///   .microstep(DRV8461_Micostep_Mode::DRV8461_MICROSTEP_32)
+///   .runCurrent(80)
+///   .holdCurrent(30)
+///   .standstill(true, DRV8461_Delay_Until_Standstill::DRV8461_TSTSL_FALL_96,
+///     DRV8461_Current_Reduction_Time::DRV8461_TSTSL_FALL_4)
+///   .outputs(true);
+/// static_assert(config.valid(), "bad driver configuration");
+/// // In setup():
+/// sd.applyConfig(config);
+/// ~~~
+class DRV8461DriverConfig
+{
+public:
+  /// The power-on configuration.
+  constexpr DRV8461DriverConfig() : regs{}
+  {
+    for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+    {
+      regs[address] = DRV8461_regInfo(address).resetValue;
+    }
+  }
+
+  /// Returns the register image.
+  constexpr uint8_t reg(DRV8461_REG_ADDR address) const
+  {
+    return regs[(uint8_t)address];
+  }
+
+  /// Returns the DRV8461_CONFIG_ERROR bits for everything wrong with this
+  /// configuration, or 0.
+  constexpr uint8_t errors() const
+  {
+    uint8_t e = rangeErrors;
+    if (resAutoSet && !DRV8461Fields::EN_AUTO::extract(reg(DRV8461Fields::EN_AUTO::address)))
+    {
+      e |= DRV8461_CONFIG_RES_AUTO;
+    }
+    if (reg(DRV8461Fields::ATQ_LL::address) > reg(DRV8461Fields::ATQ_UL::address))
+    {
+      e |= DRV8461_CONFIG_ATQ_LIMITS;
+    }
+    if (reg(DRV8461Fields::ATQ_TRQ_MIN::address) > reg(DRV8461Fields::ATQ_TRQ_MAX::address))
+    {
+      e |= DRV8461_CONFIG_ATQ_RANGE;
+    }
+    if (DRV8461Fields::EN_STSL::extract(reg(DRV8461Fields::EN_STSL::address)) &&
+      reg(DRV8461Fields::ISTSL::address) > reg(DRV8461Fields::TRQ_DAC::address))
+    {
+      e |= DRV8461_CONFIG_HOLD;
+    }
+    return e;
+  }
+
+  /// Returns true if errors() is 0.
+  constexpr bool valid() const
+  {
+    return errors() == 0;
+  }
+
+  /// Sets any field.  For numbers, a value too large for the field is a
+  /// DRV8461_CONFIG_RANGE error.
+  template <typename Field>
+  constexpr DRV8461DriverConfig field(typename Field::Value value) const
+  {
+    DRV8461DriverConfig c = *this;
+    c.put<Field>(value);
+    return c;
+  }
+
+  /// Enables or disables the outputs (EN_OUT).  DRV8434S::applyConfig()
+  /// writes CTRL1 last, so the outputs come on with every other setting in
+  /// place.
+  constexpr DRV8461DriverConfig outputs(bool enabled) const
+  {
+    return field<DRV8461Fields::EN_OUT>(enabled);
+  }
+
+  /// Sets the decay mode (DECAY).
+  constexpr DRV8461DriverConfig decay(DRV8461_Decay_Mode mode) const
+  {
+    return field<DRV8461Fields::DECAY>(mode);
+  }
+
+  /// Sets the PWM off time (TOFF).
+  constexpr DRV8461DriverConfig toff(DRV8461_PWM_TOFF time) const
+  {
+    return field<DRV8461Fields::TOFF>(time);
+  }
+
+  /// Sets the microstepping mode (MICROSTEP_MODE).
+  constexpr DRV8461DriverConfig microstep(DRV8461_Micostep_Mode mode) const
+  {
+    return field<DRV8461Fields::MICROSTEP_MODE>(mode);
+  }
+
+  /// Selects whether STEP and DIR come from SPI (SPI_STEP, SPI_DIR) rather
+  /// than the pins.
+  constexpr DRV8461DriverConfig spiStepping(bool step, bool direction) const
+  {
+    return field<DRV8461Fields::SPI_STEP>(step).field<DRV8461Fields::SPI_DIR>(direction);
+  }
+
+  /// Sets the run current (TRQ_DAC) in percent of the full current limit,
+  /// from 1 to 100.
+  constexpr DRV8461DriverConfig runCurrent(uint8_t percent) const
+  {
+    DRV8461DriverConfig c = field<DRV8461Fields::TRQ_DAC>((DRV_Run_Current)DRV8461_currentPercentToDac(percent));
+    if (percent < 1 || percent > 100) { c.rangeErrors |= DRV8461_CONFIG_RANGE; }
+    return c;
+  }
+
+  /// Sets the standstill (holding) current (ISTSL) in percent of the full
+  /// current limit, from 1 to 100.  It is used when standstill power saving
+  /// is enabled (see standstill()).
+  constexpr DRV8461DriverConfig holdCurrent(uint8_t percent) const
+  {
+    DRV8461DriverConfig c = field<DRV8461Fields::ISTSL>((DRV8461_Holding_Current)DRV8461_currentPercentToDac(percent));
+    if (percent < 1 || percent > 100) { c.rangeErrors |= DRV8461_CONFIG_RANGE; }
+    return c;
+  }
+
+  /// Configures standstill power saving (EN_STSL, TSTSL_DLY and TSTSL_FALL):
+  /// `delay` after the last step, the current falls to the hold current over
+  /// `fall`.
+  constexpr DRV8461DriverConfig standstill(bool enabled, DRV8461_Delay_Until_Standstill delay,
+    DRV8461_Current_Reduction_Time fall) const
+  {
+    return field<DRV8461Fields::EN_STSL>(enabled)
+      .field<DRV8461Fields::TSTSL_DLY>(delay)
+      .field<DRV8461Fields::TSTSL_FALL>(fall);
+  }
+
+  /// Configures stall detection (EN_STL, STL_REP).
+  constexpr DRV8461DriverConfig stallDetection(bool enabled, bool reportOnFault = true) const
+  {
+    return field<DRV8461Fields::EN_STL>(enabled).field<DRV8461Fields::STL_REP>(reportOnFault);
+  }
+
+  /// Sets the stall threshold (STALL_TH, 12 bits).
+  constexpr DRV8461DriverConfig stallThreshold(uint16_t threshold) const
+  {
+    return field<DRV8461Fields::STALL_TH>(threshold);
+  }
+
+  /// Sets the current ripple of smart tune ripple control (RC_RIPPLE).
+  constexpr DRV8461DriverConfig ripple(DRV8461_RC_Ripple ripple) const
+  {
+    return field<DRV8461Fields::RC_RIPPLE>(ripple);
+  }
+
+  /// Enables or disables spread spectrum (EN_SSC).
+  constexpr DRV8461DriverConfig spreadSpectrum(bool enabled) const
+  {
+    return field<DRV8461Fields::EN_SSC>(enabled);
+  }
+
+  /// Enables or disables automatic microstepping (EN_AUTO).
+  constexpr DRV8461DriverConfig autoMicrostep(bool enabled) const
+  {
+    return field<DRV8461Fields::EN_AUTO>(enabled);
+  }
+
+  /// Sets the resolution automatic microstepping interpolates to (RES_AUTO).
+  /// This needs autoMicrostep(true).
+  constexpr DRV8461DriverConfig autoResolution(DRV8461_Auto_Microstep resolution) const
+  {
+    DRV8461DriverConfig c = field<DRV8461Fields::RES_AUTO>(resolution);
+    c.resAutoSet = true;
+    return c;
+  }
+
+  /// Configures open load detection (EN_OL, OL_T).
+  constexpr DRV8461DriverConfig openLoad(bool enabled, DRV8461_Open_Load_Detection_Time time) const
+  {
+    return field<DRV8461Fields::EN_OL>(enabled).field<DRV8461Fields::OL_T>(time);
+  }
+
+  /// Enables or disables auto-torque (ATQ_EN) and sets the band it keeps the
+  /// load count in (ATQ_LL, ATQ_UL) and the currents it may choose from
+  /// (ATQ_TRQ_MIN, ATQ_TRQ_MAX, on the TRQ_DAC scale).
+  constexpr DRV8461DriverConfig autoTorque(bool enabled, uint8_t lower, uint8_t upper,
+    uint8_t minimum, uint8_t maximum) const
+  {
+    return field<DRV8461Fields::ATQ_EN>(enabled)
+      .field<DRV8461Fields::ATQ_LL>(lower)
+      .field<DRV8461Fields::ATQ_UL>(upper)
+      .field<DRV8461Fields::ATQ_TRQ_MIN>(minimum)
+      .field<DRV8461Fields::ATQ_TRQ_MAX>(maximum);
+  }
+
+  /// Sets the custom microstep table (CUSTOM_CTRL2-9) and whether the driver
+  /// uses it (EN_CUSTOM).
+  constexpr DRV8461DriverConfig wavetable(const DRV8461Wavetable & table, bool enable = true) const
+  {
+    DRV8461DriverConfig c = field<DRV8461Fields::EN_CUSTOM>(enable);
+    for (uint8_t i = 0; i < DRV8461_WAVETABLE_POINTS; i++)
+    {
+      c.regs[(uint8_t)DRV8461Fields::CUSTOM_CURRENT<1>::address + i] = table.current[i];
+    }
+    return c;
+  }
+
+private:
+
+  template <typename Field>
+  constexpr void put(typename Field::Value value)
+  {
+    if ((uint32_t)value > (uint32_t)Field::maxValue()) { rangeErrors |= DRV8461_CONFIG_RANGE; }
+    Field::set(regs, value);
+  }
+
+  uint8_t regs[DRV8461_REG_ADDR_COUNT];
+  uint8_t rangeErrors = 0;
+  bool resAutoSet = false;
+};
+
+
+// CONFIG CHECKS *****************************************************************************************************//
+static_assert(DRV8461DriverConfig().valid(), "the power-on configuration must be valid");
+static_assert(DRV8461DriverConfig().microstep(DRV8461_Micostep_Mode::DRV8461_MICROSTEP_32)
+  .reg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2) == ((DRV8461_regInfo(DRV8461_REG_ADDR::DRV8461_REG_CTRL2).resetValue & 0xF0) | 0x07),
+  "microstep() sets only MICROSTEP_MODE");
+static_assert(DRV8461DriverConfig().autoResolution(DRV8461_Auto_Microstep::DRV8461_MICRO_RES_64).errors() == DRV8461_CONFIG_RES_AUTO,
+  "RES_AUTO without EN_AUTO is rejected");
+static_assert(DRV8461DriverConfig().stallThreshold(0x1000).errors() == DRV8461_CONFIG_RANGE, "STALL_TH is 12 bits");
+static_assert(DRV8461_currentToDac(2000, 2000) == 255 && DRV8461_currentToDac(1000, 2000) == 127 &&
+  DRV8461_currentToDac(5, 2000) == 0 && DRV8461_currentToDac(9000, 2000) == 255, "TRQ_DAC n is (n + 1) / 256 of full scale");
+static_assert(DRV8461_standstillDelay(100) == DRV8461_Delay_Until_Standstill::DRV8461_TSTSL_FALL_112 &&
+  DRV8461_standstillDelay(5000) == DRV8461_Delay_Until_Standstill::DRV8461_TSTSL_FALL_1008 &&
+  DRV8461_standstillFallTime(4) == DRV8461_Current_Reduction_Time::DRV8461_TSTSL_FALL_4, "standstill timing conversions");
+static_assert(DRV8461DriverConfig().runCurrent(100).reg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11) == 255 &&
+  DRV8461DriverConfig().runCurrent(0).errors() == DRV8461_CONFIG_RANGE, "run current is 1-100%");
+
+
+#endif                                    // #ifndef DRV8461_CONFIG_H
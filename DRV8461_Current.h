@@ -0,0 +1,177 @@
+#ifndef DRV8461_CURRENT_H
+#define DRV8461_CURRENT_H
+
+/*  DRV8461_Current.h
+
+    Current lookup tables built at compile time, and switching the DRV8461
+    run current with the phase of a move.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+#include "DRV8461_StepEngine.h"
+
+
+/// A table of TRQ_DAC and ISTSL codes for currents in milliamps, for a
+/// driver whose full current limit (set by VREF) is `FullCurrent` mA.  It is
+/// built at compile time, so a lookup is one division by a constant (which
+/// compilers turn into a multiplication) and one load.
+///
+/// Currents below FullCurrent are looked up in steps of `Resolution` mA and
+/// rounded down, so the code returned never gives more than the current asked
+/// for; FullCurrent and above give 255.  The table takes
+/// (FullCurrent - 1) / Resolution + 1 bytes.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// static constexpr DRV8461CurrentTable<1500> currents;
+/// sd.setField<DRV8461Fields::TRQ_DAC>(currents.trqDac(1200));
+/// sd.setField<DRV8461Fields::ISTSL>(currents.istsl(400));
+/// ~~~
+template <uint16_t FullCurrent, uint16_t Resolution = 10>
+class DRV8461CurrentTable
+{
+  static_assert(FullCurrent > 0 && Resolution > 0, "the full current and resolution must not be 0");
+
+public:
+  /// The number of entries.
+  static constexpr uint16_t size = (FullCurrent - 1) / Resolution + 1;
+
+  constexpr DRV8461CurrentTable() : codes{}
+  {
+    for (uint16_t i = 0; i < size; i++)
+    {
+      codes[i] = DRV8461_currentToDac((uint32_t)i * Resolution, FullCurrent);
+    }
+  }
+
+  /// Returns the code (on the TRQ_DAC and ISTSL scale) for a current in
+  /// milliamps.
+  constexpr uint8_t code(uint16_t milliamps) const
+  {
+    return milliamps >= FullCurrent ? 255 : codes[milliamps / Resolution];
+  }
+
+  /// Returns the TRQ_DAC value for a run current in milliamps.
+  constexpr DRV_Run_Current trqDac(uint16_t milliamps) const
+  {
+    return (DRV_Run_Current)code(milliamps);
+  }
+
+  /// Returns the ISTSL value for a standstill current in milliamps.
+  constexpr DRV8461_Holding_Current istsl(uint16_t milliamps) const
+  {
+    return (DRV8461_Holding_Current)code(milliamps);
+  }
+
+private:
+
+  uint8_t codes[size];
+};
+
+
+/// The run current (TRQ_DAC code) for each phase of a move, used by
+/// DRV8461CurrentScheduler.  DRV8461CurrentTable::code() converts from
+/// milliamps.
+struct DRV8461PhaseCurrents
+{
+  uint8_t accel;
+  uint8_t cruise;
+  uint8_t decel;
+
+  /// Used while no move is in progress.
+  uint8_t hold;
+};
+
+
+/// This class changes the run current (TRQ_DAC) to match the phase of the
+/// moves made by a DRV8461StepEngine, so the motor gets full torque only
+/// while it accelerates and rests at a lower current.
+///
+/// start() sets the acceleration current and then starts the move.  After
+/// that, tick() should be called from the main loop: when the engine's phase
+/// has changed, it makes one CTRL11 write.  No SPI traffic is added to the
+/// step interrupt, and nothing is written while the phase stays the same.
+///
+/// `Engine` must provide the start() and getPhase() members of
+/// DRV8461StepEngine.  If the engine steps through SPI, tick() must not run
+/// while its timer interrupt can, since both would use the bus.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// static constexpr DRV8461CurrentTable<2000> table;
+/// DRV8461CurrentScheduler<DRV8434S, DRV8461StepEngine<MyHal>> currents(sd, engine,
+///   { table.code(1800), table.code(1200), table.code(1000), table.code(400) });
+/// engine.plan(3200, 8000, 40000);
+/// currents.start();
+/// // In the main loop:
+/// currents.tick();
+/// ~~~
+template <class Driver, class Engine>
+class DRV8461CurrentScheduler
+{
+public:
+  DRV8461CurrentScheduler(Driver & sd, Engine & engine, const DRV8461PhaseCurrents & currents)
+    : sd(sd), engine(engine), currents(currents)
+  {
+  }
+
+  /// Changes the currents.  The one for the current phase is written at the
+  /// next tick().
+  void setCurrents(const DRV8461PhaseCurrents & currents)
+  {
+    this->currents = currents;
+  }
+
+  /// Sets the acceleration current and starts the planned move.
+  void start()
+  {
+    write(currents.accel);
+    engine.start();
+  }
+
+  /// Writes the current for the engine's phase if it is not already set.
+  ///
+  /// @return true if a write was made.
+  bool tick()
+  {
+    uint32_t before = switches;
+    write(currentFor(engine.getPhase()));
+    return switches != before;
+  }
+
+  /// Returns the number of current changes written so far.
+  uint32_t getSwitches() const
+  {
+    return switches;
+  }
+
+private:
+
+  uint8_t currentFor(DRV8461_Motion_Phase phase) const
+  {
+    switch (phase)
+    {
+      case DRV8461_Motion_Phase::DRV8461_PHASE_ACCEL:  return currents.accel;
+      case DRV8461_Motion_Phase::DRV8461_PHASE_CRUISE: return currents.cruise;
+      case DRV8461_Motion_Phase::DRV8461_PHASE_DECEL:  return currents.decel;
+      default:                                         return currents.hold;
+    }
+  }
+
+  void write(uint8_t code)
+  {
+    if (code == (uint8_t)sd.template getField<DRV8461Fields::TRQ_DAC>()) { return; }
+    sd.template setField<DRV8461Fields::TRQ_DAC>((DRV_Run_Current)code);
+    switches++;
+  }
+
+  Driver & sd;
+  Engine & engine;
+  DRV8461PhaseCurrents currents;
+  uint32_t switches = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_CURRENT_H
@@ -0,0 +1,227 @@
+#ifndef DRV8461_DAISYCHAIN_H
+#define DRV8461_DAISYCHAIN_H
+
+/*  DRV8461_DaisyChain.h
+
+    Access to several DRV8461 drivers daisy-chained on one chip select.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// This class talks to up to `MaxDevices` DRV8461 drivers wired as an SPI daisy
+/// chain (SDO of one device to SDI of the next, all sharing SCLK and nSCS).
+///
+/// Each chained frame starts with two header bytes, followed by one address
+/// byte and one data byte per device:
+///
+///     SDI: HDR1 HDR2 A[N-1] ... A[0] D[N-1] ... D[0]
+///     SDO: S[N-1] ... S[0] HDR1 HDR2 R[N-1] ... R[0]
+///
+/// Device 0 is the one whose SDI is driven by the controller; device N-1
+/// drives the controller's SDI.  One chip select assertion therefore reads or
+/// writes one register on every device, and the bus cost of a cycle grows with
+/// the number of bytes instead of the number of transactions.
+///
+/// The devices are ordinary DRV8434S objects.  Their cached settings are used
+/// as the data to write, and the status byte each one returns is passed to its
+/// DRV8434SSPI::reportStatus(), so lastStatus and the status callback (see
+/// DRV8461FaultMonitor) see it just as for a single-device transfer.  The
+/// DRV8434S setters still talk to the device's own chip select, so registers
+/// of chained devices should be written through this class.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8434S x, y, z;
+/// DRV8461DaisyChain<3> chain;
+/// chain.setChipSelectPin(10);
+/// chain.addDevice(x);
+/// chain.addDevice(y);
+/// chain.addDevice(z);
+/// chain.applySettings();
+///
+/// const uint8_t trqDac[3] = { 0x80, 0x80, 0xC0 };
+/// chain.writeReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11, trqDac);
+/// ~~~
+///
+/// `Bus` is the same bus class used with BasicDRV8434S (see
+/// DRV8461ArduinoBus); DRV8461DaisyChain<N> uses the Arduino bus.  `Device`
+/// is the class of the devices, for example a BasicDRV8434S with a Stats
+/// policy; only its cache and its driver's reportStatus() are used, so chained
+/// frames are not counted by that policy (see DRV8461BusStats).
+template <class Bus, uint8_t MaxDevices, class Device = BasicDRV8434S<Bus>>
+class BasicDRV8461DaisyChain
+{
+  static_assert(MaxDevices >= 1 && MaxDevices <= 63, "HDR1 holds a 6-bit device count");
+
+public:
+
+  /// Configures this object to use the specified pin as the shared chip select
+  /// pin.
+  void setChipSelectPin(uint8_t pin)
+  {
+    bus.setChipSelectPin(pin);
+  }
+
+  /// Appends a device to the chain; the first device added is device 0.
+  ///
+  /// @return false if the chain is already full.
+  bool addDevice(Device & device)
+  {
+    if (count >= MaxDevices) { return false; }
+    devices[count++] = &device;
+    return true;
+  }
+
+  /// Returns the number of devices in the chain.
+  uint8_t deviceCount() const
+  {
+    return count;
+  }
+
+  /// Returns the device at the given chain position.
+  Device & device(uint8_t index)
+  {
+    return *devices[index];
+  }
+
+  /// Reads the given register from every device in one frame.  `data` must
+  /// have room for deviceCount() bytes and receives the value from each
+  /// device, indexed by chain position.
+  void readReg(DRV8461_REG_ADDR address, uint8_t * data)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      address_(i) = DRV8461_readCommand((uint8_t)address);
+      data_(i) = 0;
+    }
+    transferChain(false);
+    for (uint8_t i = 0; i < count; i++) { data[i] = report(i); }
+  }
+
+  /// Writes the given register on every device in one frame, with `values`
+  /// indexed by chain position.  If `oldData` is not null, it receives the
+  /// previous contents of the register on each device.
+  ///
+  /// This does not update the devices' cached settings; use writeCachedReg()
+  /// to keep them consistent.
+  void writeReg(DRV8461_REG_ADDR address, const uint8_t * values, uint8_t * oldData = nullptr)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      address_(i) = DRV8461_writeCommand((uint8_t)address);
+      data_(i) = values[i];
+    }
+    transferChain(false);
+    if (oldData)
+    {
+      for (uint8_t i = 0; i < count; i++) { oldData[i] = report(i); }
+    }
+  }
+
+  /// Writes each device's cached value of the given register in one frame.
+  void writeCachedReg(DRV8461_REG_ADDR address)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      address_(i) = DRV8461_writeCommand((uint8_t)address);
+      data_(i) = devices[i]->getCachedReg(address);
+    }
+    transferChain(false);
+  }
+
+  /// Re-writes the cached settings of every device, one frame per register.
+  /// CTRL1 is written last because it contains the EN_OUT bit.
+  void applySettings()
+  {
+    for (uint8_t r = 0; r < Device::settingsRegCount; r++)
+    {
+      writeCachedReg(Device::settingsReg(r));
+    }
+  }
+
+  /// Reads back the settings registers of every device, one frame per
+  /// register, and compares them to each device's cached copy.  Bits that the
+  /// driver updates or clears by itself are ignored, as in
+  /// DRV8434S::verifySettings().
+  ///
+  /// @return true if every device matches its cached settings.
+  bool verifySettings()
+  {
+    bool ok = true;
+    for (uint8_t r = 0; r < Device::settingsRegCount; r++)
+    {
+      DRV8461_REG_ADDR address = Device::settingsReg(r);
+      uint8_t mask = DRV8461_regInfo(address).settingsMask();
+      uint8_t data[MaxDevices];
+      readReg(address, data);
+      for (uint8_t i = 0; i < count; i++)
+      {
+        if ((data[i] ^ devices[i]->getCachedReg(address)) & mask) { ok = false; }
+      }
+    }
+    return ok;
+  }
+
+  /// Clears latched faults on every device by setting the CLR bit in HDR2.
+  /// The frame reads the FAULT register, so each device's lastStatus is
+  /// refreshed as well.
+  ///
+  /// See DRV8434S::clearFaults() for the precautions that apply.
+  void clearFaults()
+  {
+    // count never exceeds MaxDevices; saying so keeps GCC's vectorizer from
+    // warning about writes past the frame.
+    for (uint8_t i = 0; i < count && i < MaxDevices; i++)
+    {
+      address_(i) = DRV8461_readCommand((uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+      data_(i) = 0;
+    }
+    transferChain(true);
+  }
+
+  /// The bus shared by the chained devices.
+  Bus bus;
+
+private:
+
+  // Outgoing bytes of the address and data sections for device i.  Devices
+  // are sent farthest-first, so device N-1 comes right after the header.
+  uint8_t & address_(uint8_t i) { return frame[2 + (count - 1 - i)]; }
+  uint8_t & data_(uint8_t i) { return frame[2 + count + (count - 1 - i)]; }
+
+  // Incoming status and report bytes for device i, valid after a transfer.
+  uint8_t status(uint8_t i) const { return frame[count - 1 - i]; }
+  uint8_t report(uint8_t i) const { return frame[count + 2 + (count - 1 - i)]; }
+
+  /// Fills in the header, shifts the whole chained frame through the devices
+  /// in place, and hands each device its status byte.
+  void transferChain(bool clearFaults)
+  {
+    uint8_t length = 2 * count + 2;
+    frame[0] = 0x80 | count;                      // HDR1: 10b, device count
+    frame[1] = 0x80 | (clearFaults ? 0x20 : 0);   // HDR2: 10b, CLR
+
+    bus.transfer(frame, length, 1);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      devices[i]->driver.reportStatus(status(i));
+    }
+  }
+
+  Device * devices[MaxDevices];
+  uint8_t count = 0;
+  uint8_t frame[2 * MaxDevices + 2];
+};
+
+
+#if defined(ARDUINO)
+template <uint8_t MaxDevices>
+using DRV8461DaisyChain = BasicDRV8461DaisyChain<DRV8461ArduinoBus, MaxDevices>;
+#endif
+
+
+#endif                                    // #ifndef DRV8461_DAISYCHAIN_H
@@ -0,0 +1,211 @@
+#ifndef DRV8461_FAULTMONITOR_H
+#define DRV8461_FAULTMONITOR_H
+
+/*  DRV8461_FaultMonitor.h
+
+    Fault detection from the status byte of ordinary SPI traffic, with a
+    timestamped event log.
+
+*/
+#pragma once
+
+#include <atomic>
+
+#include "DRV8461_Registers.h"
+
+
+/// One change of a fault condition, recorded by DRV8461FaultMonitor.
+struct DRV8461FaultEvent
+{
+  /// The time the change was seen, from the monitor's clock function.
+  uint32_t time;
+
+  /// The condition that changed, one of the DRV8461_FAULT_Reg_Val bits.
+  DRV8461_FAULT_Reg_Val fault;
+
+  /// True if the condition became active, false if it went away.
+  bool active;
+};
+
+
+/// This class watches the status byte that the DRV8461 returns in every SPI
+/// frame and records when fault conditions appear and disappear, so faults are
+/// noticed without polling DRV8434S::readFault().
+///
+/// The status byte holds the lower six bits of FAULT (UVLO, CPUV, OCP, STL,
+/// TF, OL).  attach() registers the monitor as the driver's status callback,
+/// so every read and write the application makes anyway is checked for free.
+/// Only when one of those bits changes, or a frame comes back with an invalid
+/// status byte, does the monitor read FAULT and DIAG1-3 itself, in one
+/// batch; that read also picks up SPI_ERR, which is not in the status byte.
+///
+/// Each change is stored as a DRV8461FaultEvent in a ring buffer of
+/// `Capacity` entries.  The monitor writes to it from whatever context talks
+/// to the driver (possibly an interrupt) and the application takes events out
+/// with pop(); the indices are lock-free atomics and nothing is allocated.  If
+/// the ring is full, new events are dropped and counted.
+///
+/// FAULT bits are latched until cleared.  After DRV8434S::clearFaults(), call
+/// refresh() so conditions that did not show in the status byte (SPI_ERR) are
+/// seen to go away.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461FaultMonitor<DRV8434SSPI> monitor(sd.driver, micros);
+/// monitor.attach();
+/// // ... later:
+/// DRV8461FaultEvent event;
+/// while (monitor.pop(event))
+/// {
+///   if (event.fault == DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OCP && event.active) { /* ... */ }
+/// }
+/// ~~~
+template <class Driver, uint8_t Capacity = 16>
+class DRV8461FaultMonitor
+{
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+  /// `clock` supplies the event timestamps (for example `micros` on Arduino).
+  DRV8461FaultMonitor(Driver & driver, uint32_t (*clock)()) : driver(driver), clock(clock)
+  {
+  }
+
+  /// Makes the driver pass every status byte to this monitor.
+  void attach()
+  {
+    driver.setStatusCallback(&DRV8461FaultMonitor::statusCallback, this);
+  }
+
+  /// Stops the driver from passing status bytes to this monitor.
+  void detach()
+  {
+    driver.setStatusCallback(nullptr);
+  }
+
+  /// Checks a status byte.  attach() arranges for this to be called after
+  /// every transfer; call it yourself only if the monitor is not attached.
+  ///
+  /// This only compares the byte with the previous one unless something
+  /// changed.
+  void observe(uint8_t status)
+  {
+    if (refreshing) { return; }
+    if ((status & 0xC0) != 0xC0 || (status & summaryMask) != (fault & summaryMask))
+    {
+      refresh();
+    }
+  }
+
+  /// Reads FAULT and DIAG1-3 from the driver and records any changes.
+  void refresh()
+  {
+    static const DRV8461RegOp ops[] = {
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_FAULT),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG1),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG2),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG3),
+    };
+    DRV8461RegResult results[4];
+    refreshing = true;
+    driver.transferBatch(ops, 4, results);
+    refreshing = false;
+    reads++;
+
+    uint32_t now = clock();
+    uint8_t changed = (fault ^ results[0].data) & eventMask;
+    for (uint8_t bit = 0x40; bit; bit >>= 1)
+    {
+      if (changed & bit)
+      {
+        push({ now, (DRV8461_FAULT_Reg_Val)bit, (bool)(results[0].data & bit) });
+      }
+    }
+
+    fault = results[0].data;
+    diag1 = results[1].data;
+    diag2 = results[2].data;
+    diag3 = results[3].data;
+  }
+
+  /// Takes the oldest event out of the ring.
+  ///
+  /// @return false if there are no events.
+  bool pop(DRV8461FaultEvent & event)
+  {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) { return false; }
+
+    event = events[t & (Capacity - 1)];
+    tail.store((uint8_t)(t + 1), std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of events waiting.
+  uint8_t pending() const
+  {
+    return (uint8_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+
+  /// Returns the FAULT value from the most recent register read.
+  uint8_t getFault() const { return fault; }
+
+  /// Returns the DIAG1 value from the most recent register read.
+  uint8_t getDiag1() const { return diag1; }
+
+  /// Returns the DIAG2 value from the most recent register read.
+  uint8_t getDiag2() const { return diag2; }
+
+  /// Returns the DIAG3 value from the most recent register read.
+  uint8_t getDiag3() const { return diag3; }
+
+  /// The number of times the monitor read the status registers itself.
+  uint32_t reads = 0;
+
+  /// The number of events lost because the ring was full.
+  uint32_t dropped = 0;
+
+private:
+
+  // The FAULT bits reported in the status byte.
+  static constexpr uint8_t summaryMask = 0x3F;
+
+  // The FAULT bits that generate events: everything except the FAULT summary
+  // bit, which just mirrors the others.
+  static constexpr uint8_t eventMask = 0x7F;
+
+  static void statusCallback(void * context, uint8_t status)
+  {
+    static_cast<DRV8461FaultMonitor *>(context)->observe(status);
+  }
+
+  void push(const DRV8461FaultEvent & event)
+  {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    if ((uint8_t)(h - tail.load(std::memory_order_acquire)) >= Capacity)
+    {
+      dropped++;
+      return;
+    }
+    events[h & (Capacity - 1)] = event;
+    head.store((uint8_t)(h + 1), std::memory_order_release);
+  }
+
+  Driver & driver;
+  uint32_t (*clock)();
+
+  uint8_t fault = 0;
+  uint8_t diag1 = 0;
+  uint8_t diag2 = 0;
+  uint8_t diag3 = 0;
+  bool refreshing = false;
+
+  DRV8461FaultEvent events[Capacity];
+
+  // Free-running indices; the difference is the number of stored events.
+  std::atomic<uint8_t> head{0};
+  std::atomic<uint8_t> tail{0};
+};
+
+
+#endif                                    // #ifndef DRV8461_FAULTMONITOR_H
@@ -0,0 +1,286 @@
+///Header File with typed register field accessors for DRV8461.
+
+#ifndef DRV8461_Field
+#define DRV8461_Field
+
+#include <cstdint>
+
+#include "DRV8461_Register_Address_Locations.h"
+
+// MASK HELPERS ******************************************************************************************************//
+
+/// Returns the position of the lowest set bit of a mask (8 for an empty mask).
+constexpr uint8_t DRV8461_maskShift(uint8_t mask)
+{
+  return (mask == 0) ? 8 : ((mask & 1) ? 0 : 1 + DRV8461_maskShift(mask >> 1));
+}
+
+/// Returns the number of set bits in a mask.
+constexpr uint8_t DRV8461_maskWidth(uint8_t mask)
+{
+  return (mask == 0) ? 0 : (mask & 1) + DRV8461_maskWidth(mask >> 1);
+}
+
+/// Returns true if the set bits of a mask are contiguous.
+constexpr bool DRV8461_maskContiguous(uint8_t mask)
+{
+  return mask != 0 && (((mask >> DRV8461_maskShift(mask)) + 1) & (mask >> DRV8461_maskShift(mask))) == 0;
+}
+
+// FIELDS ************************************************************************************************************//
+
+/// Describes a bit field within one register.  The shift is worked out from
+/// the mask at compile time, so every accessor is a single AND/OR (plus a
+/// constant shift), exactly like hand-written masking code.
+///
+/// `Value` is the type the field is read and written as: one of the
+/// DRV8461_* value enums, bool for single-bit flags, or uint8_t for plain
+/// numbers.  Passing a value of a different enum type is a compile error.
+///
+/// The accessors work either on a raw register byte or on a register file (an
+/// array of cached register values indexed by DRV8461_REG_ADDR, like the one
+/// in DRV8434S).
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// uint8_t ctrl1 = 0x0F;
+/// ctrl1 = DRV8461Fields::TOFF::insert(ctrl1, DRV8461_PWM_TOFF::DRV8461_TOFF_27US);
+/// DRV8461_Decay_Mode mode = DRV8461Fields::DECAY::extract(ctrl1);
+/// ~~~
+template <DRV8461_REG_ADDR Address, uint8_t Mask, typename ValueType = uint8_t>
+struct DRV8461Field
+{
+  static_assert(DRV8461_maskContiguous(Mask), "field mask must be a contiguous run of bits");
+
+  using Value = ValueType;
+
+  /// The register holding the field.  Single-register fields use the same
+  /// address for both, so code that handles wide fields can treat them alike.
+  static constexpr DRV8461_REG_ADDR address = Address;
+  static constexpr DRV8461_REG_ADDR highAddress = Address;
+
+  static constexpr uint8_t mask = Mask;
+  static constexpr uint8_t shift = DRV8461_maskShift(Mask);
+  static constexpr uint8_t width = DRV8461_maskWidth(Mask);
+
+  /// Returns the largest raw value the field can hold.
+  static constexpr uint8_t maxValue()
+  {
+    return Mask >> shift;
+  }
+
+  /// Returns the field's value within a raw register byte.
+  static constexpr Value extract(uint8_t raw)
+  {
+    return (Value)((raw & Mask) >> shift);
+  }
+
+  /// Returns the raw register byte with the field replaced by `value`.
+  static constexpr uint8_t insert(uint8_t raw, Value value)
+  {
+    return (uint8_t)((raw & (uint8_t)~Mask) | (((uint8_t)value << shift) & Mask));
+  }
+
+  /// Replaces the field in a raw register byte in place.
+  static constexpr void modify(uint8_t & raw, Value value)
+  {
+    raw = insert(raw, value);
+  }
+
+  /// Returns the field's value from a register file.
+  static constexpr Value get(const uint8_t * regs)
+  {
+    return extract(regs[(uint8_t)Address]);
+  }
+
+  /// Sets the field's value in a register file.
+  static constexpr void set(uint8_t * regs, Value value)
+  {
+    modify(regs[(uint8_t)Address], value);
+  }
+};
+
+/// Describes a number split across two registers, such as the 12-bit STALL_TH
+/// (low 8 bits in CTRL5, high 4 bits in CTRL6).  `Low` and `High` are
+/// DRV8461Field types for the two parts.
+template <typename Low, typename High, typename ValueType = uint16_t>
+struct DRV8461WideField
+{
+  static_assert(Low::width + High::width <= 8 * sizeof(ValueType), "value type too narrow for field");
+
+  using Value = ValueType;
+
+  static constexpr DRV8461_REG_ADDR address = Low::address;
+  static constexpr DRV8461_REG_ADDR highAddress = High::address;
+
+  static constexpr uint8_t width = Low::width + High::width;
+
+  /// Returns the largest value the field can hold.
+  static constexpr Value maxValue()
+  {
+    return (Value)(((uint32_t)1 << width) - 1);
+  }
+
+  /// Returns the field's value from the two raw register bytes.
+  static constexpr Value extract(uint8_t rawLow, uint8_t rawHigh)
+  {
+    return (Value)((Value)Low::extract(rawLow) | ((Value)High::extract(rawHigh) << Low::width));
+  }
+
+  /// Replaces the field in the two raw register bytes in place.
+  static constexpr void modify(uint8_t & rawLow, uint8_t & rawHigh, Value value)
+  {
+    Low::modify(rawLow, (typename Low::Value)(value & ((1 << Low::width) - 1)));
+    High::modify(rawHigh, (typename High::Value)(value >> Low::width));
+  }
+
+  /// Returns the field's value from a register file.
+  static constexpr Value get(const uint8_t * regs)
+  {
+    return extract(regs[(uint8_t)Low::address], regs[(uint8_t)High::address]);
+  }
+
+  /// Sets the field's value in a register file.
+  static constexpr void set(uint8_t * regs, Value value)
+  {
+    modify(regs[(uint8_t)Low::address], regs[(uint8_t)High::address], value);
+  }
+};
+
+// FIELD DEFINITIONS *************************************************************************************************//
+
+/// The fields of the DRV8461 control registers, built from the masks in
+/// DRV8461_Register_CTRL.h.
+struct DRV8461Fields
+{
+  using A = DRV8461_REG_ADDR;
+
+  // CONTROL 1
+  using EN_OUT         = DRV8461Field<A::DRV8461_REG_CTRL1, (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL1_EN_OUT, bool>;
+  using SR             = DRV8461Field<A::DRV8461_REG_CTRL1, (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL1_SR, bool>;
+  using IDX_RST        = DRV8461Field<A::DRV8461_REG_CTRL1, (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL1_IDX_RST, bool>;
+  using TOFF           = DRV8461Field<A::DRV8461_REG_CTRL1, (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL1_TOFF, DRV8461_PWM_TOFF>;
+  using DECAY          = DRV8461Field<A::DRV8461_REG_CTRL1, (uint8_t)DRV8461_CTRL1_Reg_Val::DRV8461_CTRL2_DECAY, DRV8461_Decay_Mode>;
+
+  // CONTROL 2
+  using DIR            = DRV8461Field<A::DRV8461_REG_CTRL2, (uint8_t)DRV8461_CTRL2_Reg_Val::DRV8461_CTRL2_DIR, bool>;
+  using STEP           = DRV8461Field<A::DRV8461_REG_CTRL2, (uint8_t)DRV8461_CTRL2_Reg_Val::DRV8461_CTRL2_STEP, bool>;
+  using SPI_DIR        = DRV8461Field<A::DRV8461_REG_CTRL2, (uint8_t)DRV8461_CTRL2_Reg_Val::DRV8461_CTRL2_SPI_DIR, bool>;
+  using SPI_STEP       = DRV8461Field<A::DRV8461_REG_CTRL2, (uint8_t)DRV8461_CTRL2_Reg_Val::DRV8461_CTRL2_SPI_STEP, bool>;
+  using MICROSTEP_MODE = DRV8461Field<A::DRV8461_REG_CTRL2, (uint8_t)DRV8461_CTRL2_Reg_Val::DRV8461_CTRL2_MICROSTEP_MODE, DRV8461_Micostep_Mode>;
+
+  // CONTROL 3
+  using CLR_FLT        = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_CLR_FLT, bool>;
+  using LOCK           = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_LOCK>;
+  using TOCP           = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_TOCP, bool>;
+  using OCP_MODE       = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_OCP_MODE, bool>;
+  using OTSD_MODE      = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_OTSD_MODE, bool>;
+  using TW_REP         = DRV8461Field<A::DRV8461_REG_CTRL3, (uint8_t)DRV8461_CTRL3_Reg_Val::DRV8461_CTRL3_TW_REP, bool>;
+
+  // CONTROL 4
+  using STL_LRN        = DRV8461Field<A::DRV8461_REG_CTRL4, (uint8_t)DRV8461_CTRL4_Reg_Val::DRV8461_CTRL4_STL_LRN, bool>;
+  using EN_STL         = DRV8461Field<A::DRV8461_REG_CTRL4, (uint8_t)DRV8461_CTRL4_Reg_Val::DRV8461_CTRL4_EN_STL, bool>;
+  using STL_REP        = DRV8461Field<A::DRV8461_REG_CTRL4, (uint8_t)DRV8461_CTRL4_Reg_Val::DRV8461_CTRL4_STL_REP, bool>;
+  using STEP_FRQ_TOL   = DRV8461Field<A::DRV8461_REG_CTRL4, (uint8_t)DRV8461_CTRL4_Reg_Val::DRV8461_CTRL4_STEP_FRQ_TOL, DRV8461_Step_Frequency>;
+
+  // CONTROL 5 and 6
+  using STALL_TH_LOW   = DRV8461Field<A::DRV8461_REG_CTRL5, (uint8_t)DRV8461_CTRL5_Reg_Val::DRV8461_CTRL5_STALL_TH>;
+  using RC_RIPPLE      = DRV8461Field<A::DRV8461_REG_CTRL6, (uint8_t)DRV8461_CTRL6_Reg_Val::DRV8461_CTRL6_RC_RIPPLE, DRV8461_RC_Ripple>;
+  using EN_SSC         = DRV8461Field<A::DRV8461_REG_CTRL6, (uint8_t)DRV8461_CTRL6_Reg_Val::DRV8461_CTRL6_EN_SSC, bool>;
+  using TRQ_SCALE      = DRV8461Field<A::DRV8461_REG_CTRL6, (uint8_t)DRV8461_CTRL6_Reg_Val::DRV8461_CTRL6_TRQ_SCALE, bool>;
+  using STALL_TH_HIGH  = DRV8461Field<A::DRV8461_REG_CTRL6, (uint8_t)DRV8461_CTRL6_Reg_Val::DRV8461_CTRL6_STL_REP>;
+  using STALL_TH       = DRV8461WideField<STALL_TH_LOW, STALL_TH_HIGH>;
+
+  // CONTROL 7 and 8
+  using TRQ_COUNT_LOW  = DRV8461Field<A::DRV8461_REG_CTRL7, (uint8_t)DRV8461_CTRL7_Reg_Val::DRV8461_CTRL7_TRQ_COUNT>;
+  using TRQ_COUNT_HIGH = DRV8461Field<A::DRV8461_REG_CTRL8, (uint8_t)DRV8461_CTRL8_Reg_Val::DRV8461_CTRL8_TRQ_SCALE>;
+  using TRQ_COUNT      = DRV8461WideField<TRQ_COUNT_LOW, TRQ_COUNT_HIGH>;
+
+  // CONTROL 9
+  using EN_OL          = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_EN_OL, bool>;
+  using OL_MODE        = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_OL_MODE, bool>;
+  using OL_T           = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_OL_T, DRV8461_Open_Load_Detection_Time>;
+  using STEP_EDGE      = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_STEP_EDGE, bool>;
+  using RES_AUTO       = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_RES_AUTO, DRV8461_Auto_Microstep>;
+  using EN_AUTO        = DRV8461Field<A::DRV8461_REG_CTRL9, (uint8_t)DRV8461_CTRL9_Reg_Val::DRV8461_CTRL9_EN_AUTO, bool>;
+
+  // CONTROL 10 and 11
+  using ISTSL          = DRV8461Field<A::DRV8461_REG_CTRL10, (uint8_t)DRV8461_CTRL10_Reg_Val::DRV8461_CTRL10_ISTSL, DRV8461_Holding_Current>;
+  using TRQ_DAC        = DRV8461Field<A::DRV8461_REG_CTRL11, (uint8_t)DRV8461_CTRL11_Reg_Val::DRV8461_CTRL11_TRQ_DAC, DRV_Run_Current>;
+
+  // CONTROL 12 and 13
+  using EN_STSL        = DRV8461Field<A::DRV8461_REG_CTRL12, (uint8_t)DRV8461_CTRL12_Reg_Val::DRV8461_CTRL12_EN_STSL, bool>;
+  using TSTSL_FALL     = DRV8461Field<A::DRV8461_REG_CTRL12, (uint8_t)DRV8461_CTRL12_Reg_Val::DRV8461_CTRL12_TSTSL_FALL, DRV8461_Current_Reduction_Time>;
+  using TSTSL_DLY      = DRV8461Field<A::DRV8461_REG_CTRL13, (uint8_t)DRV8461_CTRL13_Reg_Val::DRV8461_CTRL13_TSTSL_DLY, DRV8461_Delay_Until_Standstill>;
+  using VREF_INT_EN    = DRV8461Field<A::DRV8461_REG_CTRL13, (uint8_t)DRV8461_CTRL13_Reg_Val::DRV8461_CTRL13_VREF_INT_EN, bool>;
+
+  // CONTROL 14
+  using VM_ADC         = DRV8461Field<A::DRV8461_REG_CTRL14, (uint8_t)DRV8461_CTRL14_Reg_Val::DRV8461_CTRL14_VM_ADC>;
+
+  // CUSTOM CONTROL 1 to 9
+  using EN_CUSTOM      = DRV8461Field<A::DRV8461_REG_CUSTOM_CTRL1, (uint8_t)DRV8461_CUSTOM_CTRL1_Reg_Val::DRV8461_CUSTOM_CTRL1_EN_CUSTOM, bool>;
+  template <uint8_t N>
+  using CUSTOM_CURRENT = DRV8461Field<(A)((uint8_t)A::DRV8461_REG_CUSTOM_CTRL2 + N - 1), (uint8_t)DRV8461_CUSTOM_CTRLn_Reg_Val::DRV8461_CUSTOM_CTRLn_CUSTOM_CURRENT>;
+
+  // ATQ CONTROL 1 to 9
+  using ATQ_CNT_LOW    = DRV8461Field<A::DRV8461_REG_ATQ_CTRL1, (uint8_t)DRV8461_ATQ_CTRL1_Reg_Val::DRV8461_ATQ_CTRL1_ATQ_CNT>;
+  using ATQ_CNT_HIGH   = DRV8461Field<A::DRV8461_REG_ATQ_CTRL2, (uint8_t)DRV8461_ATQ_CTRL2_Reg_Val::DRV8461_ATQ_CTRL2_ATQ_CNT>;
+  using ATQ_CNT        = DRV8461WideField<ATQ_CNT_LOW, ATQ_CNT_HIGH>;
+  using ATQ_UL         = DRV8461Field<A::DRV8461_REG_ATQ_CTRL3, (uint8_t)DRV8461_ATQ_CTRL3_Reg_Val::DRV8461_ATQ_CTRL3_ATQ_UL>;
+  using ATQ_LL         = DRV8461Field<A::DRV8461_REG_ATQ_CTRL4, (uint8_t)DRV8461_ATQ_CTRL4_Reg_Val::DRV8461_ATQ_CTRL4_ATQ_LL>;
+  using KP             = DRV8461Field<A::DRV8461_REG_ATQ_CTRL5, (uint8_t)DRV8461_ATQ_CTRL5_Reg_Val::DRV8461_ATQ_CTRL5_KP>;
+  using KD             = DRV8461Field<A::DRV8461_REG_ATQ_CTRL6, (uint8_t)DRV8461_ATQ_CTRL6_Reg_Val::DRV8461_ATQ_CTRL6_KD>;
+  using ATQ_TRQ_MIN    = DRV8461Field<A::DRV8461_REG_ATQ_CTRL7, (uint8_t)DRV8461_ATQ_CTRL7_Reg_Val::DRV8461_ATQ_CTRL7_ATQ_TRQ_MIN>;
+  using ATQ_TRQ_MAX    = DRV8461Field<A::DRV8461_REG_ATQ_CTRL8, (uint8_t)DRV8461_ATQ_CTRL8_Reg_Val::DRV8461_ATQ_CTRL8_ATQ_TRQ_MAX>;
+  using ATQ_D_THR      = DRV8461Field<A::DRV8461_REG_ATQ_CTRL9, (uint8_t)DRV8461_ATQ_CTRL9_Reg_Val::DRV8461_ATQ_CTRL9_ATQ_D_THR>;
+
+  // ATQ CONTROL 10
+  using ATQ_EN         = DRV8461Field<A::DRV8461_REG_ATQ_CTRL10, (uint8_t)DRV8461_ATQ_CTRL10_Reg_Val::DRV8461_ATQ_CTRL10_ATQ_EN, bool>;
+  using LRN_START      = DRV8461Field<A::DRV8461_REG_ATQ_CTRL10, (uint8_t)DRV8461_ATQ_CTRL10_Reg_Val::DRV8461_ATQ_CTRL10_LRN_START, bool>;
+  using ATQ_LRN_DONE   = DRV8461Field<A::DRV8461_REG_ATQ_CTRL10, (uint8_t)DRV8461_ATQ_CTRL10_Reg_Val::DRV8461_ATQ_CTRL10_ATQ_LRN_DONE, bool>;
+  using ATQ_AVG        = DRV8461Field<A::DRV8461_REG_ATQ_CTRL10, (uint8_t)DRV8461_ATQ_CTRL10_Reg_Val::DRV8461_ATQ_CTRL10_ATQ_AVG, bool>;
+  using ATQ_FRZ        = DRV8461Field<A::DRV8461_REG_ATQ_CTRL10, (uint8_t)DRV8461_ATQ_CTRL10_Reg_Val::DRV8461_ATQ_CTRL10_ATQ_FRZ>;
+
+  // ATQ CONTROL 11 to 18
+  using ATQ_LRN_MIN_CURRENT = DRV8461Field<A::DRV8461_REG_ATQ_CTRL11, (uint8_t)DRV8461_ATQ_CTRL11_Reg_Val::DRV8461_ATQ_CTRL11_ATQ_LRN_MIN_CURRENT>;
+  using LRN_CONST1_LOW = DRV8461Field<A::DRV8461_REG_ATQ_CTRL12, (uint8_t)DRV8461_ATQ_CTRL12_Reg_Val::DRV8461_ATQ_CTRL12_LRN_CONST1>;
+  using LRN_CONST1_HIGH = DRV8461Field<A::DRV8461_REG_ATQ_CTRL13, (uint8_t)DRV8461_ATQ_CTRL13_Reg_Val::DRV8461_ATQ_CTRL13_LRN_CONST1>;
+  using LRN_CONST1     = DRV8461WideField<LRN_CONST1_LOW, LRN_CONST1_HIGH>;
+  using LRN_CONST2_LOW = DRV8461Field<A::DRV8461_REG_ATQ_CTRL14, (uint8_t)DRV8461_ATQ_CTRL14_Reg_Val::DRV8461_ATQ_CTRL14_LRN_CONST2>;
+  using LRN_CONST2_HIGH = DRV8461Field<A::DRV8461_REG_ATQ_CTRL15, (uint8_t)DRV8461_ATQ_CTRL15_Reg_Val::DRV8461_ATQ_CTRL15_LRN_CONST2>;
+  using LRN_CONST2     = DRV8461WideField<LRN_CONST2_LOW, LRN_CONST2_HIGH>;
+  using LRN_CYCLE_SELECT = DRV8461Field<A::DRV8461_REG_ATQ_CTRL16, (uint8_t)DRV8461_ATQ_CTRL16_Reg_Val::DRV8461_ATQ_CTRL16_LRN_CYCLE_SELECT, DRV8461_ATQ_Learn_Cycles>;
+  using LRN_STEP       = DRV8461Field<A::DRV8461_REG_ATQ_CTRL16, (uint8_t)DRV8461_ATQ_CTRL16_Reg_Val::DRV8461_ATQ_CTRL16_LRN_STEP, DRV8461_ATQ_Learn_Step>;
+  using ATQ_ERROR_TRUNCATE = DRV8461Field<A::DRV8461_REG_ATQ_CTRL17, (uint8_t)DRV8461_ATQ_CTRL17_Reg_Val::DRV8461_ATQ_CTRL17_ATQ_ERROR_TRUNCATE>;
+  using ATQ_VM_SCALE   = DRV8461Field<A::DRV8461_REG_ATQ_CTRL18, (uint8_t)DRV8461_ATQ_CTRL18_Reg_Val::DRV8461_ATQ_CTRL18_ATQ_VM_SCALE>;
+
+  // SS CONTROL 1 to 5
+  using SS_SMPL_SEL    = DRV8461Field<A::DRV8461_REG_SS_CTRL1, (uint8_t)DRV8461_SS_CTRL1_Reg_Val::DRV8461_SS_CTRL1_SS_SMPL_SEL, DRV8461_SS_Sampling>;
+  using EN_SS          = DRV8461Field<A::DRV8461_REG_SS_CTRL1, (uint8_t)DRV8461_SS_CTRL1_Reg_Val::DRV8461_SS_CTRL1_EN_SS, bool>;
+  using SS_KP          = DRV8461Field<A::DRV8461_REG_SS_CTRL2, (uint8_t)DRV8461_SS_CTRL2_Reg_Val::DRV8461_SS_CTRL2_SS_KP>;
+  using SS_KI          = DRV8461Field<A::DRV8461_REG_SS_CTRL3, (uint8_t)DRV8461_SS_CTRL3_Reg_Val::DRV8461_SS_CTRL3_SS_KI>;
+  using SS_KI_DIV_SEL  = DRV8461Field<A::DRV8461_REG_SS_CTRL4, (uint8_t)DRV8461_SS_CTRL4_Reg_Val::DRV8461_SS_CTRL4_SS_KI_DIV_SEL>;
+  using SS_KP_DIV_SEL  = DRV8461Field<A::DRV8461_REG_SS_CTRL4, (uint8_t)DRV8461_SS_CTRL4_Reg_Val::DRV8461_SS_CTRL4_SS_KP_DIV_SEL>;
+  using SS_THR         = DRV8461Field<A::DRV8461_REG_SS_CTRL5, (uint8_t)DRV8461_SS_CTRL5_Reg_Val::DRV8461_SS_CTRL5_SS_THR>;
+};
+
+static_assert(DRV8461Fields::TOFF::shift == 3 && DRV8461Fields::RES_AUTO::shift == 1, "field shifts are derived from masks");
+static_assert(DRV8461Fields::STALL_TH::width == 12 && DRV8461Fields::TRQ_COUNT::width == 12, "STALL_TH and TRQ_COUNT are 12 bits");
+static_assert(DRV8461Fields::STALL_TH::extract(0x03, 0x20) == 3, "STALL_TH ignores the other CTRL6 bits");
+static_assert(DRV8461Fields::ATQ_CNT::width == 11 && DRV8461Fields::LRN_CONST1::width == 10, "ATQ_CNT is 11 bits, LRN_CONST1/2 are 10 bits");
+static_assert(DRV8461Fields::DECAY::insert(0x0F, DRV8461_Decay_Mode::DRV8461_DECAY_SLOW_SLOW) == 0x08, "DECAY is CTRL1[2:0]");
+
+/// Sets and reads back fields in a register file, to check that get() and
+/// set() work in constant expressions.
+constexpr bool DRV8461_checkFieldAccess()
+{
+  uint8_t regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL6 + 1] = {};
+  DRV8461Fields::STALL_TH::set(regs, 0x2BC);
+  DRV8461Fields::DECAY::set(regs, DRV8461_Decay_Mode::DRV8461_DECAY_SLOW_SLOW);
+  return DRV8461Fields::STALL_TH::get(regs) == 0x2BC &&
+    DRV8461Fields::DECAY::get(regs) == DRV8461_Decay_Mode::DRV8461_DECAY_SLOW_SLOW;
+}
+
+static_assert(DRV8461_checkFieldAccess(), "fields can be set and read at compile time");
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef DRV8461_INSTRUMENTATION_H
+#define DRV8461_INSTRUMENTATION_H
+
+/*  DRV8461_Instrumentation.h
+
+    Optional counters and latency histograms for the SPI traffic of a
+    BasicDRV8434SSPI.
+
+*/
+#pragma once
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <chrono>
+#endif
+
+#include "DRV8461_Registers.h"
+
+
+// CYCLE COUNTERS ****************************************************************************************************//
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+
+/// A clock for DRV8461BusStats that reads the Cortex-M DWT cycle counter.
+/// Call enable() once at startup; some debuggers enable it too.
+struct DRV8461DwtClock
+{
+  static void enable()
+  {
+    *(volatile uint32_t *)0xE000EDFC |= 1UL << 24;   // DEMCR.TRCENA
+    *(volatile uint32_t *)0xE0001004 = 0;            // DWT_CYCCNT
+    *(volatile uint32_t *)0xE0001000 |= 1;           // DWT_CTRL.CYCCNTENA
+  }
+
+  static uint32_t now()
+  {
+    return *(volatile uint32_t *)0xE0001004;
+  }
+};
+
+#endif
+
+#if defined(__linux__)
+
+/// A clock for DRV8461BusStats that counts nanoseconds of
+/// std::chrono::steady_clock.
+struct DRV8461SteadyClock
+{
+  static uint32_t now()
+  {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+#endif
+
+
+// STATISTICS ********************************************************************************************************//
+
+/// The number of latency histogram buckets.  Bucket 0 counts transactions
+/// that took 0 ticks and bucket n those that took 2^(n-1) to 2^n - 1 ticks.
+static const uint8_t DRV8461_LATENCY_BUCKETS = 33;
+
+/// A copy of the counters of a DRV8461BusStats, taken by snapshot().
+struct DRV8461BusStatsSnapshot
+{
+  /// Reads and writes of each register address.
+  uint32_t reads[DRV8461_REG_ADDR_COUNT];
+  uint32_t writes[DRV8461_REG_ADDR_COUNT];
+
+  /// Transfers (bus acquisitions), frames and bytes in total.
+  uint32_t transactions;
+  uint32_t frames;
+  uint32_t bytes;
+
+  /// Transfer latencies in clock ticks, log2-bucketed (see
+  /// DRV8461_LATENCY_BUCKETS), and the largest one.
+  uint32_t latency[DRV8461_LATENCY_BUCKETS];
+  uint32_t latencyMax;
+
+  /// Returns the number of bytes exchanged with a register.
+  uint32_t bytesAt(DRV8461_REG_ADDR address) const
+  {
+    return 2 * (reads[(uint8_t)address] + writes[(uint8_t)address]);
+  }
+
+  /// Returns the smallest latency (in ticks) that at least `percent` percent
+  /// of the transfers stayed under, to within the resolution of the buckets.
+  uint32_t latencyPercentile(uint8_t percent) const
+  {
+    uint64_t target = ((uint64_t)transactions * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t b = 0; b < DRV8461_LATENCY_BUCKETS; b++)
+    {
+      seen += latency[b];
+      if (seen >= target && seen)
+      {
+        uint32_t bound = b ? (uint32_t)(((uint64_t)1 << b) - 1) : 0;
+        return bound < latencyMax ? bound : latencyMax;
+      }
+    }
+    return latencyMax;
+  }
+};
+
+
+/// A statistics class for BasicDRV8434SSPI (see DRV8461NoStats) that counts
+/// reads and writes per register address and keeps a histogram of how long
+/// each transfer took, measured with `Clock::now()` (for example
+/// DRV8461DwtClock or DRV8461SteadyClock).
+///
+/// The counters are relaxed atomics, so transfers may be made from
+/// interrupts and other threads while snapshot() copies them; each counter
+/// is exact, but a snapshot taken during a transfer may show some counters
+/// of that transfer updated and others not yet.  On Cortex-M3 and up each
+/// update is a short LDREX/STREX sequence with no locking.
+///
+/// Only transfers made through the BasicDRV8434SSPI are counted.  Chained
+/// frames sent by BasicDRV8461DaisyChain go straight to its own bus and are
+/// not in these counters, although their status bytes still reach each
+/// device's reportStatus().
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// BasicDRV8434S<DRV8461ArduinoBus, DRV8461BusStats<DRV8461DwtClock>> sd;
+/// DRV8461DwtClock::enable();
+/// // ...
+/// DRV8461BusStatsSnapshot s;
+/// sd.driver.stats.snapshot(s);
+/// Serial.println(s.latencyPercentile(99));
+/// ~~~
+template <class Clock>
+class DRV8461BusStats
+{
+public:
+  DRV8461BusStats()
+  {
+    reset();
+  }
+
+  uint32_t start(const uint8_t * frames, uint8_t count)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      uint8_t command = frames[2 * i];
+      std::atomic<uint32_t> * counter = DRV8461_commandIsRead(command) ? reads : writes;
+      counter[DRV8461_commandAddress(command)].fetch_add(1, std::memory_order_relaxed);
+    }
+    return Clock::now();
+  }
+
+  void finish(uint32_t started)
+  {
+    uint32_t elapsed = Clock::now() - started;
+    latency[bucket(elapsed)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t max = latencyMax.load(std::memory_order_relaxed);
+    while (elapsed > max && !latencyMax.compare_exchange_weak(max, elapsed, std::memory_order_relaxed)) {}
+  }
+
+  /// Copies the counters into `s` without stopping the bus.
+  ///
+  /// The totals are added up here rather than counted separately, to keep
+  /// the per-transfer cost down.
+  void snapshot(DRV8461BusStatsSnapshot & s) const
+  {
+    s.frames = 0;
+    for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++)
+    {
+      s.reads[a] = reads[a].load(std::memory_order_relaxed);
+      s.writes[a] = writes[a].load(std::memory_order_relaxed);
+      s.frames += s.reads[a] + s.writes[a];
+    }
+    s.bytes = 2 * s.frames;
+    s.transactions = 0;
+    for (uint8_t b = 0; b < DRV8461_LATENCY_BUCKETS; b++)
+    {
+      s.latency[b] = latency[b].load(std::memory_order_relaxed);
+      s.transactions += s.latency[b];
+    }
+    s.latencyMax = latencyMax.load(std::memory_order_relaxed);
+  }
+
+  /// Sets every counter to 0.  Transfers made meanwhile may be partly
+  /// counted.
+  void reset()
+  {
+    for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++)
+    {
+      reads[a].store(0, std::memory_order_relaxed);
+      writes[a].store(0, std::memory_order_relaxed);
+    }
+    for (uint8_t b = 0; b < DRV8461_LATENCY_BUCKETS; b++)
+    {
+      latency[b].store(0, std::memory_order_relaxed);
+    }
+    latencyMax.store(0, std::memory_order_relaxed);
+  }
+
+private:
+
+  /// Returns the number of significant bits in `ticks`.
+  static uint8_t bucket(uint32_t ticks)
+  {
+#if defined(__GNUC__)
+    return ticks ? 32 - __builtin_clz(ticks) : 0;
+#else
+    uint8_t b = 0;
+    while (ticks) { ticks >>= 1; b++; }
+    return b;
+#endif
+  }
+
+  std::atomic<uint32_t> reads[DRV8461_REG_ADDR_COUNT];
+  std::atomic<uint32_t> writes[DRV8461_REG_ADDR_COUNT];
+  std::atomic<uint32_t> latency[DRV8461_LATENCY_BUCKETS];
+  std::atomic<uint32_t> latencyMax;
+};
+
+
+#endif                                    // #ifndef DRV8461_INSTRUMENTATION_H
@@ -0,0 +1,328 @@
+#ifndef DRV8461_LINKTUNER_H
+#define DRV8461_LINKTUNER_H
+
+/*  DRV8461_LinkTuner.h
+
+    Finds the fastest reliable SPI clock for a DRV8461 and backs it off when
+    errors appear.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// Error counters for one SPI link, kept by DRV8461LinkTuner.
+struct DRV8461LinkStats
+{
+  /// The clock frequency currently in use.
+  uint32_t clockHz = 0;
+
+  /// The fastest clock at which calibration saw no errors.
+  uint32_t fastestGoodHz = 0;
+
+  /// Frames checked, by calibration or by checkStatus().
+  uint32_t framesChecked = 0;
+
+  /// Frames whose status byte did not have its upper two bits set.
+  uint32_t statusErrors = 0;
+
+  /// Times SPI_ERR was found set in the FAULT register.
+  uint32_t spiErrors = 0;
+
+  /// Writes whose old-data byte did not match the value written before.
+  uint32_t echoErrors = 0;
+
+  /// Reads that did not return the value just written.
+  uint32_t readbackErrors = 0;
+
+  /// The number of times the clock was lowered because of errors.
+  uint8_t backoffs = 0;
+
+  /// The last FAULT value in which SPI_ERR was latched together with other
+  /// faults.  The tuner only clears SPI_ERR when it is alone, so these are
+  /// left for the application to handle and clear; 0 if there were none.
+  uint8_t unclearedFault = 0;
+};
+
+
+/// This class raises the SPI clock of a BasicDRV8434SSPI step by step to find
+/// the fastest one that works reliably, then runs the link a safety margin
+/// below that.
+///
+/// At each step, calibrate() writes a series of test patterns to a scratch
+/// register and checks three things on every frame: the status byte has its
+/// upper two bits set, the old-data byte returned by each write matches the
+/// pattern written before it, and reading the register back returns the
+/// pattern just written.  It then reads FAULT to check SPI_ERR, which is not
+/// part of the status byte.  The first step with any error ends the search.
+///
+/// The scratch register defaults to CUSTOM_CTRL9, which only matters while a
+/// custom microstep table is enabled; its original value is restored
+/// afterwards.  The bus must provide setClock() (see DRV8461ArduinoBus).
+///
+/// After calibration, attach() makes the driver pass the status byte of
+/// every frame to the tuner, so it watches the traffic the application makes
+/// anyway.  When a status byte comes back damaged, the tuner lowers the clock
+/// by one step on its own, reads FAULT at the new clock and counts SPI_ERR.
+/// FAULT values the application reads itself can be passed to checkFault().
+///
+/// Clearing faults clears every latched fault, and clearing OCP can turn the
+/// outputs back on into a short (see DRV8434S::clearFaults()).  The tuner
+/// therefore only clears SPI_ERR, in calibrate() and after a damaged frame,
+/// when it is the only fault latched; otherwise it records the FAULT value in
+/// DRV8461LinkStats::unclearedFault and leaves the clearing to the
+/// application.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461LinkTuner<DRV8434SSPI> tuner(sd.driver);
+/// uint32_t hz = tuner.calibrate(500000, 10000000);
+/// tuner.attach();
+/// ~~~
+template <class Driver>
+class DRV8461LinkTuner
+{
+public:
+  explicit DRV8461LinkTuner(Driver & driver) : driver(driver)
+  {
+  }
+
+  /// Selects the register used for the test patterns.  It must be a register
+  /// whose bits are all writable and whose contents do not matter while
+  /// calibrating.
+  void setScratchRegister(DRV8461_REG_ADDR address)
+  {
+    scratch = address;
+  }
+
+  /// Sets how much each step raises the clock, in percent (default 25%).
+  void setStepPercent(uint8_t percent)
+  {
+    stepPercent = percent ? percent : 1;
+  }
+
+  /// Sets how far below the fastest good clock the link should run, in
+  /// percent (default 20%).
+  void setSafetyMargin(uint8_t percent)
+  {
+    marginPercent = percent < 100 ? percent : 99;
+  }
+
+  /// Sets how many patterns are written and read back at each step (default
+  /// 32).
+  void setTrialsPerStep(uint16_t trials)
+  {
+    trialsPerStep = trials ? trials : 1;
+  }
+
+  /// Makes the driver pass the status byte of every frame to observe().  This
+  /// replaces any other status callback (such as a DRV8461FaultMonitor's); to
+  /// use both, call their observe() functions from one callback.
+  void attach()
+  {
+    driver.setStatusCallback(&DRV8461LinkTuner::statusCallback, this);
+  }
+
+  /// Stops the driver from passing status bytes to this tuner.
+  void detach()
+  {
+    driver.setStatusCallback(nullptr);
+  }
+
+  /// Checks the status byte of a frame, as checkStatus() does.  If it is
+  /// damaged, the clock is lowered one step and FAULT is read at the new
+  /// clock: SPI_ERR is counted, and cleared if it is the only fault latched.
+  /// Status bytes seen while calibrate() runs are ignored.
+  void observe(uint8_t status)
+  {
+    if (calibrating || checkStatus(status)) { return; }
+
+    uint8_t fault = driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+    if (fault & (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR)
+    {
+      stats.spiErrors++;
+      clearSpiError(fault);
+    }
+  }
+
+  /// Searches upward from `startHz` (which should be known to work) to at
+  /// most `maxHz` and sets the bus to the chosen clock.
+  ///
+  /// The SPI_ERR flag the failing step leaves is cleared if no other fault
+  /// is latched (see above).
+  ///
+  /// @return The chosen clock, or 0 if even `startHz` produced errors (the
+  /// bus is then left at `startHz`).
+  uint32_t calibrate(uint32_t startHz, uint32_t maxHz)
+  {
+    calibrating = true;
+    setClock(startHz);
+    uint8_t original = driver.readReg(scratch);
+
+    uint32_t good = 0;
+    for (uint32_t hz = startHz; hz <= maxHz; )
+    {
+      setClock(hz);
+      if (!runTrials()) { break; }
+      good = hz;
+
+      uint32_t next = hz + hz / 100 * stepPercent;
+      if (next <= hz) { break; }
+      hz = (next > maxHz && hz < maxHz) ? maxHz : next;
+    }
+
+    // Restore the scratch register at a speed known to work, and clear the
+    // SPI_ERR flag left by the failing step.
+    setClock(startHz);
+    driver.writeReg(scratch, original);
+    clearSpiError(driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_FAULT));
+    calibrating = false;
+
+    stats.fastestGoodHz = good;
+    if (!good) { return 0; }
+
+    uint32_t chosen = good - good / 100 * marginPercent;
+    if (chosen < startHz) { chosen = startHz; }
+    floorHz = startHz;
+    setClock(chosen);
+    return chosen;
+  }
+
+  /// Checks a status byte returned by the driver and counts it as an error if
+  /// its upper two bits are not both set.  On an error the clock is lowered by
+  /// one step, but not below the calibration start frequency.
+  ///
+  /// @return true if the status byte was good.
+  bool checkStatus(uint8_t status)
+  {
+    stats.framesChecked++;
+    if (statusOk(status)) { return true; }
+
+    stats.statusErrors++;
+    stepDown();
+    return false;
+  }
+
+  /// Checks a FAULT register value for SPI_ERR and lowers the clock by one
+  /// step if it is set.
+  ///
+  /// SPI_ERR is latched in the driver, so clear it (DRV8434S::clearFaults())
+  /// after handling it or the next FAULT read will report it again.
+  ///
+  /// @return true if SPI_ERR was clear.
+  bool checkFault(uint8_t fault)
+  {
+    if (!(fault & (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR)) { return true; }
+
+    stats.spiErrors++;
+    stepDown();
+    return false;
+  }
+
+  /// Returns the link's error counters.
+  const DRV8461LinkStats & getStats() const
+  {
+    return stats;
+  }
+
+  /// Sets all of the error counters back to 0.
+  void resetStats()
+  {
+    DRV8461LinkStats fresh;
+    fresh.clockHz = stats.clockHz;
+    fresh.fastestGoodHz = stats.fastestGoodHz;
+    stats = fresh;
+  }
+
+private:
+
+  static bool statusOk(uint8_t status)
+  {
+    return (status & 0xC0) == 0xC0;
+  }
+
+  static void statusCallback(void * context, uint8_t status)
+  {
+    static_cast<DRV8461LinkTuner *>(context)->observe(status);
+  }
+
+  /// Clears SPI_ERR if it is the only fault in `fault` (a FAULT value);
+  /// otherwise records `fault` and leaves it latched.  The FAULT bit itself
+  /// only summarizes the others.
+  void clearSpiError(uint8_t fault)
+  {
+    const uint8_t spiErr = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR;
+    const uint8_t summary = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT;
+    if (!(fault & spiErr)) { return; }
+    if (fault & ~(spiErr | summary))
+    {
+      stats.unclearedFault = fault;
+      return;
+    }
+    uint8_t ctrl3 = driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL3);
+    driver.writeReg((uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL3, DRV8461Fields::CLR_FLT::insert(ctrl3, true));
+  }
+
+  void stepDown()
+  {
+    uint32_t lower = stats.clockHz - stats.clockHz / (100 + stepPercent) * stepPercent;
+    if (lower < floorHz) { lower = floorHz; }
+    if (lower != stats.clockHz)
+    {
+      setClock(lower);
+      stats.backoffs++;
+    }
+  }
+
+  void setClock(uint32_t hz)
+  {
+    driver.bus.setClock(hz);
+    stats.clockHz = hz;
+  }
+
+  /// Writes and reads back patterns at the current clock.
+  ///
+  /// @return true if no errors were seen.
+  bool runTrials()
+  {
+    static const uint8_t patterns[] = { 0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC };
+
+    bool ok = true;
+    uint8_t previous = driver.readReg(scratch);
+    if (!statusOk(driver.lastStatus)) { ok = false; }
+
+    for (uint16_t i = 0; i < trialsPerStep; i++)
+    {
+      uint8_t pattern = patterns[i % sizeof(patterns)] ^ (uint8_t)i;
+
+      uint8_t old = driver.writeReg((uint8_t)scratch, pattern);
+      stats.framesChecked++;
+      if (!statusOk(driver.lastStatus)) { stats.statusErrors++; ok = false; }
+      if (old != previous) { stats.echoErrors++; ok = false; }
+
+      uint8_t readback = driver.readReg(scratch);
+      stats.framesChecked++;
+      if (!statusOk(driver.lastStatus)) { stats.statusErrors++; ok = false; }
+      if (readback != pattern) { stats.readbackErrors++; ok = false; }
+
+      previous = pattern;
+    }
+
+    uint8_t fault = driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+    if (fault & (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR) { stats.spiErrors++; ok = false; }
+    return ok;
+  }
+
+  Driver & driver;
+  DRV8461_REG_ADDR scratch = DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL9;
+  uint8_t stepPercent = 25;
+  uint8_t marginPercent = 20;
+  uint16_t trialsPerStep = 32;
+  uint32_t floorHz = 0;
+  bool calibrating = false;
+  DRV8461LinkStats stats;
+};
+
+
+#endif                                    // #ifndef DRV8461_LINKTUNER_H
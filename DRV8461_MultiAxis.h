@@ -0,0 +1,452 @@
+#ifndef DRV8461_MULTIAXIS_H
+#define DRV8461_MULTIAXIS_H
+
+/*  DRV8461_MultiAxis.h
+
+    Coordinated linear and arc moves over several DRV8461 drivers from one
+    step timebase, with SPI maintenance traffic kept between step events.
+
+*/
+#pragma once
+
+#include <math.h>
+
+#include "DRV8461_StepEngine.h"
+
+
+/// This class moves up to `MaxAxes` (at most 32) axes together, each driven
+/// by its own DRV8461 through its STEP and DIR pins.
+///
+/// A single DRV8461StepEngine generates the timebase: one tick per step of
+/// the axis that moves furthest (the dominant axis), with that engine's
+/// trapezoidal or S-curve ramps.  On every tick an integer DDA (Bresenham)
+/// decides which of the other axes step too, and all of them are pulsed
+/// together with one call to the Hal.  Every axis therefore steps on the same
+/// clock, and no axis is ever more than one tick away from its ideal step
+/// time; there is no per-axis timer whose interrupts could delay each other.
+///
+/// Arcs are split into short chords when they are planned (the only place
+/// floating point is used) and the chords are walked one after another
+/// without stopping.  Speeds are given in steps/s of the dominant axis.
+///
+/// The pins and the timer are reached through `Hal`, which must provide:
+///
+/// ~~~{.cpp}
+/// void pulseSteps(uint32_t axes);           // pulse STEP on every axis whose bit is set
+/// void writeDir(uint8_t axis, bool level);  // drive the DIR pin of one axis
+/// void startTimer(uint32_t ticks);          // call onTimer() once, `ticks` from now
+/// void stopTimer();
+/// uint32_t now();                           // the timer's free-running tick count
+/// ~~~
+///
+/// writeDir() is never called just before a pulse on the same axis: the DIR
+/// pins of a move are set setDirSetup() ticks (1 by default) before its first
+/// step, and those of the next arc chord right after the last step of the
+/// chord before, a whole step interval ahead.
+///
+/// SPI traffic for the drivers (status polls, current changes, ...) is
+/// queued with post(), pollFault() or setCurrentPercent() and run by
+/// service(), which should be called from the main loop.  A job only runs
+/// when the next step event is further away than the cost set with
+/// setJobCost(), so SPI transfers never hold up a step edge.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8434S x, y, z;
+/// DRV8461MultiAxis<DRV8434S, MyHal> axes(hal, 2000000);   // 2 MHz timer
+/// axes.addAxis(x); axes.addAxis(y); axes.addAxis(z);
+/// axes.setJobCost(40);                                    // 20 us per SPI job
+/// const int32_t target[] = { 3200, -1600, 800 };
+/// axes.moveLinear(target, 20000, 80000);
+/// // In the timer interrupt: axes.onTimer();
+/// while (axes.isRunning()) { axes.service(); }
+/// ~~~
+template <class Driver, class Hal, uint8_t MaxAxes = 16, uint16_t TableSize = 256>
+class DRV8461MultiAxis
+{
+  static_assert(MaxAxes >= 1 && MaxAxes <= 32, "the axes are tracked in a 32-bit mask");
+
+public:
+  /// A job run by service(): `value` and `context` are the ones given to
+  /// post().
+  typedef void (*Job)(Driver & driver, uint8_t axis, uint8_t value, void * context);
+
+  /// The most chords an arc is split into.
+  static const uint8_t maxArcSegments = 64;
+
+  /// The size of the job queue.
+  static const uint8_t jobCapacity = 32;
+
+  DRV8461MultiAxis(Hal & hal, uint32_t timerHz) : hal(hal), timebase(*this), engine(timebase, timerHz)
+  {
+  }
+
+  /// Adds a driver as the next axis.
+  ///
+  /// @return The axis number, or -1 if there are already `MaxAxes` axes.
+  int8_t addAxis(Driver & driver)
+  {
+    if (axisCount == MaxAxes) { return -1; }
+    drivers[axisCount] = &driver;
+    position[axisCount] = 0;
+    return axisCount++;
+  }
+
+  /// Returns the number of axes added.
+  uint8_t getAxisCount() const
+  {
+    return axisCount;
+  }
+
+  /// Returns the driver of an axis.
+  Driver & getDriver(uint8_t axis)
+  {
+    return *drivers[axis];
+  }
+
+  /// Selects the acceleration profile of the moves planned after this.
+  void setProfile(DRV8461_Step_Profile profile, uint32_t jerk = 0)
+  {
+    this->profile = profile;
+    this->jerk = jerk;
+  }
+
+  /// Plans and starts a straight move of every axis to the given absolute
+  /// positions (one per axis, in the order they were added).
+  ///
+  /// @return false if a move is in progress or a parameter is 0.
+  bool moveLinear(const int32_t * target, uint32_t speed, uint32_t acceleration)
+  {
+    if (isRunning()) { return false; }
+
+    arcSegments = 0;
+    uint32_t master = 0;
+    for (uint8_t i = 0; i < axisCount; i++)
+    {
+      int32_t d = target[i] - position[i];
+      pendingDelta[i] = d;
+      uint32_t n = d < 0 ? -d : d;
+      if (n > master) { master = n; }
+    }
+    return begin(master, speed, acceleration);
+  }
+
+  /// Plans and starts an arc of axes `a` and `b` from their current position
+  /// to (`endA`, `endB`) around the centre (`centreA`, `centreB`), all in
+  /// absolute steps.  The other axes do not move.  If the end equals the
+  /// start, a full circle is made.
+  ///
+  /// The arc is split into chords of about `chordSteps` steps of the dominant
+  /// axis, or longer if it would take more than maxArcSegments.
+  ///
+  /// @return false if a move is in progress, `a` or `b` is not an axis, or a
+  /// parameter is 0.
+  bool moveArc(uint8_t a, uint8_t b, int32_t endA, int32_t endB, int32_t centreA, int32_t centreB,
+    bool clockwise, uint32_t speed, uint32_t acceleration, uint16_t chordSteps = 32)
+  {
+    if (isRunning() || a >= axisCount || b >= axisCount || a == b || chordSteps == 0) { return false; }
+
+    float startA = position[a] - centreA, startB = position[b] - centreB;
+    float radius = sqrtf(startA * startA + startB * startB);
+    float angle0 = atan2f(startB, startA);
+    float sweep = atan2f((float)(endB - centreB), (float)(endA - centreA)) - angle0;
+    if (clockwise) { if (sweep >= 0) { sweep -= 2 * (float)DRV8461_PI; } }
+    else if (sweep <= 0) { sweep += 2 * (float)DRV8461_PI; }
+
+    uint32_t segments = (uint32_t)(fabsf(sweep) * radius / chordSteps) + 1;
+    if (segments > maxArcSegments) { segments = maxArcSegments; }
+
+    // Round each chord end to a whole step, so the rounding errors do not add
+    // up, and end exactly on the requested point.
+    int32_t lastA = position[a], lastB = position[b];
+    uint32_t master = 0;
+    for (uint8_t k = 1; k <= segments; k++)
+    {
+      int32_t pa = endA, pb = endB;
+      if (k < segments)
+      {
+        float angle = angle0 + sweep * k / segments;
+        pa = centreA + (int32_t)lroundf(radius * cosf(angle));
+        pb = centreB + (int32_t)lroundf(radius * sinf(angle));
+      }
+      arcDelta[k - 1][0] = pa - lastA;
+      arcDelta[k - 1][1] = pb - lastB;
+      lastA = pa;
+      lastB = pb;
+      master += dominant(arcDelta[k - 1][0], arcDelta[k - 1][1]);
+    }
+
+    for (uint8_t i = 0; i < axisCount; i++) { pendingDelta[i] = 0; }
+    arcAxis[0] = a;
+    arcAxis[1] = b;
+    arcSegments = segments;
+    return begin(master, speed, acceleration);
+  }
+
+  /// Stops every axis immediately, without decelerating.
+  void stop()
+  {
+    engine.stop();
+  }
+
+  /// Returns true while a move is in progress.
+  bool isRunning() const
+  {
+    return engine.isRunning();
+  }
+
+  /// Returns the position of an axis in steps.
+  int32_t getPosition(uint8_t axis) const
+  {
+    return position[axis];
+  }
+
+  /// Sets the position counter of an axis.  Ignored while moving.
+  void setPosition(uint8_t axis, int32_t position)
+  {
+    if (isRunning()) { return; }
+    this->position[axis] = position;
+  }
+
+  /// Takes one step of the timebase and arms the timer for the next.  Call
+  /// this from the timer interrupt.
+  void onTimer()
+  {
+    engine.onTimer();
+  }
+
+  /// Sets how many timer ticks to wait between setting the DIR pins and the
+  /// first step of a move, to meet the driver's DIR setup time.  At least 1.
+  void setDirSetup(uint32_t ticks)
+  {
+    dirSetup = ticks ? ticks : 1;
+  }
+
+  /// Sets how many timer ticks one job takes at worst; service() only starts
+  /// a job if the next step event is further away than this.
+  void setJobCost(uint32_t ticks)
+  {
+    jobCost = ticks;
+  }
+
+  /// Queues a job to be run by service() with the driver of `axis`.
+  ///
+  /// @return false if the queue is full.
+  bool post(uint8_t axis, Job job, uint8_t value = 0, void * context = nullptr)
+  {
+    if (axis >= axisCount || jobCount == jobCapacity) { return false; }
+    QueuedJob & q = jobs[(uint8_t)(jobHead + jobCount) % jobCapacity];
+    q.axis = axis;
+    q.value = value;
+    q.job = job;
+    q.context = context;
+    jobCount++;
+    return true;
+  }
+
+  /// Queues a read of the FAULT register of an axis; the result is returned
+  /// by getFault() once the job has run.
+  bool pollFault(uint8_t axis)
+  {
+    return post(axis, [](Driver & driver, uint8_t axis, uint8_t, void * self)
+    {
+      static_cast<DRV8461MultiAxis *>(self)->faults[axis] = driver.readFault();
+    }, 0, this);
+  }
+
+  /// Queues a change of the current of an axis (see
+  /// DRV8434S::setCurrentPercent()).
+  bool setCurrentPercent(uint8_t axis, uint8_t percent)
+  {
+    return post(axis, [](Driver & driver, uint8_t, uint8_t percent, void *)
+    {
+      driver.setCurrentPercent(percent);
+    }, percent);
+  }
+
+  /// Returns the FAULT register of an axis as of the last pollFault() job.
+  uint8_t getFault(uint8_t axis) const
+  {
+    return faults[axis];
+  }
+
+  /// Runs queued jobs for as long as there is time before the next step
+  /// event.  Call this often from the main loop.
+  ///
+  /// @return The number of jobs still queued.
+  uint8_t service()
+  {
+    while (jobCount)
+    {
+      if (isRunning() && (int32_t)(nextStepAt - hal.now() - jobCost) <= 0) { break; }
+      QueuedJob q = jobs[jobHead];
+      jobHead = (jobHead + 1) % jobCapacity;
+      jobCount--;
+      q.job(*drivers[q.axis], q.axis, q.value, q.context);
+    }
+    return jobCount;
+  }
+
+  /// Returns the number of jobs waiting to run.
+  uint8_t pendingJobs() const
+  {
+    return jobCount;
+  }
+
+private:
+
+  /// The Hal given to the timebase engine: it passes the timer through, and
+  /// turns each step of the engine into one tick of the DDA.
+  struct Timebase
+  {
+    explicit Timebase(DRV8461MultiAxis & owner) : owner(owner)
+    {
+    }
+
+    void writeStep(bool level)
+    {
+      if (level) { owner.tick(); }
+    }
+
+    void writeDir(bool)
+    {
+    }
+
+    void startTimer(uint32_t ticks)
+    {
+      owner.nextStepAt = owner.hal.now() + ticks;
+      owner.hal.startTimer(ticks);
+    }
+
+    void stopTimer()
+    {
+      owner.hal.stopTimer();
+    }
+
+    DRV8461MultiAxis & owner;
+  };
+
+  struct QueuedJob
+  {
+    uint8_t axis;
+    uint8_t value;
+    Job job;
+    void * context;
+  };
+
+  static uint32_t dominant(int32_t a, int32_t b)
+  {
+    uint32_t na = a < 0 ? -a : a, nb = b < 0 ? -b : b;
+    return na > nb ? na : nb;
+  }
+
+  bool begin(uint32_t master, uint32_t speed, uint32_t acceleration)
+  {
+    if (master == 0 || !engine.plan((int32_t)master, speed, acceleration, profile, jerk)) { return false; }
+    nextSegment = 0;
+    segmentLeft = 0;
+    loadNextSegment();
+    engine.start(dirSetup);
+    return true;
+  }
+
+  /// Loads the next segment that moves at all, if any is left.
+  void loadNextSegment()
+  {
+    uint8_t segments = arcSegments ? arcSegments : 1;
+    while (segmentLeft == 0 && nextSegment < segments) { loadSegment(); }
+  }
+
+  /// Loads the deltas of the next segment (the whole move, for a linear one)
+  /// and sets the DIR pins.
+  void loadSegment()
+  {
+    if (arcSegments)
+    {
+      for (uint8_t j = 0; j < 2; j++) { pendingDelta[arcAxis[j]] = arcDelta[nextSegment][j]; }
+    }
+    nextSegment++;
+
+    segmentMaster = 0;
+    activeCount = 0;
+    for (uint8_t i = 0; i < axisCount; i++)
+    {
+      int32_t d = pendingDelta[i];
+      if (!d) { continue; }
+      bool forward = d > 0;
+      uint32_t n = forward ? d : -d;
+      if (n > segmentMaster) { segmentMaster = n; }
+      if (forward != dirForward[i] || !dirValid)
+      {
+        hal.writeDir(i, forward);
+        dirForward[i] = forward;
+      }
+      active[activeCount] = i;
+      steps[activeCount] = n;
+      activeCount++;
+    }
+    dirValid = true;
+    for (uint8_t k = 0; k < activeCount; k++) { error[k] = segmentMaster / 2; }
+    segmentLeft = segmentMaster;
+  }
+
+  /// One tick of the DDA: steps every axis whose error overflows, then loads
+  /// the next segment if this one is done, so its DIR pins are set a step
+  /// interval before they are used.
+  void tick()
+  {
+    uint32_t mask = 0;
+    for (uint8_t k = 0; k < activeCount; k++)
+    {
+      error[k] += steps[k];
+      if (error[k] >= segmentMaster)
+      {
+        error[k] -= segmentMaster;
+        uint8_t i = active[k];
+        mask |= (uint32_t)1 << i;
+        position[i] = position[i] + (dirForward[i] ? 1 : -1);
+      }
+    }
+    hal.pulseSteps(mask);
+    if (--segmentLeft == 0) { loadNextSegment(); }
+  }
+
+  Hal & hal;
+  Timebase timebase;
+  DRV8461StepEngine<Timebase, TableSize> engine;
+  DRV8461_Step_Profile profile = DRV8461_Step_Profile::DRV8461_PROFILE_TRAPEZOID;
+  uint32_t jerk = 0;
+  uint32_t dirSetup = 1;
+
+  Driver * drivers[MaxAxes];
+  uint8_t axisCount = 0;
+  volatile int32_t position[MaxAxes];
+  uint8_t faults[MaxAxes] = {};
+
+  // Planned move.
+  int32_t pendingDelta[MaxAxes];
+  int32_t arcDelta[maxArcSegments][2];
+  uint8_t arcAxis[2] = {};
+  uint8_t arcSegments = 0;
+
+  // Progress through the move, updated from the timer interrupt.
+  uint8_t nextSegment = 0;
+  uint32_t segmentLeft = 0;
+  uint32_t segmentMaster = 0;
+  uint8_t activeCount = 0;
+  uint8_t active[MaxAxes];
+  uint32_t steps[MaxAxes];
+  uint32_t error[MaxAxes];
+  bool dirForward[MaxAxes] = {};
+  bool dirValid = false;
+  volatile uint32_t nextStepAt = 0;
+
+  // Jobs for service().
+  QueuedJob jobs[jobCapacity];
+  uint8_t jobHead = 0;
+  uint8_t jobCount = 0;
+  uint32_t jobCost = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_MULTIAXIS_H
@@ -0,0 +1,356 @@
+#ifndef DRV8461_PROFILE_H
+#define DRV8461_PROFILE_H
+
+/*  DRV8461_Profile.h
+
+    Saving the DRV8461 settings as a compact binary profile, and loading a
+    profile back onto a driver.
+
+*/
+#pragma once
+
+#include <stddef.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "DRV8461_Registers.h"
+
+
+// PROFILE FORMAT ****************************************************************************************************//
+//
+// A profile holds the settings registers of one driver (CTRL, CUSTOM, ATQ and
+// SS groups):
+//   4 bytes  "D8RP"
+//   1 byte   format version (DRV8461_PROFILE_VERSION)
+//   8 bytes  address mask: bit n set if the register at address n is stored,
+//            least significant byte first
+//   N bytes  the settings bits of each stored register (other bits 0), in
+//            ascending address order; EN_OUT in CTRL1 is always 0
+//   2 bytes  CRC-16/CCITT-FALSE of all of the above, least significant byte
+//            first
+//
+// The address mask makes a profile readable by a library that treats a
+// different set of registers as settings: it uses the ones both know about.
+//
+// EN_OUT is left out because whether the outputs are on is the state of the
+// axis, not part of the motor's configuration: loading a profile must not
+// energize a motor that was disabled, or cut one that is holding a load.
+
+/// The format version written by this library.
+static const uint8_t DRV8461_PROFILE_VERSION = 1;
+
+/// The size of a profile holding every settings register.
+static const uint8_t DRV8461_PROFILE_SIZE = 13 + DRV8461RegTableHolder<>::settings.count + 2;
+
+/// A profile in the format above, as written by DRV8461_makeProfile() and
+/// DRV8461_saveProfile().
+struct DRV8461Profile
+{
+  uint8_t data[DRV8461_PROFILE_SIZE];
+};
+
+
+/// Returns the CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+/// of `size` bytes.
+constexpr uint16_t DRV8461_crc16(const uint8_t * data, size_t size)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/// Returns the bits of a register that a profile stores: its settings bits,
+/// except EN_OUT.
+constexpr uint8_t DRV8461_profileMask(uint8_t address)
+{
+  return DRV8461_regInfo(address).settingsMask() &
+    (address == (uint8_t)DRV8461Fields::EN_OUT::address ? (uint8_t)~DRV8461Fields::EN_OUT::mask : 0xFF);
+}
+
+/// Fills in a profile from a register file (an array of register values
+/// indexed by DRV8461_REG_ADDR).
+constexpr DRV8461Profile DRV8461_encodeProfile(const uint8_t * regs)
+{
+  DRV8461Profile p = {};
+  p.data[0] = 'D';
+  p.data[1] = '8';
+  p.data[2] = 'R';
+  p.data[3] = 'P';
+  p.data[4] = DRV8461_PROFILE_VERSION;
+
+  const DRV8461RegListData & settings = DRV8461RegTableHolder<>::settings;
+  for (uint8_t i = 0; i < settings.count; i++)
+  {
+    p.data[5 + settings.addresses[i] / 8] |= 1 << (settings.addresses[i] % 8);
+  }
+
+  uint8_t length = 13;
+  for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+  {
+    if (!((p.data[5 + address / 8] >> (address % 8)) & 1)) { continue; }
+    p.data[length++] = regs[address] & DRV8461_profileMask(address);
+  }
+
+  uint16_t crc = DRV8461_crc16(p.data, length);
+  p.data[length] = (uint8_t)crc;
+  p.data[length + 1] = (uint8_t)(crc >> 8);
+  return p;
+}
+
+/// Returns the profile for a configuration, so it can be built at compile
+/// time and kept in flash.
+constexpr DRV8461Profile DRV8461_makeProfile(const DRV8461DriverConfig & config)
+{
+  uint8_t regs[DRV8461_REG_ADDR_COUNT] = {};
+  for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+  {
+    regs[address] = config.reg((DRV8461_REG_ADDR)address);
+  }
+  return DRV8461_encodeProfile(regs);
+}
+
+
+/// This class reads a profile where it lies (in RAM, in memory-mapped flash,
+/// or in a file mapped by DRV8461ProfileFileReader) without copying it.
+class DRV8461ProfileView
+{
+public:
+  /// Checks the profile at `data`: the magic number, the version, the size
+  /// and the CRC.  `size` may be larger than the profile, as when it is read
+  /// from a fixed-size storage slot.
+  ///
+  /// @return false if it is not a valid profile.
+  bool attach(const uint8_t * data, size_t size)
+  {
+    this->data = nullptr;
+    if (size < 15 || data[0] != 'D' || data[1] != '8' || data[2] != 'R' || data[3] != 'P' ||
+      data[4] != DRV8461_PROFILE_VERSION)
+    {
+      return false;
+    }
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      for (uint8_t bits = data[5 + i]; bits; bits &= bits - 1) { count++; }
+    }
+    size_t length = 13 + count;
+    if (size < length + 2) { return false; }
+    if (DRV8461_crc16(data, length) != (data[length] | (uint16_t)data[length + 1] << 8)) { return false; }
+
+    this->data = data;
+    return true;
+  }
+
+  /// Returns true if the profile stores the given register.
+  bool has(uint8_t address) const
+  {
+    return address < DRV8461_REG_ADDR_COUNT && (data[5 + address / 8] >> (address % 8)) & 1;
+  }
+
+  /// Returns the stored value of a register; check has() first.
+  uint8_t reg(uint8_t address) const
+  {
+    uint8_t index = 13;
+    for (uint8_t a = 0; a < address; a++)
+    {
+      if (has(a)) { index++; }
+    }
+    return data[index];
+  }
+
+private:
+
+  const uint8_t * data = nullptr;
+};
+
+
+/// Saves the settings of a driver as a profile: the cached settings, or if
+/// `fromDevice` is true the settings the device actually holds, read in one
+/// batch.
+template <class Driver>
+void DRV8461_saveProfile(Driver & sd, DRV8461Profile & profile, bool fromDevice = false)
+{
+  uint8_t regs[DRV8461_REG_ADDR_COUNT] = {};
+  if (fromDevice)
+  {
+    DRV8461RegOp ops[Driver::settingsRegCount];
+    DRV8461RegResult results[Driver::settingsRegCount];
+    for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+    {
+      ops[i] = DRV8461RegOp::read(Driver::settingsReg(i));
+    }
+    sd.driver.transferBatch(ops, Driver::settingsRegCount, results);
+    for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+    {
+      regs[(uint8_t)Driver::settingsReg(i)] = results[i].data;
+    }
+  }
+  else
+  {
+    for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+    {
+      regs[(uint8_t)Driver::settingsReg(i)] = sd.getCachedReg(Driver::settingsReg(i));
+    }
+  }
+  profile = DRV8461_encodeProfile(regs);
+}
+
+/// Loads the profile at `data` (see DRV8461ProfileView::attach()) onto a
+/// driver.
+///
+/// Only the registers whose settings differ from the cache are written, in
+/// one batch with CTRL1 last (see BasicDRV8434S::commit()), so switching
+/// between two profiles for similar motors costs a few frames.  Settings
+/// registers the profile lacks keep their values, and so does EN_OUT: the
+/// outputs stay on or off as they were.  Inside an open transaction the
+/// writes are left for its commit().
+///
+/// @return false if the profile is not valid; nothing is changed then.
+template <class Driver>
+bool DRV8461_loadProfile(Driver & sd, const uint8_t * data, size_t size)
+{
+  DRV8461ProfileView view;
+  if (!view.attach(data, size)) { return false; }
+
+  bool ownTransaction = !sd.inTransaction();
+  if (ownTransaction) { sd.beginTransaction(); }
+  for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+  {
+    uint8_t address = (uint8_t)Driver::settingsReg(i);
+    if (!view.has(address)) { continue; }
+    uint8_t mask = DRV8461_profileMask(address);
+    uint8_t cached = sd.getCachedReg((DRV8461_REG_ADDR)address);
+    uint8_t value = (cached & ~mask) | (view.reg(address) & mask);
+    if (value != cached) { sd.setReg((DRV8461_REG_ADDR)address, value); }
+  }
+  if (ownTransaction) { sd.commit(); }
+  return true;
+}
+
+/// Loads a profile onto a driver; see above.
+template <class Driver>
+bool DRV8461_loadProfile(Driver & sd, const DRV8461Profile & profile)
+{
+  return DRV8461_loadProfile(sd, profile.data, sizeof(profile.data));
+}
+
+
+// PROFILE FILES *****************************************************************************************************//
+
+#if defined(__linux__)
+
+/// Writes a profile to a file, replacing it atomically: the profile goes to
+/// `path` with ".tmp" appended and is renamed over `path` once written.
+///
+/// @return false if the file could not be written; errno is left set.
+inline bool DRV8461_writeProfileFile(const char * path, const DRV8461Profile & profile)
+{
+  char temp[256];
+  if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) { return false; }
+
+  FILE * file = fopen(temp, "wb");
+  if (!file) { return false; }
+  bool ok = fwrite(profile.data, 1, sizeof(profile.data), file) == sizeof(profile.data);
+  ok = (fclose(file) == 0) && ok;
+  if (!ok || rename(temp, path) != 0)
+  {
+    remove(temp);
+    return false;
+  }
+  return true;
+}
+
+/// This class maps a profile file into memory, so DRV8461_loadProfile() reads
+/// it straight from the page cache.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461ProfileFileReader file;
+/// if (!file.open("/etc/motors/nema17.d8rp") || !file.load(sd)) { return 1; }
+/// ~~~
+class DRV8461ProfileFileReader
+{
+public:
+  DRV8461ProfileFileReader() = default;
+  DRV8461ProfileFileReader(const DRV8461ProfileFileReader &) = delete;
+  DRV8461ProfileFileReader & operator=(const DRV8461ProfileFileReader &) = delete;
+
+  ~DRV8461ProfileFileReader()
+  {
+    close();
+  }
+
+  /// Maps the file.
+  ///
+  /// @return false if the file could not be mapped; errno is left set.
+  bool open(const char * path)
+  {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { return false; }
+
+    data = p;
+    size = st.st_size;
+    return true;
+  }
+
+  /// Unmaps the file.
+  void close()
+  {
+    if (data) { munmap(data, size); }
+    data = nullptr;
+    size = 0;
+  }
+
+  /// Loads the mapped profile onto a driver (see DRV8461_loadProfile()).
+  ///
+  /// @return false if no file is open or it is not a valid profile.
+  template <class Driver>
+  bool load(Driver & sd) const
+  {
+    return data && DRV8461_loadProfile(sd, static_cast<const uint8_t *>(data), size);
+  }
+
+private:
+
+  void * data = nullptr;
+  size_t size = 0;
+};
+
+#endif                                    // #if defined(__linux__)
+
+
+// PROFILE CHECKS ****************************************************************************************************//
+constexpr uint8_t DRV8461_crcCheckData[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+static_assert(DRV8461_crc16(DRV8461_crcCheckData, 9) == 0x29B1, "CRC-16/CCITT-FALSE check value");
+static_assert(!(DRV8461_profileMask((uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1) & DRV8461Fields::EN_OUT::mask),
+  "profiles leave EN_OUT alone");
+static_assert(DRV8461_PROFILE_SIZE == 57, "a profile of CTRL, CUSTOM, ATQ and SS settings is 57 bytes");
+
+
+#endif                                    // #ifndef DRV8461_PROFILE_H
@@ -0,0 +1,110 @@
+#ifndef DRV8461_Register_ATQ
+#define DRV8461_Register_ATQ
+
+#include <cstdint>
+
+//AUTO TORQUE
+// ATQ CONTROL 1 AND 2 REGISTER SETINGS **************************************************************************//
+enum class DRV8461_ATQ_CTRL1_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL1_ATQ_CNT = 0xFF,    // Lower 8-bits of ATQ_CNT, the measured load (read-only).
+};
+
+enum class DRV8461_ATQ_CTRL2_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL2_ATQ_CNT = 0x07,    // Upper 3-bits of ATQ_CNT (read-only).
+};
+
+
+// ATQ CONTROL 3 TO 9 REGISTER SETINGS ***************************************************************************//
+enum class DRV8461_ATQ_CTRL3_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL3_ATQ_UL = 0xFF,     // Upper limit of ATQ_CNT; above it the current is raised (CNT_OFLW).
+};
+
+enum class DRV8461_ATQ_CTRL4_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL4_ATQ_LL = 0xFF,     // Lower limit of ATQ_CNT; below it the current is lowered (CNT_UFLW).
+};
+
+enum class DRV8461_ATQ_CTRL5_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL5_KP = 0xFF,         // Proportional gain of the current control loop.
+};
+
+enum class DRV8461_ATQ_CTRL6_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL6_KD = 0x0F,         // Derivative gain of the current control loop.
+};
+
+enum class DRV8461_ATQ_CTRL7_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL7_ATQ_TRQ_MIN = 0xFF, // Lowest current (TRQ_DAC scale) ATQ may set.
+};
+
+enum class DRV8461_ATQ_CTRL8_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL8_ATQ_TRQ_MAX = 0xFF, // Highest current (TRQ_DAC scale) ATQ may set.
+};
+
+enum class DRV8461_ATQ_CTRL9_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL9_ATQ_D_THR = 0xFF,  // Change in ATQ_CNT above which the derivative term is used.
+};
+
+
+// ATQ CONTROL 10 REGISTER SETINGS *******************************************************************************//
+enum class DRV8461_ATQ_CTRL10_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL10_ATQ_EN        = 0x80, // Write '1' to enable auto-torque.
+  DRV8461_ATQ_CTRL10_LRN_START     = 0x40, // Write '1' to start learning LRN_CONST1/2 (self-clearing).
+  DRV8461_ATQ_CTRL10_ATQ_LRN_DONE  = 0x20, // Learning finished (read-only).
+  DRV8461_ATQ_CTRL10_ATQ_AVG       = 0x10, // Average ATQ_CNT over both coils.
+  DRV8461_ATQ_CTRL10_ATQ_FRZ       = 0x0E, // Number of electrical half-cycles the current is held after a change.
+};
+
+
+// ATQ CONTROL 11 TO 15 REGISTER SETINGS *************************************************************************//
+enum class DRV8461_ATQ_CTRL11_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL11_ATQ_LRN_MIN_CURRENT = 0xFF, // Current (TRQ_DAC scale) learning starts from.
+};
+
+enum class DRV8461_ATQ_CTRL12_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL12_LRN_CONST1 = 0xFF, // Lower 8-bits of learned constant 1.
+};
+
+enum class DRV8461_ATQ_CTRL13_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL13_LRN_CONST1 = 0x03, // Upper 2-bits of learned constant 1.
+};
+
+enum class DRV8461_ATQ_CTRL14_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL14_LRN_CONST2 = 0xFF, // Lower 8-bits of learned constant 2.
+};
+
+enum class DRV8461_ATQ_CTRL15_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL15_LRN_CONST2 = 0x03, // Upper 2-bits of learned constant 2.
+};
+
+
+// ATQ CONTROL 16 TO 18 REGISTER SETINGS *************************************************************************//
+enum class DRV8461_ATQ_CTRL16_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL16_LRN_CYCLE_SELECT = 0x0C, // Electrical half-cycles per learning current step.
+  DRV8461_ATQ_CTRL16_LRN_STEP         = 0x03, // Current increment between learning steps.
+};
+
+//Specific Values for Learning Cycles
+enum class DRV8461_ATQ_Learn_Cycles : uint8_t {
+  DRV8461_ATQ_LRN_CYCLES_8  = 0b00,    // 8 half-cycles per step.
+  DRV8461_ATQ_LRN_CYCLES_16 = 0b01,    // 16 half-cycles per step.
+  DRV8461_ATQ_LRN_CYCLES_24 = 0b10,    // 24 half-cycles per step.
+  DRV8461_ATQ_LRN_CYCLES_32 = 0b11,    // 32 half-cycles per step.
+};
+
+//Specific Values for Learning Step
+enum class DRV8461_ATQ_Learn_Step : uint8_t {
+  DRV8461_ATQ_LRN_STEP_1  = 0b00,      // 1 TRQ_DAC code per step.
+  DRV8461_ATQ_LRN_STEP_2  = 0b01,      // 2 TRQ_DAC codes per step.
+  DRV8461_ATQ_LRN_STEP_4  = 0b10,      // 4 TRQ_DAC codes per step.
+  DRV8461_ATQ_LRN_STEP_8  = 0b11,      // 8 TRQ_DAC codes per step.
+};
+
+enum class DRV8461_ATQ_CTRL17_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL17_ATQ_ERROR_TRUNCATE = 0x0F, // Low bits of the ATQ error ignored, to reduce hunting.
+};
+
+enum class DRV8461_ATQ_CTRL18_Reg_Val : uint8_t {
+  DRV8461_ATQ_CTRL18_ATQ_VM_SCALE = 0x1F, // Supply voltage scaling of ATQ_CNT (VM_ADC scale).
+};
+
+
+#endif
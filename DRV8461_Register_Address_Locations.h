@@ -8,6 +8,9 @@
 #include "DRV8461_Register_Fault"
 #include "DRV8461_Register_Diag.h"
 #include "DRV8461_Register_CTRL.h"
+#include "DRV8461_Register_Custom.h"
+#include "DRV8461_Register_ATQ.h"
+#include "DRV8461_Register_SilentStep.h"
 
 // REGISTER ADDRESSES ************************************************************************************************// 
 enum class DRV8461_REG_ADDR : uint8_t {
@@ -0,0 +1,19 @@
+#ifndef DRV8461_Register_Custom
+#define DRV8461_Register_Custom
+
+#include <cstdint>
+
+//CUSTOM MICROSTEP
+// CUSTOM CONTROL 1 REGISTER SETINGS *****************************************************************************//
+enum class DRV8461_CUSTOM_CTRL1_Reg_Val : uint8_t {
+  DRV8461_CUSTOM_CTRL1_EN_CUSTOM = 0x01, // Write '1' to use CUSTOM_CURRENT1-8 instead of the built-in sine table.
+};
+
+
+// CUSTOM CONTROL 2 TO 9 REGISTER SETINGS ************************************************************************//
+enum class DRV8461_CUSTOM_CTRLn_Reg_Val : uint8_t {
+  DRV8461_CUSTOM_CTRLn_CUSTOM_CURRENT = 0xFF, // Coil current at the n-1th 1/8 step of each quarter cycle (255 = full scale).
+};
+
+
+#endif
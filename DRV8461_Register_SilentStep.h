@@ -0,0 +1,43 @@
+#ifndef DRV8461_Register_SilentStep
+#define DRV8461_Register_SilentStep
+
+#include <cstdint>
+
+//SILENT STEP
+// SS CONTROL 1 REGISTER SETINGS *********************************************************************************//
+enum class DRV8461_SS_CTRL1_Reg_Val : uint8_t {
+  DRV8461_SS_CTRL1_SS_SMPL_SEL = 0xC0, // Current sampling time of the silent step loop.
+  DRV8461_SS_CTRL1_EN_SS       = 0x20, // Write '1' to use silent step decay up to the SS_THR step rate.
+};
+
+//Specific Values for Silent Step Sampling Time
+enum class DRV8461_SS_Sampling : uint8_t {
+  DRV8461_SS_SMPL_2US = 0b00,          // 2us.
+  DRV8461_SS_SMPL_4US = 0b01,          // 4us.
+  DRV8461_SS_SMPL_6US = 0b10,          // 6us.
+  DRV8461_SS_SMPL_8US = 0b11,          // 8us.
+};
+
+
+// SS CONTROL 2 TO 4 REGISTER SETINGS ****************************************************************************//
+enum class DRV8461_SS_CTRL2_Reg_Val : uint8_t {
+  DRV8461_SS_CTRL2_SS_KP = 0x7F,       // Proportional gain of the silent step current loop.
+};
+
+enum class DRV8461_SS_CTRL3_Reg_Val : uint8_t {
+  DRV8461_SS_CTRL3_SS_KI = 0x7F,       // Integral gain of the silent step current loop.
+};
+
+enum class DRV8461_SS_CTRL4_Reg_Val : uint8_t {
+  DRV8461_SS_CTRL4_SS_KI_DIV_SEL = 0x38, // SS_KI is divided by 2^SS_KI_DIV_SEL.
+  DRV8461_SS_CTRL4_SS_KP_DIV_SEL = 0x07, // SS_KP is divided by 2^SS_KP_DIV_SEL.
+};
+
+
+// SS CONTROL 5 REGISTER SETINGS *********************************************************************************//
+enum class DRV8461_SS_CTRL5_Reg_Val : uint8_t {
+  DRV8461_SS_CTRL5_SS_THR = 0xFF,      // Step rate above which the driver falls back to the DECAY mode.
+};
+
+
+#endif
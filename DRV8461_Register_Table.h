@@ -0,0 +1,216 @@
+///Header File with the per-register metadata table for DRV8461.
+
+#ifndef DRV8461_Register_Table
+#define DRV8461_Register_Table
+
+#include <cstdint>
+
+#include "DRV8461_Register_Address_Locations.h"
+
+// REGISTER GROUPS ***************************************************************************************************//
+enum class DRV8461_REG_GROUP : uint8_t {
+  DRV8461_GROUP_NONE   = 0,            // No register at this address.
+  DRV8461_GROUP_STATUS = 1,            // FAULT and DIAG1-3.
+  DRV8461_GROUP_CTRL   = 2,            // CTRL1-14.
+  DRV8461_GROUP_INDEX  = 3,            // INDEX1-5 (indexer position, read-only).
+  DRV8461_GROUP_CUSTOM = 4,            // CUSTOM_CTRL1-9 (custom microstep table).
+  DRV8461_GROUP_ATQ    = 5,            // ATQ_CTRL1-18 (auto-torque).
+  DRV8461_GROUP_SS     = 6,            // SS_CTRL1-5 (silent step).
+};
+
+// REGISTER METADATA *************************************************************************************************//
+
+/// Describes one register of the DRV8461.
+struct DRV8461RegInfo
+{
+  /// Which block of the register map the register belongs to.
+  DRV8461_REG_GROUP group;
+
+  /// Power-on value of the register.
+  uint8_t resetValue;
+
+  /// Bits that hold settings and can be written.
+  uint8_t writableMask;
+
+  /// Writable bits that the driver clears by itself after they are written.
+  uint8_t selfClearingMask;
+
+  /// Bits that the driver updates by itself (status, counters, ADC readings).
+  uint8_t volatileMask;
+
+  /// Returns true if there is a register at this address.
+  constexpr bool present() const { return group != DRV8461_REG_GROUP::DRV8461_GROUP_NONE; }
+
+  /// Returns true if the register holds settings that should be kept in sync
+  /// with the cached copy: the writable bits, minus the self-clearing ones.
+  constexpr uint8_t settingsMask() const { return writableMask & ~selfClearingMask; }
+};
+
+/// The number of addresses in the 6-bit register address space.
+constexpr uint8_t DRV8461_REG_ADDR_COUNT = 64;
+
+/// The complete register map, indexed by address.  Unused addresses have group
+/// DRV8461_GROUP_NONE.
+struct DRV8461RegTableData
+{
+  DRV8461RegInfo entries[DRV8461_REG_ADDR_COUNT];
+};
+
+constexpr DRV8461RegTableData DRV8461_makeRegTable()
+{
+  using A = DRV8461_REG_ADDR;
+  using G = DRV8461_REG_GROUP;
+
+  DRV8461RegTableData t = {};
+
+  //           address                  group                reset writable selfclr volatile
+  t.entries[(uint8_t)A::DRV8461_REG_FAULT]  = { G::DRV8461_GROUP_STATUS, 0x00, 0x00, 0x00, 0xFF };
+  t.entries[(uint8_t)A::DRV8461_REG_DIAG1]  = { G::DRV8461_GROUP_STATUS, 0x00, 0x00, 0x00, 0xFF };
+  t.entries[(uint8_t)A::DRV8461_REG_DIAG2]  = { G::DRV8461_GROUP_STATUS, 0x00, 0x00, 0x00, 0xFF };
+  t.entries[(uint8_t)A::DRV8461_REG_DIAG3]  = { G::DRV8461_GROUP_STATUS, 0x00, 0x00, 0x00, 0xFF };
+
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL1]  = { G::DRV8461_GROUP_CTRL,   0x0F, 0xFF, 0x20, 0x00 };  // IDX_RST
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL2]  = { G::DRV8461_GROUP_CTRL,   0x06, 0xFF, 0x40, 0x00 };  // STEP
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL3]  = { G::DRV8461_GROUP_CTRL,   0x38, 0xFF, 0x80, 0x00 };  // CLR_FLT
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL4]  = { G::DRV8461_GROUP_CTRL,   0x49, 0xFF, 0x20, 0x00 };  // STL_LRN
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL5]  = { G::DRV8461_GROUP_CTRL,   0x03, 0xFF, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL6]  = { G::DRV8461_GROUP_CTRL,   0x20, 0xFF, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL7]  = { G::DRV8461_GROUP_CTRL,   0x00, 0x00, 0x00, 0xFF };  // TRQ_COUNT
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL8]  = { G::DRV8461_GROUP_CTRL,   0x00, 0x00, 0x00, 0x0F };  // TRQ_COUNT
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL9]  = { G::DRV8461_GROUP_CTRL,   0x10, 0xFF, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL10] = { G::DRV8461_GROUP_CTRL,   0x80, 0xFF, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL11] = { G::DRV8461_GROUP_CTRL,   0xFF, 0xFF, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL12] = { G::DRV8461_GROUP_CTRL,   0x20, 0xF8, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL13] = { G::DRV8461_GROUP_CTRL,   0x10, 0xFE, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_CTRL14] = { G::DRV8461_GROUP_CTRL,   0x58, 0x07, 0x00, 0xF8 };  // VM_ADC
+
+  for (uint8_t a = (uint8_t)A::DRV8461_REG_INDEX1; a <= (uint8_t)A::DRV8461_REG_INDEX5; a++)
+  {
+    t.entries[a] = { G::DRV8461_GROUP_INDEX, 0x00, 0x00, 0x00, 0xFF };
+  }
+
+  for (uint8_t a = (uint8_t)A::DRV8461_REG_CUSTOM_CTRL1; a <= (uint8_t)A::DRV8461_REG_CUSTOM_CTRL9; a++)
+  {
+    t.entries[a] = { G::DRV8461_GROUP_CUSTOM, 0x00, 0xFF, 0x00, 0x00 };
+  }
+  t.entries[(uint8_t)A::DRV8461_REG_CUSTOM_CTRL1] = { G::DRV8461_GROUP_CUSTOM, 0x00, 0x01, 0x00, 0x00 };  // EN_CUSTOM
+
+  for (uint8_t a = (uint8_t)A::DRV8461_REG_ATQ_CTRL1; a <= (uint8_t)A::DRV8461_REG_ATQ_CTRL18; a++)
+  {
+    t.entries[a] = { G::DRV8461_GROUP_ATQ, 0x00, 0xFF, 0x00, 0x00 };
+  }
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL1]  = { G::DRV8461_GROUP_ATQ, 0x00, 0x00, 0x00, 0xFF };  // ATQ_CNT
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL2]  = { G::DRV8461_GROUP_ATQ, 0x00, 0x00, 0x00, 0x07 };  // ATQ_CNT
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL6]  = { G::DRV8461_GROUP_ATQ, 0x00, 0x0F, 0x00, 0x00 };  // KD
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL10] = { G::DRV8461_GROUP_ATQ, 0x00, 0xDE, 0x40, 0x20 };  // LRN_START, ATQ_LRN_DONE
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL13] = { G::DRV8461_GROUP_ATQ, 0x00, 0x03, 0x00, 0x00 };  // LRN_CONST1
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL15] = { G::DRV8461_GROUP_ATQ, 0x00, 0x03, 0x00, 0x00 };  // LRN_CONST2
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL16] = { G::DRV8461_GROUP_ATQ, 0x00, 0x0F, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL17] = { G::DRV8461_GROUP_ATQ, 0x00, 0x0F, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_ATQ_CTRL18] = { G::DRV8461_GROUP_ATQ, 0x00, 0x1F, 0x00, 0x00 };
+
+  t.entries[(uint8_t)A::DRV8461_REG_SS_CTRL1]  = { G::DRV8461_GROUP_SS, 0x00, 0xE0, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_SS_CTRL2]  = { G::DRV8461_GROUP_SS, 0x10, 0x7F, 0x00, 0x00 };  // SS_KP
+  t.entries[(uint8_t)A::DRV8461_REG_SS_CTRL3]  = { G::DRV8461_GROUP_SS, 0x08, 0x7F, 0x00, 0x00 };  // SS_KI
+  t.entries[(uint8_t)A::DRV8461_REG_SS_CTRL4]  = { G::DRV8461_GROUP_SS, 0x00, 0x3F, 0x00, 0x00 };
+  t.entries[(uint8_t)A::DRV8461_REG_SS_CTRL5]  = { G::DRV8461_GROUP_SS, 0xFF, 0xFF, 0x00, 0x00 };  // SS_THR
+
+  return t;
+}
+
+/// An ordered list of register addresses.
+struct DRV8461RegListData
+{
+  uint8_t count;
+  uint8_t addresses[DRV8461_REG_ADDR_COUNT];
+};
+
+/// Returns the bit for a group in a mask of groups.
+constexpr uint8_t DRV8461_groupBit(DRV8461_REG_GROUP group)
+{
+  return 1 << (uint8_t)group;
+}
+
+/// Lists the registers of the given groups (a mask of DRV8461_groupBit()
+/// values) that hold settings, in the order they should be written: ascending
+/// address, except that CTRL1 comes last because it contains the EN_OUT bit,
+/// and we want to try to have all the other settings correct first.
+constexpr DRV8461RegListData DRV8461_makeWriteOrder(const DRV8461RegTableData & t, uint8_t groups)
+{
+  DRV8461RegListData list = {};
+  const uint8_t ctrl1 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1;
+  for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++)
+  {
+    if (a == ctrl1) { continue; }
+    if ((groups & DRV8461_groupBit(t.entries[a].group)) && t.entries[a].settingsMask())
+    {
+      list.addresses[list.count++] = a;
+    }
+  }
+  if (groups & DRV8461_groupBit(t.entries[ctrl1].group)) { list.addresses[list.count++] = ctrl1; }
+  return list;
+}
+
+/// Holds the register table and the lists derived from it.  It is a class
+/// template only so that the static members can be defined in this header
+/// without violating the one-definition rule.
+template <typename T = void>
+struct DRV8461RegTableHolder
+{
+  static constexpr DRV8461RegTableData table = DRV8461_makeRegTable();
+  static constexpr DRV8461RegListData settings = DRV8461_makeWriteOrder(table,
+    DRV8461_groupBit(DRV8461_REG_GROUP::DRV8461_GROUP_CTRL) | DRV8461_groupBit(DRV8461_REG_GROUP::DRV8461_GROUP_CUSTOM) |
+    DRV8461_groupBit(DRV8461_REG_GROUP::DRV8461_GROUP_ATQ) | DRV8461_groupBit(DRV8461_REG_GROUP::DRV8461_GROUP_SS));
+};
+
+template <typename T>
+constexpr DRV8461RegTableData DRV8461RegTableHolder<T>::table;
+
+template <typename T>
+constexpr DRV8461RegListData DRV8461RegTableHolder<T>::settings;
+
+/// Returns the metadata for the register at the given address.  Only the low 6
+/// bits of the address are used.
+constexpr const DRV8461RegInfo & DRV8461_regInfo(uint8_t address)
+{
+  return DRV8461RegTableHolder<>::table.entries[address & (DRV8461_REG_ADDR_COUNT - 1)];
+}
+
+/// Returns the metadata for the given register.
+constexpr const DRV8461RegInfo & DRV8461_regInfo(DRV8461_REG_ADDR address)
+{
+  return DRV8461_regInfo((uint8_t)address);
+}
+
+// TABLE CHECKS ******************************************************************************************************//
+constexpr bool DRV8461_checkRegTable()
+{
+  uint8_t present = 0;
+  for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++)
+  {
+    const DRV8461RegInfo & r = DRV8461_regInfo(a);
+    if (!r.present())
+    {
+      if (r.resetValue || r.writableMask || r.selfClearingMask || r.volatileMask) { return false; }
+      continue;
+    }
+    present++;
+
+    // Self-clearing bits must be writable and must reset to 0.
+    if (r.selfClearingMask & ~r.writableMask) { return false; }
+    if (r.resetValue & r.selfClearingMask) { return false; }
+
+    // A bit is either a setting or updated by the driver, never both.
+    if (r.writableMask & r.volatileMask) { return false; }
+  }
+  return present == 55;
+}
+
+static_assert(DRV8461_checkRegTable(), "DRV8461 register table is inconsistent");
+static_assert(DRV8461_regInfo(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL10).present(), "ATQ_CTRL10 must be in the table");
+static_assert(!DRV8461_regInfo(0x36).present() && !DRV8461_regInfo(0x3B).present(), "0x36-0x3B are unused");
+static_assert(DRV8461RegTableHolder<>::settings.count == 12 + 9 + 16 + 5, "CTRL1-6, CTRL9-14, CUSTOM_CTRL1-9, ATQ_CTRL3-18 and SS_CTRL1-5 hold settings");
+static_assert(DRV8461RegTableHolder<>::settings.addresses[DRV8461RegTableHolder<>::settings.count - 1] == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1, "CTRL1 must be written last");
+static_assert((DRV8461_regInfo(DRV8461_REG_ADDR::DRV8461_REG_CTRL1).resetValue & 0x80) == 0, "outputs must be disabled at reset");
+
+#endif
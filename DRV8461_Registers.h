@@ -9,10 +9,197 @@
 */
 #pragma once
 
+#if defined(ARDUINO)
 #include <Arduino.h>
 #include <SPI.h>
+#endif
 
 #include "DRV8461_Register_Address_Locations.h" //includes stdint.h
+#include "DRV8461_Register_Table.h"
+#include "DRV8461_Field.h"
+#include "DRV8461_Status.h"
+#include "DRV8461_Wavetable.h"
+#include "DRV8461_Config.h"
+
+
+/// One register access in a batch passed to BasicDRV8434SSPI::transferBatch().
+struct DRV8461RegOp
+{
+  /// Register address.
+  uint8_t address;
+
+  /// Value to write; ignored for reads.
+  uint8_t value;
+
+  /// True for a write, false for a read.
+  bool isWrite;
+
+  static DRV8461RegOp read(DRV8461_REG_ADDR address)
+  {
+    return { (uint8_t)address, 0, false };
+  }
+
+  static DRV8461RegOp write(DRV8461_REG_ADDR address, uint8_t value)
+  {
+    return { (uint8_t)address, value, true };
+  }
+};
+
+/// The result of one register access in a batch.  The layout matches the two
+/// bytes the driver shifts out for each frame, so an array of these doubles as
+/// the transfer buffer.
+struct DRV8461RegResult
+{
+  /// The status byte returned in the first half of the frame.
+  uint8_t status;
+
+  /// The register contents for a read, or the old (existing) contents of the
+  /// register for a write.
+  uint8_t data;
+};
+
+static_assert(sizeof(DRV8461RegResult) == 2, "DRV8461RegResult must match the SPI frame");
+
+/// The silent step settings (SS_CTRL1-5), as set by
+/// BasicDRV8434S::setSilentStep().  The gains are 7 bits and the dividers 3
+/// bits; larger values are clipped.
+struct DRV8461SilentStepSettings
+{
+  bool enabled;
+  DRV8461_SS_Sampling sampling;
+  uint8_t kp;
+  uint8_t ki;
+  uint8_t kpDivider;
+  uint8_t kiDivider;
+
+  /// The step rate above which the driver leaves silent step (SS_THR).
+  uint8_t threshold;
+};
+
+/// What BasicDRV8434S::restoreSettings() found and did.
+struct DRV8461RestoreReport
+{
+  /// The settings registers that did not match the cache and were rewritten,
+  /// one bit per register address.
+  uint64_t drifted;
+
+  /// The number of them.
+  uint8_t count;
+
+  /// Returns true if the given register was rewritten.
+  bool has(DRV8461_REG_ADDR address) const
+  {
+    return drifted & ((uint64_t)1 << (uint8_t)address);
+  }
+};
+
+/// The default statistics policy of BasicDRV8434SSPI: records nothing, and
+/// compiles to nothing.  See DRV8461_Instrumentation.h for one that counts.
+///
+/// A statistics class must provide `uint32_t start(const uint8_t * frames,
+/// uint8_t count)`, called with the outgoing 2-byte frames before each
+/// transfer, and `void finish(uint32_t started)`, called after it with the
+/// value start() returned.
+struct DRV8461NoStats
+{
+  uint32_t start(const uint8_t *, uint8_t) { return 0; }
+  void finish(uint32_t) {}
+};
+
+/// Called by BasicDRV8434S whenever the device returns the contents of a
+/// settings register as a side effect (the old data of a write) or on purpose
+/// (verifySettings()), with the context pointer given to
+/// setReadbackCallback().  `matches` is false if the settings bits differ
+/// from what the cache says the device should hold.
+typedef void (*DRV8461ReadbackCallback)(void * context, uint8_t address, bool matches);
+
+/// Called by BasicDRV8434SSPI after every transfer with the context pointer
+/// given to setStatusCallback() and the status byte of the last frame.
+typedef void (*DRV8461StatusCallback)(void * context, uint8_t status);
+
+
+// The first byte of a frame is 0, the read bit, then the 6-bit register
+// address (A5-A0).
+
+/// Returns the first byte of a frame that reads the given register.
+inline uint8_t DRV8461_readCommand(uint8_t address)
+{
+  return 0x40 | (address & 0b111111);
+}
+
+/// Returns the first byte of a frame that writes the given register.
+inline uint8_t DRV8461_writeCommand(uint8_t address)
+{
+  return address & 0b111111;
+}
+
+/// Returns the register address encoded in the first byte of a frame.
+inline uint8_t DRV8461_commandAddress(uint8_t command)
+{
+  return command & 0b111111;
+}
+
+/// Returns true if the first byte of a frame requests a read.
+inline bool DRV8461_commandIsRead(uint8_t command)
+{
+  return command & 0x40;
+}
+
+
+#if defined(ARDUINO)
+
+/// The default bus for BasicDRV8434SSPI: the Arduino SPI library plus a GPIO
+/// chip select.
+///
+/// A bus class must provide
+/// `void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)`,
+/// which shifts `frameCount` consecutive frames of `frameLength` bytes through
+/// the device in place, under a single bus acquisition, with chip select
+/// asserted around each frame, and `setClock(uint32_t hz)`, which changes the
+/// SPI clock frequency.  See DRV8461_SpiDev.h for a Linux bus.
+class DRV8461ArduinoBus
+{
+public:
+  /// Configures this object to use the specified pin as a chip select pin.
+  void setChipSelectPin(uint8_t pin)
+  {
+    csPin = pin;
+    pinMode(csPin, OUTPUT);
+    digitalWrite(csPin, HIGH);
+  }
+
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    SPI.beginTransaction(settings);
+    for (uint8_t i = 0; i < frameCount; i++)
+    {
+      digitalWrite(csPin, LOW);
+      for (uint8_t j = 0; j < frameLength; j++)
+      {
+        *frames = SPI.transfer(*frames);
+        frames++;
+      }
+      // The CS line must go high after writing for the value to actually take
+      // effect.
+      digitalWrite(csPin, HIGH);
+    }
+    SPI.endTransaction();
+  }
+
+  /// Sets the SPI clock frequency.  The default is 500 kHz.
+  void setClock(uint32_t hz)
+  {
+    settings = SPISettings(hz, MSBFIRST, SPI_MODE1);
+  }
+
+private:
+
+  SPISettings settings = SPISettings(500000, MSBFIRST, SPI_MODE1);
+
+  uint8_t csPin;
+};
+
+#endif
 
 
 ///FROM POLOLU FILE**********************************************
@@ -22,7 +209,13 @@
 ///
 /// Most users should use the HighPowerStepperDriver class, which provides a
 /// higher-level interface, instead of this class.
-class DRV8434SSPI
+///
+/// The bus is a template parameter (see DRV8461ArduinoBus), so the same code
+/// can run on Arduino or, with DRV8461SpiDevBus, on Linux.  DRV8434SSPI is
+/// this class with the Arduino bus.  `Stats` sees every transfer (see
+/// DRV8461NoStats and DRV8461BusStats).
+template <class Bus, class Stats = DRV8461NoStats>
+class BasicDRV8434SSPI
 {
 public:
   /// Configures this object to use the specified pin as a chip select pin.
@@ -30,9 +223,7 @@ public:
   /// You must use a chip select pin; the DRV8434S requires it.
   void setChipSelectPin(uint8_t pin)
   {
-    csPin = pin;
-    pinMode(csPin, OUTPUT);
-    digitalWrite(csPin, HIGH);
+    bus.setChipSelectPin(pin);
   }
 
   /// Reads the register at the given address and returns its raw value.
@@ -43,11 +234,10 @@ public:
     // Arduino in / DRV8434 out: First byte contains status; second byte
     // contains data in register being read.
 
-    selectChip();
-    lastStatus = transfer((0x20 | (address & 0b11111)) << 1);
-    uint8_t data = transfer(0);
-    deselectChip();
-    return data;
+    uint8_t frame[2] = { DRV8461_readCommand(address), 0 };
+    transfer(frame, 1);
+    setLastStatus(frame[0]);
+    return frame[1];
   }
 
   /// Reads the register at the given address and returns its raw value.
@@ -64,13 +254,10 @@ public:
     // Arduino in / DRV8434 out: First byte contains status; second byte
     // contains old (existing) data in register being written to.
 
-    selectChip();
-    lastStatus = transfer((address & 0b11111) << 1);
-    uint8_t oldData = transfer(value);
-    // The CS line must go low after writing for the value to actually take
-    // effect.
-    deselectChip();
-    return oldData;
+    uint8_t frame[2] = { DRV8461_writeCommand(address), value };
+    transfer(frame, 1);
+    setLastStatus(frame[0]);
+    return frame[1];
   }
 
   /// Writes the specified value to a register.
@@ -79,36 +266,97 @@ public:
     writeReg((uint8_t)address, value);
   }
 
-private:
+  /// Performs a list of register reads and writes under a single bus
+  /// acquisition.  Chip select is still pulsed between frames, because the
+  /// driver only latches a write when CS goes high.
+  ///
+  /// `results` must have room for `count` entries.  Each entry receives the
+  /// status byte of its frame and either the register contents (reads) or the
+  /// old register contents (writes).  lastStatus is updated from the final
+  /// frame.  Nothing is allocated.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// const DRV8461RegOp ops[] = {
+  ///   DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_FAULT),
+  ///   DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG1),
+  ///   DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG2),
+  /// };
+  /// DRV8461RegResult results[3];
+  /// sd.driver.transferBatch(ops, 3, results);
+  /// ~~~
+  void transferBatch(const DRV8461RegOp * ops, uint8_t count, DRV8461RegResult * results)
+  {
+    if (count == 0) { return; }
 
-  SPISettings settings = SPISettings(500000, MSBFIRST, SPI_MODE1);
+    // The results array is used as the transfer buffer: each entry is filled
+    // with the outgoing frame and overwritten in place by the incoming one.
+    uint8_t * frames = reinterpret_cast<uint8_t *>(results);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      frames[2 * i] = ops[i].isWrite ? DRV8461_writeCommand(ops[i].address) : DRV8461_readCommand(ops[i].address);
+      frames[2 * i + 1] = ops[i].isWrite ? ops[i].value : 0;
+    }
 
-  uint8_t transfer(uint8_t value)
-  {
-    return SPI.transfer(value);
+    transfer(frames, count);
+    setLastStatus(results[count - 1].status);
   }
 
-  void selectChip()
+  /// Registers a function to be called with the status byte after every
+  /// transfer, so faults can be noticed from traffic that is happening anyway
+  /// (see DRV8461FaultMonitor).  Pass nullptr to remove it.
+  ///
+  /// The callback runs in whatever context made the transfer.  It may start
+  /// transfers of its own, but it is not called again for those.
+  void setStatusCallback(DRV8461StatusCallback callback, void * context = nullptr)
   {
-    digitalWrite(csPin, LOW);
-    SPI.beginTransaction(settings);
+    statusCallback = callback;
+    statusContext = context;
   }
 
-  void deselectChip()
+  /// Records a status byte the device returned in a transfer made outside
+  /// this class, as by BasicDRV8461DaisyChain: updates lastStatus and calls
+  /// the status callback just as this class's own transfers do.
+  void reportStatus(uint8_t status)
   {
-   SPI.endTransaction();
-   digitalWrite(csPin, HIGH);
+    setLastStatus(status);
   }
 
-  uint8_t csPin;
+  /// The bus used to reach the driver.
+  Bus bus;
 
-public:
+  /// The statistics kept about the traffic on the bus.
+  Stats stats;
 
   /// The status reported by the driver during the last read or write.  This
   /// status is the same as that which would be returned by reading the FAULT
   /// register with DRV8434S::readFault(), except the upper two bits are always
   /// 1.
   uint8_t lastStatus = 0;
+
+private:
+
+  void transfer(uint8_t * frames, uint8_t count)
+  {
+    uint32_t started = stats.start(frames, count);
+    bus.transfer(frames, 2, count);
+    stats.finish(started);
+  }
+
+  void setLastStatus(uint8_t status)
+  {
+    lastStatus = status;
+    if (statusCallback && !inStatusCallback)
+    {
+      inStatusCallback = true;
+      statusCallback(statusContext, status);
+      inStatusCallback = false;
+    }
+  }
+
+  DRV8461StatusCallback statusCallback = nullptr;
+  void * statusContext = nullptr;
+  bool inStatusCallback = false;
 };
 
 
@@ -116,25 +364,21 @@ public:
 
 /// This class provides high-level functions for controlling a DRV8461, labelled 8434S stepper
 /// motor driver.
-class DRV8434S
+///
+/// `Bus` and `Stats` are passed on to BasicDRV8434SSPI.  DRV8434S is this
+/// class with the Arduino bus.
+template <class Bus, class Stats = DRV8461NoStats>
+class BasicDRV8434S
 {
 public:
   /// The default constructor.
-  DRV8434S()   //Purpose Unknown
+  BasicDRV8434S()   //Purpose Unknown
   {
     // All settings set to power-on defaults
-    ctrl1  = 0x0F;
-    ctrl2  = 0x06;
-    ctrl3  = 0x38;
-    ctrl4  = 0x49;
-    ctrl5  = 0x03;
-    ctrl6  = 0x20;
-    ctrl9  = 0x10;
-    ctrl10 = 0x80;
-    ctrl11 = 0xFF;
-    ctrl12 = 0x20;
-    ctrl13 = 0x10;
-    ctrl14 = 0x58;
+    for (uint8_t address = 0; address < regAddressCount; address++)
+    {
+      regs[address] = DRV8461_regInfo(address).resetValue;
+    }
   }
 
   /// Configures this object to use the specified pin as a chip select pin.
@@ -151,19 +395,10 @@ public:
   /// operation of the driver.
   void resetSettings()
   {
-    ctrl1  = 0x0F;
-    ctrl2  = 0x06;
-    ctrl3  = 0x38;
-    ctrl4  = 0x49;
-    ctrl5  = 0x03;
-    ctrl6  = 0x20;
-    ctrl9  = 0x10;
-    ctrl10 = 0x80;
-    ctrl11 = 0xFF;
-    ctrl12 = 0x20;
-    ctrl13 = 0x10;
-    ctrl14 = 0x58;
-
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      regs[(uint8_t)settingsReg(i)] = DRV8461_regInfo(settingsReg(i)).resetValue;
+    }
 
     applySettings();
   }
@@ -173,24 +408,27 @@ public:
   ///
   /// This can be used to verify that the driver is powered on and has not lost
   /// them due to a power failure.  The STATUS register is not verified because
-  /// it does not contain any driver settings.
+  /// it does not contain any driver settings.  Bits that the driver updates or
+  /// clears by itself (see DRV8461RegInfo) are ignored.
   ///
   /// @return 1 if the settings from the device match the cached copies, 0 if
   /// they do not.
   bool verifySettings()
   {
-    return driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1)  == ctrl1  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2)  == ctrl2  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL3)  == ctrl3  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL4)  == ctrl4  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL5)  == ctrl5  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL6)  == ctrl6  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL9)  == ctrl9  &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL10) == ctrl10 &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11) == ctrl11 &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL12) == ctrl12 &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL13) == ctrl13 &&
-           driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL14) == ctrl14;
+    DRV8461RegOp ops[settingsRegCount];
+    DRV8461RegResult results[settingsRegCount];
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      ops[i] = DRV8461RegOp::read(settingsReg(i));
+    }
+    driver.transferBatch(ops, settingsRegCount, results);
+
+    bool ok = true;
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      ok &= checkReadback((uint8_t)settingsReg(i), results[i].data, getCachedReg(settingsReg(i)));
+    }
+    return ok;
   }
 
   /// Re-writes the cached settings stored in this class to the device.
@@ -200,57 +438,107 @@ public:
   /// verifySettings() returns false (due to a power interruption, for
   /// instance), then you could use applySettings() to get the device's settings
   /// back into the desired state.
+  ///
+  /// All of the writes are sent in one batch (see
+  /// DRV8434SSPI::transferBatch()).  The old data the device returns for each
+  /// write is passed to the readback callback, so a verifier learns which
+  /// registers had been lost.
   void applySettings()
   {
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL3);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL4);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL5);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL6);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL9);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL10);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL12);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL13);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL14);
+    DRV8461RegOp ops[settingsRegCount];
+    DRV8461RegResult results[settingsRegCount];
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      ops[i] = DRV8461RegOp::write(settingsReg(i), getCachedReg(settingsReg(i)));
+    }
+    driver.transferBatch(ops, settingsRegCount, results);
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      checkReadback((uint8_t)settingsReg(i), results[i].data, getCachedReg(settingsReg(i)));
+    }
+  }
+
+  /// Replaces all of the cached settings with those of `config` and writes
+  /// them to the device in one batch, as applySettings() does.
+  ///
+  /// With a constexpr configuration (see DRV8461DriverConfig) this is the
+  /// whole startup sequence: the register image is computed and checked at
+  /// compile time, and nothing is left to do here but copy it.
+  void applyConfig(const DRV8461DriverConfig & config)
+  {
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      regs[(uint8_t)settingsReg(i)] = config.reg(settingsReg(i));
+    }
+    applySettings();
+  }
+
+  /// Reads back the settings registers and rewrites only those that do not
+  /// match the cached copies.
+  ///
+  /// This is a cheaper alternative to applySettings() when most of the
+  /// settings are probably still intact, for example after a brief supply dip
+  /// reported by UVLO: all of the settings registers are read in one batch,
+  /// and the ones that differ (ignoring bits the driver updates by itself) are
+  /// written in a second batch, each once, in the order of applySettings() so
+  /// CTRL1 with EN_OUT comes last.  If nothing was lost, nothing is written.
+  /// The readbacks are passed to the readback callback like those of
+  /// verifySettings().
+  ///
+  /// @return Which registers were rewritten.
+  DRV8461RestoreReport restoreSettings()
+  {
+    DRV8461RegOp ops[settingsRegCount];
+    DRV8461RegResult results[settingsRegCount];
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      ops[i] = DRV8461RegOp::read(settingsReg(i));
+    }
+    driver.transferBatch(ops, settingsRegCount, results);
 
-    // CTRL1 is written last because it contains the EN_OUT bit, and we want to
-    // try to have all the other settings correct first.
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    DRV8461RestoreReport report = {};
+    for (uint8_t i = 0; i < settingsRegCount; i++)
+    {
+      DRV8461_REG_ADDR address = settingsReg(i);
+      if (!checkReadback((uint8_t)address, results[i].data, getCachedReg(address)))
+      {
+        ops[report.count++] = DRV8461RegOp::write(address, getCachedReg(address));
+        report.drifted |= (uint64_t)1 << (uint8_t)address;
+      }
+    }
+    if (report.count) { driver.transferBatch(ops, report.count, results); }
+    return report;
+  }
+
+  /// The number of registers that hold driver settings.
+  static constexpr uint8_t settingsRegCount = DRV8461RegTableHolder<>::settings.count;
+
+  /// Returns the address of the i-th register that holds driver settings, in
+  /// the order applySettings() writes them.  CTRL1 is last because it contains
+  /// the EN_OUT bit, and we want to try to have all the other settings correct
+  /// first.
+  static DRV8461_REG_ADDR settingsReg(uint8_t i)
+  {
+    return (DRV8461_REG_ADDR)DRV8461RegTableHolder<>::settings.addresses[i];
   }
 
   /// Sets the driver's current scalar (TRQ_DAC), which scales the full current
   /// limit (as set by VREF) by the specified percentage. The available settings
-  /// are multiples of 0.390625%.
+  /// are multiples of 0.390625% (1/256), from 0.390625% to 100%.
   ///
-  /// This function takes an integer, and if the desired current limit is not
-  /// available, it generally tries to pick the closest current limit that is
-  /// lower than the desired one (although the lowest possible setting is
-  /// 6.25%). However, it will round up if the next setting is no more than
-  /// 0.75% higher; this allows you to specify 43.75% by passing a value of 43,
-  /// for example.
+  /// Percentages above 100 are treated as 100.  If the desired current limit
+  /// is not available, this picks the closest setting that is lower than it.
   ///
   /// Example usage:
   /// ~~~{.cpp}
-  /// // This sets TRQ_DAC to 37.5% (the closest setting lower than 42%):
+  /// // This sets TRQ_DAC to 41.796875% (107/256, the closest setting lower
+  /// // than 42%):
   /// sd.setCurrentPercent(42);
-  ///
-  /// // This sets TRQ_DAC to 43.75% (rounding 43 up by 0.75% to 43.75%):
-  /// sd.setCurrentPercent(43);
-  ///
-  /// // This also sets TRQ_DAC to 43.75%; even though the argument is truncated
-  /// // to an integer (43), that is then rounded up by 0.75% to 43.75%:
-  /// sd.setCurrentPercent(43.75);
   /// ~~~
   void setCurrentPercent(uint8_t percent)
   {
     if (percent > 100) { percent = 100; }
-    if (percent < 1) { percent = 1; }
-
-    uint8_t td = ((uint16_t)percent * 64 / 25) - 1; // convert 0-100 to 0-255
-    if (td == 0) { td = 1; }                   // restrict to 1-16
-    ctrl11 = td;
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11);
+    setField<DRV8461Fields::TRQ_DAC>((DRV_Run_Current)DRV8461_currentPercentToDac(percent));
   }
 
   /// Sets the driver's current scalar (TRQ_DAC) to produce the specified scaled
@@ -260,41 +548,70 @@ public:
   /// This is specified by the optional `fullCurrent` argument, which defaults
   /// to 2000 milliamps (2 A).
   ///
-  /// If the desired current limit is not
-  /// available, this function tries to pick the closest current limit that is
-  /// lower than the desired one (although the lowest possible setting is 6.25%
-  /// of the full current limit).
+  /// Currents above `fullCurrent` are treated as `fullCurrent`.  If the
+  /// desired current limit is not available, this function picks the closest
+  /// current limit that is lower than the desired one (although the lowest
+  /// possible setting is 1/256 of the full current limit).
+  ///
+  /// This divides on every call; to set currents often, look them up in a
+  /// DRV8461CurrentTable instead.
   ///
   /// Example usage:
   /// ~~~{.cpp}
   /// // This specifies that we want a scaled current limit of 1200 mA and that
   /// // VREF is set to produce a full current limit of 1500 mA. TRQ_DAC will be
-  /// // set to 75%, which will produce a 1125 mA scaled current limit.
+  /// // set to 204/256 (79.7%), which will produce a 1195 mA scaled current limit.
   /// sd.setCurrentMilliamps(1200, 1500);
   /// ~~~
   void setCurrentMilliamps(uint16_t current, uint16_t fullCurrent = 2000)
   {
-    if (fullCurrent > 4000) { fullCurrent = 4000; }
     if (current > fullCurrent) { current = fullCurrent; }
+    setField<DRV8461Fields::TRQ_DAC>((DRV_Run_Current)DRV8461_currentToDac(current, fullCurrent));
+  }
+
+  /// Enables standstill power saving (EN_STSL = 1): after no step for the
+  /// delay set with setStandstillTiming(), the driver lowers the coil current
+  /// to the standstill current (ISTSL), and it restores the run current at
+  /// the next step.  DIAG2 STSL is set while the current is reduced.
+  void enableStandstillPowerSaving()
+  {
+    setField<DRV8461Fields::EN_STSL>(true);
+  }
 
-    uint8_t td = (current * 256 / fullCurrent); // convert 0-fullCurrent to 0-16
-    if (td == 0) { td = 1; }                   // restrict to 1-16
-    ctrl11 = td;
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11);
+  /// Disables standstill power saving (EN_STSL = 0).
+  void disableStandstillPowerSaving()
+  {
+    setField<DRV8461Fields::EN_STSL>(false);
+  }
+
+  /// Sets how long after the last step standstill power saving starts
+  /// (TSTSL_DLY) and how long the current takes to fall to the standstill
+  /// current (TSTSL_FALL).  See DRV8461_standstillDelay() and
+  /// DRV8461_standstillFallTime() for conversions from milliseconds.
+  void setStandstillTiming(DRV8461_Delay_Until_Standstill delay, DRV8461_Current_Reduction_Time fall)
+  {
+    setField<DRV8461Fields::TSTSL_DLY>(delay);
+    setField<DRV8461Fields::TSTSL_FALL>(fall);
+  }
+
+  /// Sets the standstill current (ISTSL) in milliamps, in the same way as
+  /// setCurrentMilliamps() sets the run current.
+  void setStandstillCurrentMilliamps(uint16_t current, uint16_t fullCurrent = 2000)
+  {
+    if (current > fullCurrent) { current = fullCurrent; }
+    setField<DRV8461Fields::ISTSL>((DRV8461_Holding_Current)DRV8461_currentToDac(current, fullCurrent));
   }
 
   /// Enables the driver (EN_OUT = 1).
   void enableDriver()
   {
-    ctrl1 |= (1 << 7);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    setField<DRV8461Fields::EN_OUT>(true);
   }
 
   /// Disables the driver (EN_OUT = 0).
   void disableDriver()
   {
-    ctrl1 &= ~(1 << 7);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    setField<DRV8461Fields::EN_OUT>(false);
   }
 
   /// Sets the driver's decay mode (DECAY).
@@ -305,8 +622,7 @@ public:
   /// ~~~
   void setDecayMode(DRV8461_Decay_Mode mode)
   {
-    ctrl1 = (ctrl1 & 0b11111000) | ((uint8_t)mode & 0b111);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    setField<DRV8461Fields::DECAY>(mode);
   }
 
   /// Sets the motor direction (DIR).
@@ -319,15 +635,7 @@ public:
   /// disconnected.
   void setDirection(bool value)
   {
-    if (value)
-    {
-      ctrl2 |= (1 << 7);
-    }
-    else
-    {
-      ctrl2 &= ~(1 << 7);
-    }
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::DIR>(value);
   }
 
   /// Returns the cached value of the motor direction (DIR).
@@ -335,7 +643,7 @@ public:
   /// This does not perform any SPI communication with the driver.
   bool getDirection()
   {
-    return (ctrl2 >> 7) & 1;
+    return getField<DRV8461Fields::DIR>();
   }
 
   /// Advances the indexer by one step (STEP = 1).
@@ -347,39 +655,35 @@ public:
   /// The driver automatically clears the STEP bit after it is written.
   void step()
   {
-    driver.writeReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2, ctrl2 | (1 << 6));
+    writeSelfClearing<DRV8461Fields::STEP>();
   }
 
   /// Enables direction control through SPI (SPI_DIR = 1), allowing
   /// setDirection() to override the DIR pin.
   void enableSPIDirection()
   {
-    ctrl2 |= (1 << 5);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::SPI_DIR>(true);
   }
 
   /// Disables direction control through SPI (SPI_DIR = 0), making the DIR pin
   /// control direction instead.
   void disableSPIDirection()
   {
-    ctrl2 &= ~(1 << 5);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::SPI_DIR>(false);
   }
 
   /// Enables stepping through SPI (SPI_STEP = 1), allowing step() to override
   /// the STEP pin.
   void enableSPIStep()
   {
-    ctrl2 |= (1 << 4);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::SPI_STEP>(true);
   }
 
   /// Disables stepping through SPI (SPI_STEP = 0), making the STEP pin control
   /// stepping instead.
   void disableSPIStep()
   {
-    ctrl2 &= ~(1 << 4);
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::SPI_STEP>(false);
   }
 
   /// Sets the driver's stepping mode (MICROSTEP_MODE).
@@ -403,8 +707,7 @@ public:
       mode = DRV8461_Micostep_Mode::DRV8461_MICROSTEP_16;
     }
 
-    ctrl2 = (ctrl2 & 0b11110000) | (uint8_t)mode;
-    writeCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+    setField<DRV8461Fields::MICROSTEP_MODE>(mode);
   }
 
   /// Sets the driver's stepping mode (MICROSTEP_MODE).
@@ -433,10 +736,13 @@ public:
       case 256: sm = DRV8461_Micostep_Mode::DRV8461_MICROSTEP_256;  break;
 
       // Invalid mode; pick 1/16 micro-step by default, returns 0 for error checking.
-      default:  sm = DRV8461_Micostep_Mode::DRV8461_MICROSTEP_16; return(sm, 1);
+      default:
+        setStepMode(DRV8461_Micostep_Mode::DRV8461_MICROSTEP_16);
+        return 0;
     }
 
-    setStepMode(sm, 0);
+    setStepMode(sm);
+    return 1;
   }
 
   /// Reads the FAULT status register of the driver.
@@ -480,12 +786,363 @@ public:
     return driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_DIAG2);
   }
 
+  /// Reads the DIAG3 status register of the driver.
+  ///
+  /// Use the DRV8461_DIAG3_Reg_Val enum to check individual bits.
+  uint8_t readDiag3()
+  {
+    return driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_DIAG3);
+  }
+
+  /// Reads the supply voltage measurement (VM_ADC, 5 bits) from CTRL14.
+  uint8_t readSupplyVoltageADC()
+  {
+    return DRV8461Fields::VM_ADC::extract(driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL14));
+  }
+
+  /// Reads the selected status and measurement registers in one batch (see
+  /// DRV8434SSPI::transferBatch()) and stores them in `status` along with
+  /// `time`.
+  ///
+  /// `select` is a combination of DRV8461_STATUS_SELECT bits; narrowing it
+  /// shortens the batch.  Registers that are not selected are stored as 0.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// DRV8461DriverStatus status;
+  /// sd.readStatus(status, micros());
+  /// if (status.has(DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_OTW)) { /* ... */ }
+  /// ~~~
+  void readStatus(DRV8461DriverStatus & status, uint32_t time, uint8_t select = DRV8461_STATUS_ALL)
+  {
+    typedef DRV8461StatusSourceHolder<> Sources;
+
+    DRV8461RegOp ops[Sources::count];
+    DRV8461RegResult results[Sources::count];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < Sources::count; i++)
+    {
+      if (select & Sources::sources[i].select)
+      {
+        ops[count++] = DRV8461RegOp::read(Sources::sources[i].address);
+      }
+    }
+    driver.transferBatch(ops, count, results);
+
+    status = DRV8461DriverStatus();
+    status.time = time;
+    status.sampled = select & DRV8461_STATUS_ALL;
+    count = 0;
+    for (uint8_t i = 0; i < Sources::count; i++)
+    {
+      if (select & Sources::sources[i].select)
+      {
+        status.*Sources::sources[i].member = results[count++].data;
+      }
+    }
+  }
+
+
+
+  /// Reads the load measured by the auto-torque block (ATQ_CNT, 11 bits).
+  ///
+  /// Both halves of the count are read in one batch.
+  uint16_t readLoadTorque()
+  {
+    static const DRV8461RegOp ops[] = {
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL2),
+    };
+    DRV8461RegResult results[2];
+    driver.transferBatch(ops, 2, results);
+    return DRV8461Fields::ATQ_CNT::extract(results[0].data, results[1].data);
+  }
+
+  /// Enables stall detection (EN_STL = 1).  A stall sets STALL in DIAG2 and
+  /// STL in FAULT, and also pulls nFAULT low if `reportOnFault` is true
+  /// (STL_REP).
+  ///
+  /// The stall threshold must be set first, either with setStallThreshold()
+  /// or by learning it (see startStallLearning()).
+  void enableStallDetection(bool reportOnFault = true)
+  {
+    setField<DRV8461Fields::STL_REP>(reportOnFault);
+    setField<DRV8461Fields::EN_STL>(true);
+  }
+
+  /// Disables stall detection (EN_STL = 0).
+  void disableStallDetection()
+  {
+    setField<DRV8461Fields::EN_STL>(false);
+  }
+
+  /// Sets the stall threshold (STALL_TH, 12 bits).  A stall is reported when
+  /// the back-EMF torque count (TRQ_COUNT) falls below it.  Larger values are
+  /// clipped.
+  ///
+  /// Use this to restore a threshold saved from getStallThreshold() after a
+  /// successful learning run.
+  void setStallThreshold(uint16_t threshold)
+  {
+    if (threshold > DRV8461Fields::STALL_TH::maxValue()) { threshold = DRV8461Fields::STALL_TH::maxValue(); }
+    setField<DRV8461Fields::STALL_TH>(threshold);
+  }
+
+  /// Returns the cached stall threshold (STALL_TH).
+  ///
+  /// This does not perform any SPI communication with the driver.
+  uint16_t getStallThreshold()
+  {
+    return getField<DRV8461Fields::STALL_TH>();
+  }
+
+  /// Starts learning the stall threshold (STL_LRN = 1).
+  ///
+  /// The motor must be turning at the speed it will stall-detect at, with no
+  /// load, until pollStallLearning() returns true.
+  ///
+  /// The driver automatically clears the STL_LRN bit after it is written.
+  void startStallLearning()
+  {
+    writeSelfClearing<DRV8461Fields::STL_LRN>();
+  }
+
+  /// Checks whether learning started by startStallLearning() has succeeded
+  /// (STL_LRN_OK in DIAG2).  Once it has, the learned threshold is read into
+  /// the cached settings, so getStallThreshold() returns it and
+  /// applySettings() restores it after a power loss.
+  ///
+  /// @return true if learning has succeeded.
+  bool pollStallLearning()
+  {
+    if (!(readDiag2() & (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STL_LRN_OK)) { return false; }
+
+    static const DRV8461RegOp ops[] = {
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_CTRL5),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_CTRL6),
+    };
+    DRV8461RegResult results[2];
+    driver.transferBatch(ops, 2, results);
+    DRV8461Fields::STALL_TH::modify(reg(DRV8461_REG_ADDR::DRV8461_REG_CTRL5),
+      reg(DRV8461_REG_ADDR::DRV8461_REG_CTRL6),
+      DRV8461Fields::STALL_TH::extract(results[0].data, results[1].data));
+    return true;
+  }
+
+  /// Enables silent step decay (EN_SS = 1).  Below the SS_THR step rate the
+  /// driver regulates the current with the silent step loop; above it, it
+  /// falls back to the mode set with setDecayMode().
+  void enableSilentStep()
+  {
+    setField<DRV8461Fields::EN_SS>(true);
+  }
+
+  /// Disables silent step decay (EN_SS = 0).
+  void disableSilentStep()
+  {
+    setField<DRV8461Fields::EN_SS>(false);
+  }
+
+  /// Sets all of the silent step settings (SS_CTRL1-5).  The registers that
+  /// change are written in one batch, or only cached inside a transaction.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// sd.setSilentStep({ true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_4US, 24, 8, 1, 2, 160 });
+  /// ~~~
+  void setSilentStep(const DRV8461SilentStepSettings & settings)
+  {
+    bool ownTransaction = !transactionOpen;
+    if (ownTransaction) { beginTransaction(); }
+    setField<DRV8461Fields::SS_SMPL_SEL>(settings.sampling);
+    setField<DRV8461Fields::EN_SS>(settings.enabled);
+    setField<DRV8461Fields::SS_KP>(clip<DRV8461Fields::SS_KP>(settings.kp));
+    setField<DRV8461Fields::SS_KI>(clip<DRV8461Fields::SS_KI>(settings.ki));
+    setField<DRV8461Fields::SS_KP_DIV_SEL>(clip<DRV8461Fields::SS_KP_DIV_SEL>(settings.kpDivider));
+    setField<DRV8461Fields::SS_KI_DIV_SEL>(clip<DRV8461Fields::SS_KI_DIV_SEL>(settings.kiDivider));
+    setField<DRV8461Fields::SS_THR>(settings.threshold);
+    if (ownTransaction) { commit(); }
+  }
+
+  /// Returns the cached silent step settings.
+  ///
+  /// This does not perform any SPI communication with the driver.
+  DRV8461SilentStepSettings getSilentStep()
+  {
+    DRV8461SilentStepSettings settings;
+    settings.enabled = getField<DRV8461Fields::EN_SS>();
+    settings.sampling = getField<DRV8461Fields::SS_SMPL_SEL>();
+    settings.kp = getField<DRV8461Fields::SS_KP>();
+    settings.ki = getField<DRV8461Fields::SS_KI>();
+    settings.kpDivider = getField<DRV8461Fields::SS_KP_DIV_SEL>();
+    settings.kiDivider = getField<DRV8461Fields::SS_KI_DIV_SEL>();
+    settings.threshold = getField<DRV8461Fields::SS_THR>();
+    return settings;
+  }
+
+  /// Loads a custom microstep table (see DRV8461_Wavetable.h) and selects it
+  /// instead of the built-in sine table if `enable` is true (EN_CUSTOM).
+  ///
+  /// Only the registers that differ from the cached settings are written, so
+  /// switching between a few precomputed tables costs a handful of frames.
+  /// The writes and a readback of the same registers go out in one batch.
+  /// Inside a transaction (see beginTransaction()) the registers are only
+  /// marked dirty, like the other setters, and commit() writes them.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// constexpr DRV8461Wavetable flat = DRV8461_harmonicWavetable(8, 0);
+  /// sd.setWavetable(flat);
+  /// ~~~
+  ///
+  /// @return true if the readback matched, or if the writes were deferred.
+  bool setWavetable(const DRV8461Wavetable & table, bool enable = true)
+  {
+    const uint8_t first = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL2;
+    const uint8_t n = DRV8461_WAVETABLE_POINTS + 1;
+    DRV8461RegOp ops[2 * n];
+    DRV8461RegResult results[2 * n];
+    uint8_t writes = 0;
+    for (uint8_t i = 0; i < DRV8461_WAVETABLE_POINTS; i++)
+    {
+      if (regs[first + i] == table.current[i]) { continue; }
+      regs[first + i] = table.current[i];
+      ops[writes++] = DRV8461RegOp::write((DRV8461_REG_ADDR)(first + i), table.current[i]);
+    }
+    if (DRV8461Fields::EN_CUSTOM::get(regs) != enable)
+    {
+      DRV8461Fields::EN_CUSTOM::set(regs, enable);
+      ops[writes++] = DRV8461RegOp::write(DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL1, reg(DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL1));
+    }
+    if (!writes) { return true; }
+
+    if (transactionOpen)
+    {
+      for (uint8_t i = 0; i < writes; i++)
+      {
+        dirtyRegs |= (uint64_t)1 << ops[i].address;
+      }
+      deferredWrites += writes;
+      return true;
+    }
+
+    for (uint8_t i = 0; i < writes; i++)
+    {
+      ops[writes + i] = DRV8461RegOp::read((DRV8461_REG_ADDR)ops[i].address);
+    }
+    driver.transferBatch(ops, 2 * writes, results);
+
+    bool ok = true;
+    for (uint8_t i = 0; i < writes; i++)
+    {
+      ok &= checkReadback(ops[i].address, results[writes + i].data, ops[i].value);
+    }
+    return ok;
+  }
+
+  /// Returns the cached custom microstep table.
+  ///
+  /// This does not perform any SPI communication with the driver.
+  DRV8461Wavetable getWavetable()
+  {
+    DRV8461Wavetable table;
+    for (uint8_t i = 0; i < DRV8461_WAVETABLE_POINTS; i++)
+    {
+      table.current[i] = regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL2 + i];
+    }
+    return table;
+  }
+
+  /// Enables auto-torque (ATQ_EN = 1).  The driver then adjusts the current
+  /// between ATQ_TRQ_MIN and ATQ_TRQ_MAX to keep the load count (see
+  /// readLoadTorque()) between the lower and upper limits, so a lightly loaded
+  /// motor runs at less current.
+  ///
+  /// The learned constants (see startATQLearning()) must be valid first.
+  void enableATQ()
+  {
+    setField<DRV8461Fields::ATQ_EN>(true);
+  }
+
+  /// Disables auto-torque (ATQ_EN = 0); the current is set by TRQ_DAC alone.
+  void disableATQ()
+  {
+    setField<DRV8461Fields::ATQ_EN>(false);
+  }
+
+  /// Sets the band the auto-torque loop keeps the load count in (ATQ_LL and
+  /// ATQ_UL).  Below `lower` the current is reduced; above `upper` it is
+  /// raised.
+  void setATQLimits(uint8_t lower, uint8_t upper)
+  {
+    setField<DRV8461Fields::ATQ_LL>(lower);
+    setField<DRV8461Fields::ATQ_UL>(upper);
+  }
+
+  /// Sets the proportional and derivative gains of the auto-torque loop (KP
+  /// and KD) and the load change above which the derivative term is used
+  /// (ATQ_D_THR).  KD is 4 bits and is clipped.
+  void setATQGains(uint8_t kp, uint8_t kd, uint8_t dThreshold)
+  {
+    if (kd > DRV8461Fields::KD::maxValue()) { kd = DRV8461Fields::KD::maxValue(); }
+    setField<DRV8461Fields::KP>(kp);
+    setField<DRV8461Fields::KD>(kd);
+    setField<DRV8461Fields::ATQ_D_THR>(dThreshold);
+  }
 
+  /// Sets the lowest and highest currents auto-torque may choose
+  /// (ATQ_TRQ_MIN and ATQ_TRQ_MAX), on the same 0-255 scale as TRQ_DAC.
+  void setATQCurrentRange(uint8_t minimum, uint8_t maximum)
+  {
+    if (minimum > maximum) { minimum = maximum; }
+    setField<DRV8461Fields::ATQ_TRQ_MIN>(minimum);
+    setField<DRV8461Fields::ATQ_TRQ_MAX>(maximum);
+  }
+
+  /// Starts learning the auto-torque constants (LRN_START = 1).
+  ///
+  /// The motor must be turning at a steady speed with no load until
+  /// pollATQLearning() returns true.  Learning begins at `minCurrent` (TRQ_DAC
+  /// scale) and raises the current by `step` every `cycles` electrical
+  /// half-cycles.
+  ///
+  /// The driver automatically clears the LRN_START bit after it is written.
+  void startATQLearning(uint8_t minCurrent,
+    DRV8461_ATQ_Learn_Step step = DRV8461_ATQ_Learn_Step::DRV8461_ATQ_LRN_STEP_1,
+    DRV8461_ATQ_Learn_Cycles cycles = DRV8461_ATQ_Learn_Cycles::DRV8461_ATQ_LRN_CYCLES_8)
+  {
+    setField<DRV8461Fields::ATQ_LRN_MIN_CURRENT>(minCurrent);
+    setField<DRV8461Fields::LRN_STEP>(step);
+    setField<DRV8461Fields::LRN_CYCLE_SELECT>(cycles);
+    writeSelfClearing<DRV8461Fields::LRN_START>();
+  }
 
-//Reads the Mechanical Load Torque status.
-  uint8_t readLoadTorque()
+  /// Checks whether learning started by startATQLearning() has finished
+  /// (ATQ_LRN_DONE).  Once it has, the learned constants are read into the
+  /// cached settings, so applySettings() restores them after a power loss
+  /// and getField<DRV8461Fields::LRN_CONST1>() returns them.
+  ///
+  /// @return true if learning has finished.
+  bool pollATQLearning()
   {
-    return driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ;_CTRL1)
+    if (!DRV8461Fields::ATQ_LRN_DONE::extract(driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL10)))
+    {
+      return false;
+    }
+
+    static const DRV8461RegOp ops[] = {
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL12),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL13),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL14),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL15),
+    };
+    DRV8461RegResult results[4];
+    driver.transferBatch(ops, 4, results);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+      regs[ops[i].address] = results[i].data;
+    }
+    return true;
   }
 
   /// Clears any fault conditions that are currently latched in the driver
@@ -499,7 +1156,7 @@ public:
   /// The driver automatically clears the CLR_FLT bit after it is written.
   void clearFaults()
   {
-    driver.writeReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL3, ctrl3 | (1 << 7));
+    writeSelfClearing<DRV8461Fields::CLR_FLT>();
   }
 
   /// Gets the cached value of a register. If the given register address is not
@@ -511,6 +1168,37 @@ public:
     return *cachedReg;
   }
 
+  /// Returns the cached value of a register field, such as
+  /// DRV8461Fields::TOFF or the 12-bit DRV8461Fields::STALL_TH.
+  ///
+  /// This does not perform any SPI communication with the driver.
+  template <typename Field>
+  typename Field::Value getField()
+  {
+    return Field::get(regs);
+  }
+
+  /// Sets a register field in the cached settings and writes the register (or
+  /// both registers, for a field split across two) to the device.
+  ///
+  /// The value must be of the field's own type, so passing, for example, a
+  /// DRV8461_PWM_TOFF value to DRV8461Fields::DECAY does not compile.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// sd.setField<DRV8461Fields::TOFF>(DRV8461_PWM_TOFF::DRV8461_TOFF_27US);
+  /// sd.setField<DRV8461Fields::STALL_TH>(200);
+  /// ~~~
+  template <typename Field>
+  void setField(typename Field::Value value)
+  {
+    uint8_t previous = regs[(uint8_t)Field::address];
+    uint8_t previousHigh = regs[(uint8_t)Field::highAddress];
+    Field::set(regs, value);
+    writeCachedReg(Field::address, previous);
+    if (Field::highAddress != Field::address) { writeCachedReg(Field::highAddress, previousHigh); }
+  }
+
   /// Writes the specified value to a register after updating the cached value
   /// to match.
   ///
@@ -520,95 +1208,207 @@ public:
   /// specific settings that this library provides, you should use this function
   /// for direct register accesses instead of calling DRV8434SSPI::writeReg()
   /// directly.
+  ///
+  /// Inside a transaction (see beginTransaction()) only the cached value is
+  /// updated.
   void setReg(DRV8461_REG_ADDR address, uint8_t value)
   {
     uint8_t * cachedReg = cachedRegPtr(address);
     if (!cachedReg) { return; }
+    uint8_t previous = *cachedReg;
     *cachedReg = value;
-    driver.writeReg(address, value);
+    writeCachedReg(address, previous);
+  }
+
+  /// Starts a transaction.  Until commit() is called, the setters in this class
+  /// (and setReg()) only update the cached settings and mark the registers they
+  /// touch as dirty; nothing is sent to the device.
+  ///
+  /// step() and clearFaults() are not deferred, since their bits clear
+  /// themselves.  Calling this while a transaction is already open does
+  /// nothing.
+  ///
+  /// Example usage:
+  /// ~~~{.cpp}
+  /// sd.beginTransaction();
+  /// sd.setDecayMode(DRV8461_Decay_Mode::DRV8461_DECAY_SMART_RIPPLE);
+  /// sd.setStepMode(DRV8461_Micostep_Mode::DRV8461_MICROSTEP_32);
+  /// sd.enableSPIDirection();
+  /// sd.setCurrentPercent(50);
+  /// sd.enableDriver();
+  /// sd.commit();   // three writes: CTRL2, CTRL11, then CTRL1
+  /// ~~~
+  void beginTransaction()
+  {
+    if (transactionOpen) { return; }
+    transactionOpen = true;
+    dirtyRegs = 0;
+    deferredWrites = 0;
+    for (uint8_t address = 0; address < regAddressCount; address++)
+    {
+      transactionBase[address] = getCachedReg((DRV8461_REG_ADDR)address);
+    }
+  }
+
+  /// Ends the current transaction and writes each dirty register whose cached
+  /// value differs from its value when the transaction began.  The writes go
+  /// out in one batch in ascending address order, except that CTRL1 is written
+  /// last because it contains the EN_OUT bit.
+  ///
+  /// @return The number of register writes saved compared to sending every
+  /// deferred write immediately.
+  uint16_t commit()
+  {
+    if (!transactionOpen) { return 0; }
+    transactionOpen = false;
+
+    const uint8_t ctrl1Address = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1;
+    DRV8461RegOp ops[regAddressCount];
+    uint8_t count = 0;
+    for (uint8_t address = 0; address < regAddressCount; address++)
+    {
+      if (address == ctrl1Address) { continue; }
+      if (isChanged(address)) { ops[count++] = DRV8461RegOp::write((DRV8461_REG_ADDR)address, getCachedReg((DRV8461_REG_ADDR)address)); }
+    }
+    if (isChanged(ctrl1Address)) { ops[count++] = DRV8461RegOp::write(DRV8461_REG_ADDR::DRV8461_REG_CTRL1, reg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1)); }
+
+    if (count)
+    {
+      DRV8461RegResult results[regAddressCount];
+      driver.transferBatch(ops, count, results);
+      for (uint8_t i = 0; i < count; i++)
+      {
+        checkReadback(ops[i].address, results[i].data, transactionBase[ops[i].address]);
+      }
+    }
+
+    dirtyRegs = 0;
+    return deferredWrites - count;
+  }
+
+  /// Returns true if a transaction is open.
+  bool inTransaction() const
+  {
+    return transactionOpen;
+  }
+
+  /// Registers a function to be told, for each settings register the device
+  /// reports the contents of, whether they match the cache (see
+  /// DRV8461ReadbackCallback and DRV8461SettingsVerifier).  Pass nullptr to
+  /// remove it.
+  ///
+  /// Every write made through this class returns the register's old
+  /// contents, which should be what this class last wrote, so ordinary
+  /// traffic confirms the settings it touches at no extra cost.
+  void setReadbackCallback(DRV8461ReadbackCallback callback, void * context = nullptr)
+  {
+    readbackCallback = callback;
+    readbackContext = context;
   }
 
 protected:
 
-  uint8_t ctrl1, ctrl2, ctrl3, ctrl4, ctrl5, ctrl6, ctrl7, ctrl8, ctrl9, ctrl10, ctrl11, ctrl12, ctrl13, ctrl14, index1, index2, index3, index4, index5, custctrl1, custctrl2, custctrl3, custctrl4, custctrl5, custctrl6, custctrl7, custctrl8, custctrl9, atqctrl1, atqctrl2, atqctrl3, atqctrl4, atqctrl5, atqctrl6, atqctrl7, atqctrl8, atqctrl9, atqctrl10, atqctrl11, atqctrl12, atqctrl13, atqctrl14, atqctrl15, atqctrl16, atqctrl17, atqctrl18, ssctrl1, ssctrl2, ssctrl3, ssctrl4, ssctrl5;
+  /// Cached copy of every register, indexed by address.
+  uint8_t regs[DRV8461_REG_ADDR_COUNT];
+
+  /// Returns a reference to the cached value of the given register.
+  uint8_t & reg(DRV8461_REG_ADDR address)
+  {
+    return regs[(uint8_t)address];
+  }
 
   /// Returns a pointer to the variable containing the cached value for the
-  /// given register.
+  /// given register, or a null pointer if there is no register at the given
+  /// address.
   uint8_t * cachedRegPtr(DRV8461_REG_ADDR address)
   {
-    switch (address)
-    {
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL1: return &ctrl1;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL2: return &ctrl2;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL3: return &ctrl3;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL4: return &ctrl4;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL5: return &ctrl5;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL6: return &ctrl6;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL7: return &ctrl7;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL8: return &ctrl8;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL9: return &ctrl9;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL10: return &ctrl10;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL11: return &ctrl11;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL12: return &ctrl12;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL13: return &ctrl13;
-      case DRV8461_REG_ADDR::DRV8461_REG_CTRL14: return &ctrl14;
-      case DRV8461_REG_ADDR::DRV8461_REG_INDEX1: return &index1;
-      case DRV8461_REG_ADDR::DRV8461_REG_INDEX2: return &index2;
-      case DRV8461_REG_ADDR::DRV8461_REG_INDEX3: return &index3;
-      case DRV8461_REG_ADDR::DRV8461_REG_INDEX4: return &index4;
-      case DRV8461_REG_ADDR::DRV8461_REG_INDEX5: return &index5;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL1: return &custctrl1;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL2: return &custctrl2;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL3: return &custctrl3;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL4: return &custctrl4;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL5: return &custctrl5;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL6: return &custctrl6;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL7: return &custctrl7;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL8: return &custctrl8;
-      case DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL9: return &custctrl9;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1: return &atqctrl1;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL2: return &atqctrl2;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL3: return &atqctrl3;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL4: return &atqctrl4;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL5: return &atqctrl5;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL6: return &atqctrl6;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL7: return &atqctrl7;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL8: return &atqctrl8;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL9: return &atqctrl9;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL11: return &atqctrl11;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL12: return &atqctrl12;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL13: return &atqctrl13;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL14: return &atqctrl14;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL15: return &atqctrl15;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL16: return &atqctrl16;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL17: return &atqctrl17;
-      case DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL18: return &atqctrl18;
-      case DRV8461_REG_ADDR::DRV8461_REG_SS_CTRL1: return &ssctrl1;
-      case DRV8461_REG_ADDR::DRV8461_REG_SS_CTRL2: return &ssctrl2;
-      case DRV8461_REG_ADDR::DRV8461_REG_SS_CTRL3: return &ssctrl3;
-      case DRV8461_REG_ADDR::DRV8461_REG_SS_CTRL4: return &ssctrl4;
-      case DRV8461_REG_ADDR::DRV8461_REG_SS_CTRL5: return &ssctrl5;
-  
-      default: return nullptr;
-    }
+    if (!DRV8461_regInfo(address).present()) { return nullptr; }
+    return &regs[(uint8_t)address & (DRV8461_REG_ADDR_COUNT - 1)];
   }
 
   /// Writes the cached value of the given register to the device.
-  void writeCachedReg(DRV8461_REG_ADDR address)
+  /// `previous` is the cached value before it was changed, which the device
+  /// should return as the old data.
+  ///
+  /// Inside a transaction, the register is only marked dirty.
+  void writeCachedReg(DRV8461_REG_ADDR address, uint8_t previous)
   {
     uint8_t * cachedReg = cachedRegPtr(address);
-    if (!cachedReg) { return; }
-    driver.writeReg(address, *cachedReg);
+    if (!cachedReg || !DRV8461_regInfo(address).writableMask) { return; }
+    if (transactionOpen)
+    {
+      dirtyRegs |= (uint64_t)1 << (uint8_t)address;
+      deferredWrites++;
+      return;
+    }
+    checkReadback((uint8_t)address, driver.writeReg((uint8_t)address, *cachedReg), previous);
+  }
+
+  /// Writes a self-clearing bit (STEP, CLR_FLT, ...) along with the cached
+  /// value of the rest of its register.  These are not deferred by
+  /// transactions, so inside one the rest of the register goes out early and
+  /// becomes the value the transaction started from.
+  template <typename Field>
+  void writeSelfClearing()
+  {
+    const uint8_t address = (uint8_t)Field::address;
+    uint8_t value = regs[address];
+    uint8_t expected = transactionOpen ? transactionBase[address] : value;
+    checkReadback(address, driver.writeReg(address, Field::insert(value, true)), expected);
+    if (transactionOpen) { transactionBase[address] = value; }
+  }
+
+  /// Passes the contents the device reported for a register to the readback
+  /// callback.
+  ///
+  /// @return false if the settings bits differ from `expected`.
+  bool checkReadback(uint8_t address, uint8_t observed, uint8_t expected)
+  {
+    uint8_t mask = DRV8461_regInfo(address).settingsMask();
+    bool matches = !((observed ^ expected) & mask);
+    if (readbackCallback && mask) { readbackCallback(readbackContext, address, matches); }
+    return matches;
   }
 
+  DRV8461ReadbackCallback readbackCallback = nullptr;
+  void * readbackContext = nullptr;
+
+  static constexpr uint8_t regAddressCount = DRV8461_REG_ADDR_COUNT;
+
+  /// Limits a raw value to what the field can hold.
+  template <typename Field>
+  static uint8_t clip(uint8_t value)
+  {
+    return value > Field::maxValue() ? Field::maxValue() : value;
+  }
+
+  /// Returns true if the register at the given address is dirty and its cached
+  /// value differs from the value it had when the transaction began.
+  bool isChanged(uint8_t address)
+  {
+    if (!(dirtyRegs & ((uint64_t)1 << address))) { return false; }
+    return getCachedReg((DRV8461_REG_ADDR)address) != transactionBase[address];
+  }
+
+  bool transactionOpen = false;
+  uint16_t deferredWrites = 0;
+  uint64_t dirtyRegs = 0;
+  uint8_t transactionBase[regAddressCount];
+
 public:
   /// This object handles all the communication with the DRV8711.  Generally,
   /// you should not need to use it in your code for basic usage of a
   /// High-Power Stepper Motor Driver, but you might want to use it to access
   /// more advanced settings that the HighPowerStepperDriver class does not
   /// provide functions for.
-  DRV8434SSPI driver;
+  BasicDRV8434SSPI<Bus, Stats> driver;
 };
 
 
+#if defined(ARDUINO)
+typedef BasicDRV8434SSPI<DRV8461ArduinoBus> DRV8434SSPI;
+typedef BasicDRV8434S<DRV8461ArduinoBus> DRV8434S;
+#endif
+
+
 #endif                                    // #ifndef DRV8461_REGISTERS_H
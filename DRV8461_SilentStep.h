@@ -0,0 +1,260 @@
+#ifndef DRV8461_SILENTSTEP_H
+#define DRV8461_SILENTSTEP_H
+
+/*  DRV8461_SilentStep.h
+
+    Tuning of the DRV8461 silent step settings by sweeping them across speed
+    bands.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// One row of the result table filled in by DRV8461SilentStepTuner: a set of
+/// silent step settings and how fast the motor ran with them.
+///
+/// The table is plain data, so it can be stored as it is (in EEPROM or a
+/// file) and a row reapplied later with DRV8434S::setSilentStep().
+struct DRV8461SilentStepResult
+{
+  /// The settings tried.  Fill this in before calling sweep().
+  DRV8461SilentStepSettings settings;
+
+  /// The highest speed band (steps/s) that ran without a stall and with the
+  /// load count under the limit, or 0 if none did.
+  uint32_t maxStableSpeed;
+
+  /// The highest load count (ATQ_CNT) seen in that band.
+  uint16_t peakLoad;
+};
+
+/// The stepped velocity profile a sweep runs each setting through.
+struct DRV8461SilentStepBands
+{
+  /// The speed of each band in steps/s, in ascending order.
+  const uint32_t * speeds;
+  uint8_t count;
+
+  /// The acceleration used to reach each band, in steps/s^2.
+  uint32_t acceleration;
+
+  /// How long each band is held at full speed, in milliseconds.
+  uint32_t dwellTime;
+
+  /// The load count (ATQ_CNT) above which a band counts as unstable, even
+  /// without a stall.
+  uint16_t loadLimit;
+};
+
+/// States of DRV8461SilentStepTuner.
+enum class DRV8461_SilentStep_State : uint8_t {
+  DRV8461_SS_TUNE_IDLE    = 0,         // Nothing started yet.
+  DRV8461_SS_TUNE_RUNNING = 1,         // Running the bands for one of the settings.
+  DRV8461_SS_TUNE_DONE    = 2,         // Every setting has been tried.
+};
+
+
+/// This class finds the highest speed a motor runs at reliably with each of
+/// several candidate silent step settings.
+///
+/// For each row of the result table, the sweep applies the row's settings
+/// and runs the motor through the speed bands in order, alternating
+/// direction so the axis ends up near where it started.  While a band is at
+/// full speed, every tick reads DIAG2 and ATQ_CNT in one batch (three
+/// frames).  A stall, or a load count above the limit, ends the run for that
+/// row; otherwise the band is recorded as stable and the next one starts.
+///
+/// `Driver` is a BasicDRV8434S and `Engine` moves the motor; it must provide
+/// the plan(), start(), stop() and isRunning() members of
+/// DRV8461StepEngine.  Stall detection is enabled for the sweep, and the
+/// silent step and stall settings are put back as they were found when it
+/// ends.  The motor must be able to travel one band's worth of steps each
+/// way, under the load it will normally run with.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// static const uint32_t speeds[] = { 2000, 4000, 6000, 8000, 10000, 12000 };
+/// DRV8461SilentStepResult table[] = {
+///   { { true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_2US, 16, 8, 0, 0, 255 } },
+///   { { true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_4US, 32, 8, 1, 1, 255 } },
+/// };
+/// DRV8461SilentStepTuner<DRV8434S, DRV8461StepEngine<MyHal>> tuner(sd, engine);
+/// tuner.sweep(millis(), table, 2, { speeds, 6, 40000, 500, 1200 });
+/// while (tuner.tick(millis()) != DRV8461_SilentStep_State::DRV8461_SS_TUNE_DONE) { delay(2); }
+/// sd.setSilentStep(table[tuner.best(table, 2)].settings);
+/// ~~~
+template <class Driver, class Engine>
+class DRV8461SilentStepTuner
+{
+public:
+  DRV8461SilentStepTuner(Driver & sd, Engine & engine) : sd(sd), engine(engine)
+  {
+  }
+
+  /// Starts a sweep over the `count` rows of `results`, whose `settings`
+  /// must be filled in.  The other members are written as the sweep goes.
+  /// `bands` (and the speeds it points to) must stay valid until it ends.
+  ///
+  /// @return false if the engine is busy or there is nothing to do.
+  bool sweep(uint32_t now, DRV8461SilentStepResult * results, uint8_t count,
+    const DRV8461SilentStepBands & bands)
+  {
+    if (engine.isRunning() || !count || !bands.count) { return false; }
+
+    this->results = results;
+    this->count = count;
+    this->bands = bands;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      results[i].maxStableSpeed = 0;
+      results[i].peakLoad = 0;
+    }
+
+    original = sd.getSilentStep();
+    stallWasEnabled = sd.template getField<DRV8461Fields::EN_STL>();
+    if (!stallWasEnabled) { sd.enableStallDetection(); }
+
+    row = 0;
+    state = DRV8461_SilentStep_State::DRV8461_SS_TUNE_RUNNING;
+    startRow(now);
+    return true;
+  }
+
+  /// Advances the sweep.
+  ///
+  /// @return The state after this tick.
+  DRV8461_SilentStep_State tick(uint32_t now)
+  {
+    if (state != DRV8461_SilentStep_State::DRV8461_SS_TUNE_RUNNING) { return state; }
+
+    if (!bandRunning)
+    {
+      startBand(now);
+      return state;
+    }
+
+    if ((int32_t)(now - cruiseStart) >= 0)
+    {
+      uint16_t load;
+      bool stalled = sample(load);
+      if (load > bandPeak) { bandPeak = load; }
+      if (stalled || load > bands.loadLimit)
+      {
+        engine.stop();
+        sd.clearFaults();
+        nextRow(now);
+        return state;
+      }
+    }
+
+    if (!engine.isRunning())
+    {
+      results[row].maxStableSpeed = bands.speeds[band];
+      results[row].peakLoad = bandPeak;
+      bandRunning = false;
+      if (++band == bands.count) { nextRow(now); }
+    }
+    return state;
+  }
+
+  /// Returns the current state.
+  DRV8461_SilentStep_State getState() const
+  {
+    return state;
+  }
+
+  /// Returns the index of the row with the highest stable speed, preferring
+  /// the lower peak load on a tie.
+  static uint8_t best(const DRV8461SilentStepResult * results, uint8_t count)
+  {
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < count; i++)
+    {
+      if (results[i].maxStableSpeed > results[best].maxStableSpeed ||
+        (results[i].maxStableSpeed == results[best].maxStableSpeed && results[i].peakLoad < results[best].peakLoad))
+      {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+private:
+
+  void startRow(uint32_t now)
+  {
+    sd.setSilentStep(results[row].settings);
+    band = 0;
+    bandRunning = false;
+    startBand(now);
+  }
+
+  void nextRow(uint32_t now)
+  {
+    bandRunning = false;
+    if (++row < count)
+    {
+      startRow(now);
+      return;
+    }
+
+    sd.setSilentStep(original);
+    if (!stallWasEnabled) { sd.disableStallDetection(); }
+    state = DRV8461_SilentStep_State::DRV8461_SS_TUNE_DONE;
+  }
+
+  void startBand(uint32_t now)
+  {
+    // Accelerate, hold the speed for dwellTime, and decelerate.
+    uint64_t speed = bands.speeds[band];
+    uint64_t steps = speed * speed / bands.acceleration + speed * bands.dwellTime / 1000;
+    if (steps > INT32_MAX) { steps = INT32_MAX; }
+    if (!steps) { steps = 1; }
+
+    if (!engine.plan(band & 1 ? -(int32_t)steps : (int32_t)steps, (uint32_t)speed, bands.acceleration))
+    {
+      nextRow(now);
+      return;
+    }
+    engine.start();
+    cruiseStart = now + (uint32_t)(speed * 1000 / bands.acceleration);
+    bandPeak = 0;
+    bandRunning = true;
+  }
+
+  /// Reads ATQ_CNT into `load` and returns true if DIAG2 reports a stall.
+  bool sample(uint16_t & load)
+  {
+    static const DRV8461RegOp ops[] = {
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_DIAG2),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1),
+      DRV8461RegOp::read(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL2),
+    };
+    DRV8461RegResult r[3];
+    sd.driver.transferBatch(ops, 3, r);
+    load = DRV8461Fields::ATQ_CNT::extract(r[1].data, r[2].data);
+    return r[0].data & (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL;
+  }
+
+  Driver & sd;
+  Engine & engine;
+
+  DRV8461_SilentStep_State state = DRV8461_SilentStep_State::DRV8461_SS_TUNE_IDLE;
+  DRV8461SilentStepResult * results = nullptr;
+  uint8_t count = 0;
+  DRV8461SilentStepBands bands = {};
+
+  uint8_t row = 0;
+  uint8_t band = 0;
+  bool bandRunning = false;
+  uint32_t cruiseStart = 0;
+  uint16_t bandPeak = 0;
+
+  DRV8461SilentStepSettings original = {};
+  bool stallWasEnabled = false;
+};
+
+
+#endif                                    // #ifndef DRV8461_SILENTSTEP_H
@@ -0,0 +1,599 @@
+#ifndef DRV8461_SIMBUS_H
+#define DRV8461_SIMBUS_H
+
+/*  DRV8461_SimBus.h
+
+    In-process stand-in for a DRV8461 on an SPI bus, for running the driver
+    code on a host without hardware.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// A bus for BasicDRV8434SSPI (see DRV8461ArduinoBus) that emulates a single
+/// DRV8461 at the register level instead of talking to hardware.
+///
+/// Writes go through the writable masks in DRV8461_Register_Table.h, so
+/// read-only bits keep their values and self-clearing bits (STEP, CLR_FLT, ...)
+/// read back as 0.  Every frame returns the status byte (FAULT with the upper
+/// two bits set) and the old register contents, like the real device.
+///
+/// The register file is public so that code under test can be faced with
+/// faults, status flags or lost settings.  The counters record what the bus
+/// was asked to do, which is what the transfer batching in this library tries
+/// to reduce.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// BasicDRV8434S<DRV8461SimBus> sd;
+/// sd.applySettings();
+/// // sd.driver.bus.transactions == 1, sd.driver.bus.frames == DRV8461RegTableHolder<>::settings.count
+/// ~~~
+class DRV8461SimBus
+{
+public:
+  DRV8461SimBus()
+  {
+    powerOnReset();
+  }
+
+  /// Present for compatibility with DRV8461ArduinoBus; does nothing.
+  void setChipSelectPin(uint8_t)
+  {
+  }
+
+  /// Puts every register back to its power-on value, as after a power loss.
+  void powerOnReset()
+  {
+    for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+    {
+      regs[address] = DRV8461_regInfo(address).resetValue;
+    }
+  }
+
+  /// Changes the settings bits of `count` settings registers picked at random
+  /// (with `seed`), as a supply glitch might.  A register may be picked more
+  /// than once.
+  ///
+  /// @return The registers changed, one bit per address.
+  uint64_t corrupt(uint8_t count)
+  {
+    uint64_t changed = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      uint8_t address = DRV8461RegTableHolder<>::settings.addresses[random() % DRV8461RegTableHolder<>::settings.count];
+      uint8_t mask = DRV8461_regInfo(address).settingsMask();
+      uint8_t flip;
+      do { flip = random() & mask; } while (!flip);
+      regs[address] ^= flip;
+      changed |= (uint64_t)1 << address;
+    }
+    return changed;
+  }
+
+  /// Records the SPI clock frequency.
+  void setClock(uint32_t hz)
+  {
+    clockHz = hz;
+  }
+
+  /// Moves the emulated motor one step, as a pulse on the STEP pin would.
+  /// Stepping through SPI calls this too.
+  ///
+  /// If stall detection is enabled and the motor is at or beyond
+  /// `stallForward` or `stallReverse`, as if it had hit a hard stop, STALL is
+  /// set in DIAG2 and STL and FAULT in FAULT, and `position` stops changing.
+  void stepPin(bool forward)
+  {
+    if (forward ? position >= stallForward : position <= stallReverse)
+    {
+      stall();
+      return;
+    }
+    position += forward ? 1 : -1;
+  }
+
+  /// Sets the speed of the emulated motor in steps/s, as the code driving the
+  /// STEP pin would see it, and updates ATQ_CNT from it.
+  ///
+  /// If `maxStableRate` is set, it gives the highest rate the motor keeps up
+  /// with for the current register settings.  Up to that rate ATQ_CNT reads
+  /// `idleLoad`; above it the load count climbs steeply, and more than 25%
+  /// above it the motor stalls (as in stepPin()).
+  void setStepRate(uint32_t rate)
+  {
+    stepRate = rate;
+    uint32_t limit = maxStableRate ? maxStableRate(regs) : UINT32_MAX;
+    uint32_t load = idleLoad;
+    if (rate > limit)
+    {
+      load += (uint64_t)(rate - limit) * 8 * idleLoad / limit;
+      if (rate > limit + limit / 4) { stall(); }
+    }
+    if (load > DRV8461Fields::ATQ_CNT::maxValue()) { load = DRV8461Fields::ATQ_CNT::maxValue(); }
+    DRV8461Fields::ATQ_CNT::set(regs, load);
+  }
+
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    transactions++;
+    this->frames += frameCount;
+    bytes += (uint32_t)frameLength * frameCount;
+    busTime += transactionOverhead + (uint64_t)frameCount *
+      (frameGap + (uint64_t)frameLength * 8 * 1000000000 / (clockHz ? clockHz : 1));
+
+    if (frameLength != 2) { return; }   // See DRV8461SimChainBus for daisy chains.
+
+    for (uint8_t i = 0; i < frameCount; i++, frames += 2)
+    {
+      if (maxReliableHz && clockHz > maxReliableHz && (garble = !garble))
+      {
+        // Too fast: the frame is garbled, the device flags SPI_ERR, and the
+        // returned data is corrupted.
+        regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] |= (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR;
+        frames[1] = regs[DRV8461_commandAddress(frames[0])] ^ 0x10;
+        frames[0] = 0x80 | (regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] & 0x3F);
+        continue;
+      }
+
+      uint8_t status = statusByte();
+      frames[1] = execute(frames[0], frames[1]);
+      frames[0] = status;
+    }
+  }
+
+  /// Returns the status byte the device sends at the start of a frame.
+  uint8_t statusByte() const
+  {
+    return 0xC0 | (regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] & 0x3F);
+  }
+
+  /// Carries out one command as the device does when chip select goes high.
+  ///
+  /// @return The register contents (reads) or old register contents (writes).
+  uint8_t execute(uint8_t command, uint8_t value)
+  {
+    uint8_t address = DRV8461_commandAddress(command);
+    uint8_t old = regs[address];
+    if (!DRV8461_commandIsRead(command)) { write(address, value); }
+    return old;
+  }
+
+  /// Clears the latched faults, as writing CLR_FLT does.
+  void clearFaults()
+  {
+    for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++)
+    {
+      if (DRV8461_regInfo(a).group == DRV8461_REG_GROUP::DRV8461_GROUP_STATUS) { regs[a] = 0; }
+    }
+  }
+
+  /// The SPI clock frequency last set with setClock().
+  uint32_t clockHz = 500000;
+
+  /// If not 0, every other frame sent faster than this is corrupted.
+  uint32_t maxReliableHz = 0;
+
+  /// The emulated register file, indexed by address.
+  uint8_t regs[DRV8461_REG_ADDR_COUNT];
+
+  /// The number of transfer() calls (bus acquisitions).
+  uint32_t transactions = 0;
+
+  /// The number of frames (chip select pulses).
+  uint32_t frames = 0;
+
+  /// The number of bytes shifted in each direction.
+  uint32_t bytes = 0;
+
+  /// The time the bus would have been busy, in nanoseconds: the bits
+  /// shifted at `clockHz`, plus `frameGap` for each chip select pulse and
+  /// `transactionOverhead` for each transfer() call.  The defaults are
+  /// typical of a microcontroller SPI peripheral driven a frame at a time.
+  uint64_t busTime = 0;
+  uint32_t frameGap = 400;
+  uint32_t transactionOverhead = 2000;
+
+  /// The number of writes to registers that hold settings.
+  uint32_t settingWrites = 0;
+
+  /// The number of steps taken through the STEP bit.
+  uint32_t steps = 0;
+
+  /// The position of the emulated motor in steps.
+  int32_t position = 0;
+
+  /// The positions of the emulated hard stops (see stepPin()).
+  int32_t stallForward = INT32_MAX;
+  int32_t stallReverse = INT32_MIN;
+
+  /// The step rate last set with setStepRate().
+  uint32_t stepRate = 0;
+
+  /// See setStepRate().
+  uint32_t (*maxStableRate)(const uint8_t * regs) = nullptr;
+  uint16_t idleLoad = 300;
+
+  /// The state of the generator used by corrupt(); any value but 0.
+  uint32_t seed = 1;
+
+  /// The stall threshold "learned" when STL_LRN is written.
+  uint16_t learnedStallThreshold = 0x1A0;
+
+  /// The auto-torque constants "learned" when LRN_START is written.
+  uint16_t learnedConst1 = 0x155;
+  uint16_t learnedConst2 = 0x0AA;
+
+private:
+
+  bool garble = false;
+
+  /// Returns the next number from a xorshift generator.
+  uint32_t random()
+  {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+  }
+
+  void stall()
+  {
+    if (!DRV8461Fields::EN_STL::get(regs)) { return; }
+    regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2] |= (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL;
+    regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] |=
+      (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_STL | (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT;
+  }
+
+  void write(uint8_t address, uint8_t value)
+  {
+    const DRV8461RegInfo & info = DRV8461_regInfo(address);
+    if (!info.writableMask) { return; }
+    settingWrites++;
+
+    if (address == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL2 && DRV8461Fields::STEP::extract(value))
+    {
+      steps++;
+      stepPin(DRV8461Fields::DIR::extract(value));
+    }
+    if (address == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL4 && DRV8461Fields::STL_LRN::extract(value))
+    {
+      // Learning succeeds at once with the threshold given below.
+      DRV8461Fields::STALL_TH::set(regs, learnedStallThreshold);
+      regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2] |= (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STL_LRN_OK;
+    }
+    if (address == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL3 && DRV8461Fields::CLR_FLT::extract(value))
+    {
+      clearFaults();
+    }
+
+    regs[address] = (regs[address] & ~info.writableMask) | (value & info.settingsMask());
+
+    if (address == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL10 && DRV8461Fields::LRN_START::extract(value))
+    {
+      // Learning finishes at once with the constants given below.
+      DRV8461Fields::LRN_CONST1::set(regs, learnedConst1);
+      DRV8461Fields::LRN_CONST2::set(regs, learnedConst2);
+      DRV8461Fields::ATQ_LRN_DONE::modify(regs[address], true);
+    }
+  }
+};
+
+
+/// A bus for BasicDRV8461DaisyChain that emulates `Devices` DRV8461s wired as
+/// an SPI daisy chain, each one a DRV8461SimBus register file.
+///
+/// Each device is modelled as a one-byte shift register between its SDI and
+/// SDO.  During a frame it shifts out its status byte first and then each
+/// byte it received one byte earlier, except that it puts its report (the
+/// register contents, or the old contents for a write) in place of the byte
+/// that follows its own address byte.  HDR1 gives the chain length N, so
+/// every device finds its address byte at position N + 1 and its data byte
+/// at position 2N + 1 of what it received, whatever its place in the chain.
+/// Commands, and the CLR bit in HDR2, take effect when chip select goes
+/// high.  A device ignores frames whose header or length is wrong, or whose
+/// N leaves it out, and just shifts them through.
+///
+/// The counters are as in DRV8461SimBus.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// BasicDRV8461DaisyChain<DRV8461SimChainBus<3>, 3> chain;
+/// // add three devices, then:
+/// chain.applySettings();
+/// // chain.bus.devices[i].regs now hold device i's settings
+/// ~~~
+template <uint8_t Devices>
+class DRV8461SimChainBus
+{
+  static_assert(Devices >= 1 && Devices <= 63, "HDR1 holds a 6-bit device count");
+
+public:
+  /// Present for compatibility with DRV8461ArduinoBus; does nothing.
+  void setChipSelectPin(uint8_t)
+  {
+  }
+
+  /// Records the SPI clock frequency.
+  void setClock(uint32_t hz)
+  {
+    clockHz = hz;
+  }
+
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    transactions++;
+    this->frames += frameCount;
+    bytes += (uint32_t)frameLength * frameCount;
+    busTime += transactionOverhead + (uint64_t)frameCount *
+      (frameGap + (uint64_t)frameLength * 8 * 1000000000 / (clockHz ? clockHz : 1));
+
+    for (uint8_t i = 0; i < frameCount; i++, frames += frameLength)
+    {
+      shift(frames, frameLength);
+    }
+  }
+
+  /// The emulated devices; device 0 is the one the controller's SDO drives.
+  DRV8461SimBus devices[Devices];
+
+  /// See DRV8461SimBus.
+  uint32_t clockHz = 500000;
+  uint32_t transactions = 0;
+  uint32_t frames = 0;
+  uint32_t bytes = 0;
+  uint64_t busTime = 0;
+  uint32_t frameGap = 400;
+  uint32_t transactionOverhead = 2000;
+
+private:
+
+  /// Shifts one frame through the chain in place and then carries out the
+  /// commands it held.
+  void shift(uint8_t * frame, uint8_t length)
+  {
+    uint8_t in[255], out[255];
+    uint8_t command[Devices], data[Devices];
+    bool valid[Devices], clear[Devices];
+
+    for (uint8_t t = 0; t < length; t++) { in[t] = frame[t]; }
+
+    for (uint8_t k = 0; k < Devices; k++)
+    {
+      // The header reaches device k behind the status bytes of the k devices
+      // before it.
+      DRV8461SimBus & device = devices[k];
+      uint8_t n = length > k ? in[k] & 0x3F : 0;
+      valid[k] = length > k + 1 && (in[k] & 0xC0) == 0x80 && (in[k + 1] & 0xC0) == 0x80 &&
+        k < n && length == 2 * n + 2;
+      if (valid[k])
+      {
+        command[k] = in[n + 1];
+        data[k] = in[2 * n + 1];
+        clear[k] = in[k + 1] & 0x20;
+      }
+
+      out[0] = device.statusByte();
+      for (uint8_t t = 1; t < length; t++)
+      {
+        out[t] = (valid[k] && t == n + 2) ? device.regs[DRV8461_commandAddress(command[k])] : in[t - 1];
+      }
+      for (uint8_t t = 0; t < length; t++) { in[t] = out[t]; }
+    }
+
+    for (uint8_t t = 0; t < length; t++) { frame[t] = in[t]; }
+
+    for (uint8_t k = 0; k < Devices; k++)
+    {
+      if (!valid[k]) { continue; }
+      if (clear[k]) { devices[k].clearFaults(); }
+      devices[k].execute(command[k], data[k]);
+    }
+  }
+};
+
+
+/// A Hal for DRV8461StepEngine that runs the engine's timer in simulated
+/// time, so step sequences can be run and timed on a host.
+///
+/// run() plays the part of the timer interrupt: it advances `now` to each
+/// deadline set with startTimer() and calls the engine's onTimer(), until the
+/// timer is stopped.  Each step (each rising STEP edge, or each edge if
+/// `dualEdge` is set) is counted, moves `motor` if one is attached, and is
+/// passed with its time to `stepCallback` if one is set.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461SimStepHal hal;
+/// DRV8461StepEngine<DRV8461SimStepHal> engine(hal, 1000000);
+/// engine.plan(3200, 20000, 50000);
+/// engine.start();
+/// hal.run(engine);
+/// // hal.steps == 3200, hal.now is the duration of the move in ticks
+/// ~~~
+class DRV8461SimStepHal
+{
+public:
+  void writeStep(bool level)
+  {
+    bool edge = level != stepLevel;
+    stepLevel = level;
+    if (!edge || !(level || dualEdge)) { return; }
+
+    steps++;
+    if (motor) { motor->stepPin(dir); }
+    if (stepCallback) { stepCallback(stepContext, now); }
+  }
+
+  void writeDir(bool level)
+  {
+    dir = level;
+  }
+
+  void startTimer(uint32_t ticks)
+  {
+    deadline = now + ticks;
+    armed = true;
+  }
+
+  void stopTimer()
+  {
+    armed = false;
+  }
+
+  /// Fires the timer until it is stopped, or `limit` times.
+  ///
+  /// @return The number of times onTimer() was called.
+  template <class Engine>
+  uint32_t run(Engine & engine, uint32_t limit = UINT32_MAX)
+  {
+    uint32_t count = 0;
+    while (armed && count < limit)
+    {
+      armed = false;
+      now = deadline;
+      engine.onTimer();
+      count++;
+    }
+    return count;
+  }
+
+  /// The simulated time in timer ticks.
+  uint64_t now = 0;
+
+  /// Counts every STEP edge as a step; see DRV8461StepEngine::setDualEdge().
+  bool dualEdge = false;
+
+  /// The level of the DIR pin.
+  bool dir = false;
+
+  /// The number of steps taken.
+  uint32_t steps = 0;
+
+  /// If not null, the emulated driver that each step moves.
+  DRV8461SimBus * motor = nullptr;
+
+  /// If not null, called with `stepContext` and the time of each step.
+  void (*stepCallback)(void * context, uint64_t time) = nullptr;
+  void * stepContext = nullptr;
+
+private:
+
+  bool stepLevel = false;
+  bool armed = false;
+  uint64_t deadline = 0;
+};
+
+
+/// A Hal for DRV8461MultiAxis that runs the timebase in simulated time, like
+/// DRV8461SimStepHal does for a single engine.
+///
+/// Each pulseSteps() call moves the position of every axis in its mask the
+/// way its DIR pin points, and is passed with its time to `stepCallback` if
+/// one is set.  A pulse on an axis whose DIR pin changed at the same moment,
+/// with no time to settle, is counted in `dirViolations`.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461SimMultiStepHal<> hal;
+/// DRV8461MultiAxis<DRV8434S, DRV8461SimMultiStepHal<>> axes(hal, 2000000);
+/// // ... addAxis() and moveLinear() ...
+/// hal.run(axes);
+/// // hal.position[i] is where each axis ended up
+/// ~~~
+template <uint8_t MaxAxes = 32>
+class DRV8461SimMultiStepHal
+{
+public:
+  DRV8461SimMultiStepHal()
+  {
+    for (uint8_t i = 0; i < MaxAxes; i++)
+    {
+      dir[i] = false;
+      position[i] = 0;
+      dirTime[i] = UINT64_MAX;
+    }
+  }
+
+  void pulseSteps(uint32_t axes)
+  {
+    pulses++;
+    for (uint8_t i = 0; i < MaxAxes; i++)
+    {
+      if (!(axes & ((uint32_t)1 << i))) { continue; }
+      if (dirTime[i] == time) { dirViolations++; }
+      position[i] += dir[i] ? 1 : -1;
+      steps++;
+    }
+    if (stepCallback) { stepCallback(stepContext, axes, time); }
+  }
+
+  void writeDir(uint8_t axis, bool level)
+  {
+    if (dir[axis] != level) { dirTime[axis] = time; }
+    dir[axis] = level;
+  }
+
+  void startTimer(uint32_t ticks)
+  {
+    deadline = time + ticks;
+    armed = true;
+  }
+
+  void stopTimer()
+  {
+    armed = false;
+  }
+
+  uint32_t now()
+  {
+    return (uint32_t)time;
+  }
+
+  /// Fires the timer until it is stopped, or `limit` times.
+  ///
+  /// @return The number of times onTimer() was called.
+  template <class Axes>
+  uint32_t run(Axes & axes, uint32_t limit = UINT32_MAX)
+  {
+    uint32_t count = 0;
+    while (armed && count < limit)
+    {
+      armed = false;
+      time = deadline;
+      axes.onTimer();
+      count++;
+    }
+    return count;
+  }
+
+  /// The simulated time in timer ticks.
+  uint64_t time = 0;
+
+  /// The level of each DIR pin, and the position each axis has stepped to.
+  bool dir[MaxAxes];
+  int32_t position[MaxAxes];
+
+  /// The number of pulseSteps() calls, and of steps over all axes.
+  uint32_t pulses = 0;
+  uint32_t steps = 0;
+
+  /// The number of steps taken with no setup time after a DIR change.
+  uint32_t dirViolations = 0;
+
+  /// If not null, called with `stepContext`, the axes pulsed and the time of
+  /// each pulseSteps() call.
+  void (*stepCallback)(void * context, uint32_t axes, uint64_t time) = nullptr;
+  void * stepContext = nullptr;
+
+private:
+
+  uint64_t dirTime[MaxAxes];
+  bool armed = false;
+  uint64_t deadline = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_SIMBUS_H
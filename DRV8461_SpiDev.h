@@ -0,0 +1,239 @@
+#ifndef DRV8461_SPIDEV_H
+#define DRV8461_SPIDEV_H
+
+/*  DRV8461_SpiDev.h
+
+    Linux spidev bus for BasicDRV8434SSPI.
+
+*/
+#pragma once
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/spi/spidev.h>
+
+#include "DRV8461_SimBus.h"
+
+
+/// Sends SPI messages through the spidev ioctl.  This is the I/O policy
+/// DRV8461SpiDevBus uses; see DRV8461SpiDevLoopback for a stand-in.
+struct DRV8461SpiDevIoctl
+{
+  /// Sends `count` transfers as one message.
+  ///
+  /// @return A negative value on failure.
+  int message(int fd, struct spi_ioc_transfer * xfers, uint8_t count)
+  {
+    return ioctl(fd, SPI_IOC_MESSAGE(count), xfers);
+  }
+};
+
+
+/// A bus for BasicDRV8434SSPI (see DRV8461ArduinoBus) that talks to the driver
+/// through a Linux /dev/spidevX.Y device.
+///
+/// Each call to transfer() is a single SPI_IOC_MESSAGE ioctl: every frame is
+/// one spi_ioc_transfer with cs_change set, so the kernel releases chip select
+/// between frames (which the DRV8461 needs to latch writes) without another
+/// system call.  A batch of register accesses therefore costs one system call
+/// instead of one per register.  Batches longer than maxTransfers frames are
+/// split into several ioctls; see pack().
+///
+/// If an ioctl fails, errorCount is incremented and the frames it carried
+/// are filled with zeros.  A status byte of 0x00 can never come from the
+/// device (its top two bits always read 1), so the failure reaches the
+/// status callback and code such as DRV8461FaultMonitor or
+/// DRV8461LinkTuner instead of the transmitted bytes being taken for data.
+///
+/// `Io` sends the messages; it must provide
+/// `int message(int fd, spi_ioc_transfer * xfers, uint8_t count)` like
+/// DRV8461SpiDevIoctl.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// BasicDRV8434S<DRV8461SpiDevBus> sd;
+/// if (!sd.driver.bus.open("/dev/spidev0.0")) { return 1; }
+/// sd.resetSettings();
+/// ~~~
+template <class Io = DRV8461SpiDevIoctl>
+class BasicDRV8461SpiDevBus
+{
+public:
+  /// The most frames sent in one ioctl.
+  static const uint8_t maxTransfers = 64;
+
+  BasicDRV8461SpiDevBus() = default;
+  BasicDRV8461SpiDevBus(const BasicDRV8461SpiDevBus &) = delete;
+  BasicDRV8461SpiDevBus & operator=(const BasicDRV8461SpiDevBus &) = delete;
+
+  ~BasicDRV8461SpiDevBus()
+  {
+    close();
+  }
+
+  /// Opens the spidev device and configures the SPI mode (mode 1, MSB first,
+  /// like the Arduino bus) and clock.
+  ///
+  /// @return false if the device could not be opened or configured; errno is
+  /// left set.
+  bool open(const char * path, uint32_t speedHz = 500000)
+  {
+    close();
+    fd = ::open(path, O_RDWR);
+    if (fd < 0) { return false; }
+
+    uint8_t mode = SPI_MODE_1;
+    uint8_t bits = 8;
+    if (ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0)
+    {
+      close();
+      return false;
+    }
+    return setClock(speedHz);
+  }
+
+  /// Closes the device.
+  void close()
+  {
+    if (fd >= 0) { ::close(fd); }
+    fd = -1;
+  }
+
+  /// Returns true if the device is open.
+  bool isOpen() const
+  {
+    return fd >= 0;
+  }
+
+  /// Sets the SPI clock frequency.
+  bool setClock(uint32_t speedHz)
+  {
+    this->speedHz = speedHz;
+    return fd >= 0 && ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz) >= 0;
+  }
+
+  /// Fills in one spi_ioc_transfer per frame for the first (at most
+  /// maxTransfers) of `frameCount` frames, receiving in place.  Chip select
+  /// is released after every frame but the last; the last one is released
+  /// when the message ends.
+  ///
+  /// @return The number of transfers filled in.
+  static uint8_t pack(struct spi_ioc_transfer * xfers, uint8_t * frames, uint8_t frameLength,
+    uint8_t frameCount, uint32_t speedHz)
+  {
+    uint8_t n = frameCount < maxTransfers ? frameCount : maxTransfers;
+    memset(xfers, 0, n * sizeof(xfers[0]));
+    for (uint8_t i = 0; i < n; i++)
+    {
+      xfers[i].tx_buf = (unsigned long)(frames + i * frameLength);
+      xfers[i].rx_buf = (unsigned long)(frames + i * frameLength);
+      xfers[i].len = frameLength;
+      xfers[i].speed_hz = speedHz;
+      xfers[i].bits_per_word = 8;
+      xfers[i].cs_change = (i + 1 < n);
+    }
+    return n;
+  }
+
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    while (frameCount)
+    {
+      uint8_t n = pack(xfers, frames, frameLength, frameCount, speedHz);
+      if (io.message(fd, xfers, n) < 0)
+      {
+        errorCount++;
+        memset(frames, 0, n * frameLength);
+      }
+
+      frames += n * frameLength;
+      frameCount -= n;
+    }
+  }
+
+  /// The number of ioctls that have failed.
+  uint32_t errorCount = 0;
+
+  /// The I/O policy that sends the messages.
+  Io io;
+
+private:
+
+  int fd = -1;
+  uint32_t speedHz = 500000;
+  struct spi_ioc_transfer xfers[maxTransfers];
+};
+
+/// The spidev bus, talking to a real device.
+typedef BasicDRV8461SpiDevBus<> DRV8461SpiDevBus;
+
+
+/// An I/O policy for BasicDRV8461SpiDevBus that sends each message to an
+/// in-process DRV8461SimBus instead of the kernel, so the spidev backend
+/// (the transfer packing and chip select handling included) can be tested
+/// and benchmarked without hardware.
+///
+/// The bytes between chip select releases (cs_change, or the end of the
+/// message) are passed to `device` as one frame, as a real DRV8461 would see
+/// them.  Setting `fail` makes the next message fail like a broken ioctl.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// BasicDRV8434S<BasicDRV8461SpiDevBus<DRV8461SpiDevLoopback>> sd;
+/// sd.applySettings();
+/// // One message: sd.driver.bus.io.messages == 1.
+/// ~~~
+class DRV8461SpiDevLoopback
+{
+public:
+  int message(int, struct spi_ioc_transfer * xfers, uint8_t count)
+  {
+    messages++;
+    if (fail)
+    {
+      fail = false;
+      return -1;
+    }
+
+    uint8_t frame[256];
+    uint16_t length = 0;
+    uint8_t first = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      const uint8_t * tx = (const uint8_t *)(uintptr_t)xfers[i].tx_buf;
+      for (uint32_t b = 0; b < xfers[i].len && length < sizeof(frame); b++) { frame[length++] = tx[b]; }
+      if (!xfers[i].cs_change && i + 1 < count) { continue; }
+
+      // Chip select goes high: the device sees the frame.
+      device.transfer(frame, (uint8_t)length, 1);
+      uint16_t offset = 0;
+      for (uint8_t j = first; j <= i; j++)
+      {
+        uint8_t * rx = (uint8_t *)(uintptr_t)xfers[j].rx_buf;
+        for (uint32_t b = 0; b < xfers[j].len && offset < length; b++) { rx[b] = frame[offset++]; }
+      }
+      first = i + 1;
+      length = 0;
+    }
+    return count;
+  }
+
+  /// The emulated device.
+  DRV8461SimBus device;
+
+  /// The number of messages sent.
+  uint32_t messages = 0;
+
+  /// If set, the next message fails.
+  bool fail = false;
+};
+
+
+#endif                                    // #if defined(__linux__)
+
+#endif                                    // #ifndef DRV8461_SPIDEV_H
@@ -0,0 +1,307 @@
+#ifndef DRV8461_STALL_H
+#define DRV8461_STALL_H
+
+/*  DRV8461_Stall.h
+
+    Stall threshold learning and sensorless homing against a hard stop for
+    the DRV8461.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// States of DRV8461StallHoming.
+enum class DRV8461_Stall_State : uint8_t {
+  DRV8461_STALL_IDLE        = 0,       // Nothing started yet.
+  DRV8461_STALL_LEARNING    = 1,       // Turning at the learning speed, waiting for STL_LRN_OK.
+  DRV8461_STALL_SEEKING     = 2,       // Moving toward the hard stop, waiting for a stall.
+  DRV8461_STALL_BACKING_OFF = 3,       // Moving away from the hard stop.
+  DRV8461_STALL_DONE        = 4,       // Learning or homing finished.
+  DRV8461_STALL_FAILED      = 5,       // Timed out, travelled the whole range without a stall, or hit another fault.
+};
+
+/// Results of the homing runs made by one DRV8461StallHoming.
+struct DRV8461HomingStats
+{
+  /// The number of successful homing runs.
+  uint16_t runs = 0;
+
+  /// How long the last homing run took, in the units passed to tick().
+  uint32_t lastDuration = 0;
+
+  /// The commanded position at which the last stall was detected, before the
+  /// position was reset.
+  int32_t lastStallPosition = 0;
+
+  /// The smallest and largest difference, in steps, between where a stall
+  /// was detected and where the previous homing run put the hard stop.  The
+  /// first run has nothing to compare to and is not counted.
+  /// maxDeviation - minDeviation is the repeatability of the home position.
+  int32_t minDeviation = 0;
+  int32_t maxDeviation = 0;
+};
+
+
+/// This class learns the stall threshold of a DRV8461 and homes an axis by
+/// driving it into a hard stop, without a limit switch.
+///
+/// `Driver` is a BasicDRV8434S and `Engine` moves the motor; it must provide
+/// the plan(), start(), stop(), isRunning(), getPosition() and setPosition()
+/// members of DRV8461StepEngine.
+///
+/// Both sequences are non-blocking state machines: start one with learn() or
+/// home(), then call tick() regularly (every few milliseconds) with the
+/// current time until it returns DRV8461_STALL_DONE or DRV8461_STALL_FAILED.
+/// Each tick reads DIAG2, one frame, and checks the FAULT bits in its status
+/// byte.  If nFAULT is wired to an interrupt, call onFaultEdge() from it so
+/// the next tick stops the motor whatever DIAG2 says.
+///
+/// Homing drives toward the stop at up to `maxTravel` steps, stops when the
+/// driver reports a stall, clears the fault, backs off `backoff` steps and
+/// makes that position 0.  Only a stall is cleared: if FAULT holds anything
+/// besides STL, when homing starts or when the motor is stopped, homing fails
+/// and leaves the fault latched for the application to deal with.  Stall
+/// detection (EN_STL and STL_REP) is left as it was found.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461StallHoming<DRV8434S, DRV8461StepEngine<MyHal>> homing(sd, engine);
+/// homing.home(millis(), false, 4000, 20000, 100000, 200);
+/// while (homing.tick(millis()) < DRV8461_Stall_State::DRV8461_STALL_DONE) { delay(2); }
+/// ~~~
+template <class Driver, class Engine>
+class DRV8461StallHoming
+{
+public:
+  DRV8461StallHoming(Driver & sd, Engine & engine) : sd(sd), engine(engine)
+  {
+  }
+
+  /// Starts learning the stall threshold: turns the motor forward at `speed`
+  /// (steps/s), waits `settleTime` for the speed to settle, then sets STL_LRN
+  /// and waits up to `timeout` for STL_LRN_OK.  On success the threshold is in
+  /// the cached settings (see DRV8434S::getStallThreshold()).
+  ///
+  /// The motor must be free to turn `maxSteps` steps without load.
+  ///
+  /// @return false if the engine is busy.
+  bool learn(uint32_t now, uint32_t speed, uint32_t acceleration, int32_t maxSteps,
+    uint32_t settleTime, uint32_t timeout)
+  {
+    if (!startMove(now, maxSteps, speed, acceleration)) { return false; }
+    this->settleTime = settleTime;
+    this->timeout = timeout;
+    learningStarted = false;
+    state = DRV8461_Stall_State::DRV8461_STALL_LEARNING;
+    return true;
+  }
+
+  /// Starts homing toward the hard stop in the given direction.  A stall
+  /// left latched from an earlier run is cleared first.
+  ///
+  /// @return false if the engine is busy, or if a fault other than a stall
+  /// is latched (the state is then DRV8461_STALL_FAILED).
+  bool home(uint32_t now, bool forward, uint32_t speed, uint32_t acceleration,
+    uint32_t maxTravel, uint32_t backoff)
+  {
+    if (engine.isRunning()) { return false; }
+
+    uint8_t fault = sd.readFault();
+    if (fault & ~stallFaults)
+    {
+      state = DRV8461_Stall_State::DRV8461_STALL_FAILED;
+      return false;
+    }
+    if (fault) { sd.clearFaults(); }
+
+    stallWasEnabled = sd.template getField<DRV8461Fields::EN_STL>();
+    stallWasReported = sd.template getField<DRV8461Fields::STL_REP>();
+    if (!stallWasEnabled) { sd.enableStallDetection(); }
+    faultEdge = false;
+
+    if (!startMove(now, forward ? (int32_t)maxTravel : -(int32_t)maxTravel, speed, acceleration))
+    {
+      restoreStallDetection();
+      return false;
+    }
+    this->forward = forward;
+    this->speed = speed;
+    this->acceleration = acceleration;
+    this->backoff = backoff;
+    state = DRV8461_Stall_State::DRV8461_STALL_SEEKING;
+    return true;
+  }
+
+  /// Records a falling edge on nFAULT, so the next tick() stops the motor and
+  /// reads FAULT to find out why.  Safe to call from an interrupt.
+  void onFaultEdge()
+  {
+    faultEdge = true;
+  }
+
+  /// Advances the current sequence.
+  ///
+  /// @return The state after this tick.
+  DRV8461_Stall_State tick(uint32_t now)
+  {
+    switch (state)
+    {
+      case DRV8461_Stall_State::DRV8461_STALL_LEARNING:
+        if (!learningStarted)
+        {
+          if (now - startTime < settleTime) { break; }
+          sd.startStallLearning();
+          learningStarted = true;
+          break;
+        }
+        if (sd.pollStallLearning())
+        {
+          engine.stop();
+          state = DRV8461_Stall_State::DRV8461_STALL_DONE;
+        }
+        else if (now - startTime > settleTime + timeout || !engine.isRunning())
+        {
+          engine.stop();
+          state = DRV8461_Stall_State::DRV8461_STALL_FAILED;
+        }
+        break;
+
+      case DRV8461_Stall_State::DRV8461_STALL_SEEKING:
+      {
+        bool stalled = sd.readDiag2() & (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL;
+        if (!stalled && !faultEdge && !(sd.driver.lastStatus & statusFaults & ~stallFaults))
+        {
+          if (!engine.isRunning())
+          {
+            restoreStallDetection();
+            state = DRV8461_Stall_State::DRV8461_STALL_FAILED;
+          }
+          break;
+        }
+
+        engine.stop();
+        stallPosition = engine.getPosition();
+        faultEdge = false;
+
+        // The status byte lacks SPI_ERR, so read all of FAULT before deciding
+        // the stall is the only thing to clear.
+        if (!stalled || (sd.readFault() & ~stallFaults))
+        {
+          restoreStallDetection();
+          state = DRV8461_Stall_State::DRV8461_STALL_FAILED;
+          break;
+        }
+        sd.clearFaults();
+
+        if (backoff == 0)
+        {
+          finishHoming(now);
+        }
+        else if (engine.plan(forward ? -(int32_t)backoff : (int32_t)backoff, speed, acceleration))
+        {
+          engine.start();
+          state = DRV8461_Stall_State::DRV8461_STALL_BACKING_OFF;
+        }
+        else
+        {
+          restoreStallDetection();
+          state = DRV8461_Stall_State::DRV8461_STALL_FAILED;
+        }
+        break;
+      }
+
+      case DRV8461_Stall_State::DRV8461_STALL_BACKING_OFF:
+        if (engine.isRunning()) { break; }
+        finishHoming(now);
+        break;
+
+      default:
+        break;
+    }
+    return state;
+  }
+
+  /// Returns the current state.
+  DRV8461_Stall_State getState() const
+  {
+    return state;
+  }
+
+  /// Returns the homing results so far.
+  const DRV8461HomingStats & getStats() const
+  {
+    return stats;
+  }
+
+private:
+
+  // The FAULT bits a stall sets.
+  static constexpr uint8_t stallFaults = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT |
+    (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_STL;
+
+  // The FAULT bits reported in the status byte of every frame.
+  static constexpr uint8_t statusFaults = 0x3F;
+
+  bool startMove(uint32_t now, int32_t steps, uint32_t speed, uint32_t acceleration)
+  {
+    if (engine.isRunning() || !engine.plan(steps, speed, acceleration)) { return false; }
+    engine.start();
+    startTime = now;
+    return true;
+  }
+
+  void restoreStallDetection()
+  {
+    // enableStallDetection() set STL_REP as well as EN_STL.
+    if (stallWasEnabled) { return; }
+    sd.disableStallDetection();
+    if (!stallWasReported) { sd.template setField<DRV8461Fields::STL_REP>(false); }
+  }
+
+  void finishHoming(uint32_t now)
+  {
+    recordRun(now);
+    engine.setPosition(0);
+    restoreStallDetection();
+    state = DRV8461_Stall_State::DRV8461_STALL_DONE;
+  }
+
+  void recordRun(uint32_t now)
+  {
+    stats.lastDuration = now - startTime;
+    stats.lastStallPosition = stallPosition;
+    if (stats.runs)
+    {
+      // The previous run put the stop `backoff` steps from 0.
+      int32_t deviation = stallPosition - (forward ? (int32_t)backoff : -(int32_t)backoff);
+      if (stats.runs == 1 || deviation < stats.minDeviation) { stats.minDeviation = deviation; }
+      if (stats.runs == 1 || deviation > stats.maxDeviation) { stats.maxDeviation = deviation; }
+    }
+    stats.runs++;
+  }
+
+  Driver & sd;
+  Engine & engine;
+
+  DRV8461_Stall_State state = DRV8461_Stall_State::DRV8461_STALL_IDLE;
+  uint32_t startTime = 0;
+  uint32_t settleTime = 0;
+  uint32_t timeout = 0;
+  bool learningStarted = false;
+
+  bool forward = false;
+  uint32_t speed = 0;
+  uint32_t acceleration = 0;
+  uint32_t backoff = 0;
+  bool stallWasEnabled = false;
+  bool stallWasReported = false;
+  int32_t stallPosition = 0;
+  volatile bool faultEdge = false;
+
+  DRV8461HomingStats stats;
+};
+
+
+#endif                                    // #ifndef DRV8461_STALL_H
@@ -0,0 +1,197 @@
+#ifndef DRV8461_STANDSTILL_H
+#define DRV8461_STANDSTILL_H
+
+/*  DRV8461_Standstill.h
+
+    Management of the DRV8461 standstill power saving mode, with an estimate
+    of the energy it saves.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// This class configures standstill power saving on a BasicDRV8434S in
+/// milliseconds and milliamps, follows when the driver enters and leaves it
+/// (DIAG2 STSL), and estimates the energy saved in the motor coils.
+///
+/// The STSL flag is not part of the status byte, so it is followed through
+/// DIAG2: tick() reads it (one frame) at most every `pollInterval` ms, and
+/// observe() takes DIAG2 values the application reads anyway, for example
+/// from DRV8434S::readStatus().
+///
+/// While the current is reduced, the coils dissipate R (Irun^2 - Ihold^2)
+/// less, where R is the phase resistance and the currents are the peak
+/// currents set by TRQ_DAC and ISTSL (with sine microstepping the sum of the
+/// squares of the two coil currents stays at the peak squared).  The time
+/// the current takes to fall is not counted, so the estimate is slightly
+/// high for short rests.
+///
+/// The driver restores the run current at the first step, so that step is
+/// taken with the current still rising.  wake() avoids that: it turns
+/// standstill power saving off (one CTRL12 write) so the run current is back
+/// before the move starts, and tick() turns it on again `wakeTime` ms later.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461StandstillManager<DRV8434S> standstill(sd, 2000, 1500);   // 2 A full scale, 1.5 ohm
+/// standstill.configure(200, 4, 400);   // after 200 ms, fall over 4 ms to 400 mA
+/// // In the main loop:
+/// standstill.tick(millis());
+/// // Shortly before a move:
+/// standstill.wake(millis());
+/// ~~~
+template <class Driver>
+class DRV8461StandstillManager
+{
+public:
+  /// `fullCurrent` is the full current limit set by VREF in milliamps, and
+  /// `phaseResistance` the resistance of one motor coil in milliohms.
+  DRV8461StandstillManager(Driver & sd, uint16_t fullCurrent, uint16_t phaseResistance)
+    : sd(sd), fullCurrent(fullCurrent), phaseResistance(phaseResistance)
+  {
+  }
+
+  /// Sets the delay after the last step (16-1008 ms, rounded up to a multiple
+  /// of 16 ms), the time the current takes to fall (1-15 ms) and the
+  /// standstill current in milliamps, and enables standstill power saving.
+  /// The registers are written in one batch.
+  void configure(uint16_t delay, uint8_t fallTime, uint16_t holdCurrent)
+  {
+    bool ownTransaction = !sd.inTransaction();
+    if (ownTransaction) { sd.beginTransaction(); }
+    sd.setStandstillTiming(DRV8461_standstillDelay(delay), DRV8461_standstillFallTime(fallTime));
+    sd.setStandstillCurrentMilliamps(holdCurrent, fullCurrent);
+    sd.enableStandstillPowerSaving();
+    if (ownTransaction) { sd.commit(); }
+    enabled = true;
+    waking = false;
+  }
+
+  /// Disables standstill power saving.
+  void disable()
+  {
+    sd.disableStandstillPowerSaving();
+    enabled = false;
+    waking = false;
+  }
+
+  /// Restores the run current now, ahead of a move, by turning standstill
+  /// power saving off until tick() turns it back on `wakeTime` ms from now.
+  void wake(uint32_t now)
+  {
+    if (!enabled) { return; }
+    if (!waking) { sd.disableStandstillPowerSaving(); }
+    waking = true;
+    wakeEnd = now + wakeTime;
+    observe(now, 0);
+  }
+
+  /// Re-enables standstill power saving after wake(), and reads DIAG2 if
+  /// `pollInterval` ms have passed since it was last seen.
+  void tick(uint32_t now)
+  {
+    if (waking && (int32_t)(now - wakeEnd) >= 0)
+    {
+      sd.enableStandstillPowerSaving();
+      waking = false;
+    }
+    if (enabled && !waking && (int32_t)(now - lastSeen) >= (int32_t)pollInterval)
+    {
+      observe(now, sd.readDiag2());
+    }
+  }
+
+  /// Takes a DIAG2 value read at `now` and updates the state and the energy
+  /// estimate.
+  void observe(uint32_t now, uint8_t diag2)
+  {
+    bool reduced = diag2 & (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STSL;
+    if (inStandstill)
+    {
+      uint32_t elapsed = now - lastSeen;
+      standstillTime += elapsed;
+      energy += (uint64_t)savedPower * elapsed;
+    }
+    if (reduced && !inStandstill)
+    {
+      entries++;
+      savedPower = powerSaved();
+    }
+    inStandstill = reduced;
+    lastSeen = now;
+  }
+
+  /// Returns true if the driver was in standstill power saving when last
+  /// seen.
+  bool isInStandstill() const
+  {
+    return inStandstill;
+  }
+
+  /// Returns the number of times the driver was seen entering standstill
+  /// power saving.
+  uint32_t getEntries() const
+  {
+    return entries;
+  }
+
+  /// Returns the time spent in standstill power saving, in milliseconds.
+  uint32_t getStandstillTime() const
+  {
+    return standstillTime;
+  }
+
+  /// Returns the estimated energy saved, in millijoules.
+  uint32_t getEnergySaved() const
+  {
+    return (uint32_t)(energy / 1000000);
+  }
+
+  /// The most time between DIAG2 reads in tick(), in milliseconds.
+  uint32_t pollInterval = 100;
+
+  /// How long wake() keeps standstill power saving off, in milliseconds.
+  /// This must be longer than the time until the first step of the move.
+  uint32_t wakeTime = 50;
+
+private:
+
+  /// Returns the power saved in the coils at the cached TRQ_DAC and ISTSL,
+  /// in microwatts.
+  uint32_t powerSaved() const
+  {
+    uint32_t run = peakCurrent((uint8_t)sd.template getField<DRV8461Fields::TRQ_DAC>());
+    uint32_t hold = peakCurrent((uint8_t)sd.template getField<DRV8461Fields::ISTSL>());
+    if (hold >= run) { return 0; }
+    // mA^2 * mohm = nW
+    return (uint32_t)(((uint64_t)run * run - (uint64_t)hold * hold) * phaseResistance / 1000);
+  }
+
+  /// Returns the current in milliamps for a TRQ_DAC or ISTSL code.
+  uint32_t peakCurrent(uint8_t code) const
+  {
+    return ((uint32_t)code + 1) * fullCurrent / 256;
+  }
+
+  Driver & sd;
+  uint16_t fullCurrent;
+  uint16_t phaseResistance;
+
+  bool enabled = false;
+  bool waking = false;
+  uint32_t wakeEnd = 0;
+
+  bool inStandstill = false;
+  uint32_t lastSeen = 0;
+  uint32_t savedPower = 0;
+  uint32_t entries = 0;
+  uint32_t standstillTime = 0;
+
+  /// Energy saved in microwatt-milliseconds (nanojoules).
+  uint64_t energy = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_STANDSTILL_H
@@ -0,0 +1,130 @@
+#ifndef DRV8461_STATUS_H
+#define DRV8461_STATUS_H
+
+/*  DRV8461_Status.h
+
+    A snapshot of the DRV8461 status and measurement registers, filled in by
+    DRV8434S::readStatus().
+
+*/
+#pragma once
+
+#include <cstdint>
+
+#include "DRV8461_Register_Address_Locations.h"
+#include "DRV8461_Field.h"
+
+
+/// Selects which registers DRV8434S::readStatus() samples.  Combine with `|`.
+enum DRV8461_STATUS_SELECT : uint8_t {
+  DRV8461_STATUS_FAULT     = 0x01,      // FAULT.
+  DRV8461_STATUS_DIAG1     = 0x02,      // DIAG1.
+  DRV8461_STATUS_DIAG2     = 0x04,      // DIAG2.
+  DRV8461_STATUS_DIAG3     = 0x08,      // DIAG3.
+  DRV8461_STATUS_TRQ_COUNT = 0x10,      // CTRL7 and CTRL8 (TRQ_COUNT).
+  DRV8461_STATUS_VM_ADC    = 0x20,      // CTRL14 (VM_ADC).
+  DRV8461_STATUS_ATQ_CNT   = 0x40,      // ATQ_CTRL1 and ATQ_CTRL2 (ATQ_CNT).
+
+  DRV8461_STATUS_FAULTS    = 0x0F,      // FAULT and DIAG1-3.
+  DRV8461_STATUS_ALL       = 0x7F,
+};
+
+
+/// The status of one DRV8461 at one moment, as read by DRV8434S::readStatus().
+///
+/// The raw register values are kept so the snapshot is small and cheap to
+/// copy or log; the member functions decode them.  Registers that were not
+/// selected when the snapshot was taken read as 0, and `sampled` records which
+/// were.
+struct DRV8461DriverStatus
+{
+  /// The time passed to readStatus(), for example from micros().
+  uint32_t time;
+
+  /// The DRV8461_STATUS_SELECT bits of the registers that were read.
+  uint8_t sampled;
+
+  uint8_t fault;
+  uint8_t diag1;
+  uint8_t diag2;
+  uint8_t diag3;
+  uint8_t ctrl7;
+  uint8_t ctrl8;
+  uint8_t ctrl14;
+  uint8_t atqCtrl1;
+  uint8_t atqCtrl2;
+
+  /// Returns true if the given FAULT condition is active.
+  bool has(DRV8461_FAULT_Reg_Val bit) const { return fault & (uint8_t)bit; }
+
+  /// Returns true if the given DIAG1 condition is active.
+  bool has(DRV8461_DIAG1_Reg_Val bit) const { return diag1 & (uint8_t)bit; }
+
+  /// Returns true if the given DIAG2 condition is active.
+  bool has(DRV8461_DIAG2_Reg_Val bit) const { return diag2 & (uint8_t)bit; }
+
+  /// Returns true if the given DIAG3 condition is active.
+  bool has(DRV8461_DIAG3_Reg_Val bit) const { return diag3 & (uint8_t)bit; }
+
+  /// Returns true if the driver reports any fault (the FAULT bit, which
+  /// follows the nFAULT pin).
+  bool faulted() const { return has(DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT); }
+
+  /// Returns true if any of the overcurrent bits in DIAG1 is set.
+  bool overcurrent() const { return diag1 != 0; }
+
+  /// Returns the 12-bit back-EMF torque count used for stall detection.
+  uint16_t torqueCount() const
+  {
+    return DRV8461Fields::TRQ_COUNT::extract(ctrl7, ctrl8);
+  }
+
+  /// Returns the 5-bit supply voltage reading (VM_ADC).
+  uint8_t supplyVoltageADC() const
+  {
+    return DRV8461Fields::VM_ADC::extract(ctrl14);
+  }
+
+  /// Returns the auto-torque current count (ATQ_CNT, 11 bits).
+  uint16_t atqCount() const
+  {
+    return DRV8461Fields::ATQ_CNT::extract(atqCtrl1, atqCtrl2);
+  }
+};
+
+
+/// The registers sampled for each DRV8461_STATUS_SELECT bit, and where each
+/// one is stored in DRV8461DriverStatus.
+struct DRV8461StatusSource
+{
+  uint8_t select;
+  DRV8461_REG_ADDR address;
+  uint8_t DRV8461DriverStatus::* member;
+};
+
+/// Holds the list of DRV8461StatusSource entries read by
+/// DRV8434S::readStatus(), in the order they are read.  Like
+/// DRV8461RegTableHolder, it is a class template so the list can be defined
+/// in this header.
+template <typename T = void>
+struct DRV8461StatusSourceHolder
+{
+  static constexpr uint8_t count = 9;
+  static constexpr DRV8461StatusSource sources[count] = {
+    { DRV8461_STATUS_FAULT,     DRV8461_REG_ADDR::DRV8461_REG_FAULT,     &DRV8461DriverStatus::fault },
+    { DRV8461_STATUS_DIAG1,     DRV8461_REG_ADDR::DRV8461_REG_DIAG1,     &DRV8461DriverStatus::diag1 },
+    { DRV8461_STATUS_DIAG2,     DRV8461_REG_ADDR::DRV8461_REG_DIAG2,     &DRV8461DriverStatus::diag2 },
+    { DRV8461_STATUS_DIAG3,     DRV8461_REG_ADDR::DRV8461_REG_DIAG3,     &DRV8461DriverStatus::diag3 },
+    { DRV8461_STATUS_TRQ_COUNT, DRV8461_REG_ADDR::DRV8461_REG_CTRL7,     &DRV8461DriverStatus::ctrl7 },
+    { DRV8461_STATUS_TRQ_COUNT, DRV8461_REG_ADDR::DRV8461_REG_CTRL8,     &DRV8461DriverStatus::ctrl8 },
+    { DRV8461_STATUS_VM_ADC,    DRV8461_REG_ADDR::DRV8461_REG_CTRL14,    &DRV8461DriverStatus::ctrl14 },
+    { DRV8461_STATUS_ATQ_CNT,   DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1, &DRV8461DriverStatus::atqCtrl1 },
+    { DRV8461_STATUS_ATQ_CNT,   DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL2, &DRV8461DriverStatus::atqCtrl2 },
+  };
+};
+
+template <typename T>
+constexpr DRV8461StatusSource DRV8461StatusSourceHolder<T>::sources[];
+
+
+#endif                                    // #ifndef DRV8461_STATUS_H
@@ -0,0 +1,404 @@
+#ifndef DRV8461_STEPENGINE_H
+#define DRV8461_STEPENGINE_H
+
+/*  DRV8461_StepEngine.h
+
+    Timer-driven STEP/DIR pulse generation with trapezoidal and S-curve
+    acceleration profiles for the DRV8461.
+
+*/
+#pragma once
+
+#include <math.h>
+
+#include "DRV8461_Registers.h"
+
+
+/// Acceleration profile shapes supported by DRV8461StepEngine.
+enum class DRV8461_Step_Profile : uint8_t {
+  DRV8461_PROFILE_TRAPEZOID = 0,       // Constant acceleration, then cruise, then constant deceleration.
+  DRV8461_PROFILE_SCURVE    = 1,       // Jerk-limited: acceleration ramps up and down smoothly.
+};
+
+/// The part of a move DRV8461StepEngine is in, as returned by getPhase().
+enum class DRV8461_Motion_Phase : uint8_t {
+  DRV8461_PHASE_IDLE   = 0,            // No move in progress.
+  DRV8461_PHASE_ACCEL  = 1,            // Speeding up.
+  DRV8461_PHASE_CRUISE = 2,            // At the planned speed.
+  DRV8461_PHASE_DECEL  = 3,            // Slowing down to stop.
+};
+
+
+/// This class generates STEP and DIR signals for a DRV8461 from a hardware
+/// timer, so the step rate is limited by the timer instead of by one SPI
+/// frame per microstep as with DRV8434S::step().
+///
+/// The pins and timer are reached through `Hal`, which must provide:
+///
+/// ~~~{.cpp}
+/// void writeStep(bool level);     // drive the STEP pin
+/// void writeDir(bool level);      // drive the DIR pin
+/// void startTimer(uint32_t ticks); // call onTimer() once, `ticks` from now
+/// void stopTimer();
+/// ~~~
+///
+/// All of the profile arithmetic (including the square roots and divisions)
+/// happens in plan().  The per-step path in onTimer() only walks a table of
+/// intervals stored as timer ticks with 8 fractional bits, so it uses no
+/// division and no floating point.  The fractional part is carried from step
+/// to step, so rounding does not accumulate.
+///
+/// The first table entries hold one step each, since that is where the
+/// interval changes fastest.  Ramps longer than `TableSize` steps are stored
+/// with later entries covering more steps: the number of steps per entry
+/// doubles every few entries, as few as the ramp allows, so each entry spans
+/// only a small fraction of the steps before it and its average interval
+/// stays close to the exact ones.
+///
+/// Intervals are limited to 2^24 - 1 timer ticks by the 8 fractional bits,
+/// so with a fast timer very slow speeds cannot be planned.
+///
+/// If the driver's STEP_EDGE bit is set (DRV8461Fields::STEP_EDGE), call
+/// setDualEdge(true) and every STEP edge counts as a step, so the pin only
+/// toggles once per step and there is no minimum pulse width to wait out.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// MyHal hal;
+/// DRV8461StepEngine<MyHal> engine(hal, 1000000);   // 1 MHz timer
+/// engine.plan(3200, 20000, 50000);                 // steps, steps/s, steps/s^2
+/// engine.start();
+/// // In the timer interrupt: engine.onTimer();
+/// ~~~
+template <class Hal, uint16_t TableSize = 256>
+class DRV8461StepEngine
+{
+public:
+  DRV8461StepEngine(Hal & hal, uint32_t timerHz) : hal(hal), timerHz(timerHz)
+  {
+  }
+
+  /// Selects whether each STEP edge (true) or each rising edge (false) makes
+  /// the driver take a step.  This must match the driver's STEP_EDGE setting.
+  void setDualEdge(bool dualEdge)
+  {
+    this->dualEdge = dualEdge;
+  }
+
+  /// Makes the engine step through SPI with DRV8434S::step() (and set the
+  /// direction with DRV8434S::setDirection()) instead of driving the pins.
+  /// This is much slower and is only meant for boards without STEP/DIR wired.
+  ///
+  /// You must call DRV8434S::enableSPIStep() and enableSPIDirection() first.
+  template <class Driver>
+  void setSPIStepping(Driver & driver)
+  {
+    spiDriver = &driver;
+    spiStep = [](void * d) { static_cast<Driver *>(d)->step(); };
+    spiSetDirection = [](void * d, bool dir) { static_cast<Driver *>(d)->setDirection(dir); };
+  }
+
+  /// Goes back to driving the STEP and DIR pins.
+  void setPinStepping()
+  {
+    spiDriver = nullptr;
+  }
+
+  /// Precomputes a move of `steps` steps (negative to move backwards) with the
+  /// given top speed (steps/s) and acceleration (steps/s^2).  For the S-curve
+  /// profile, `jerk` (steps/s^3) limits how fast the acceleration changes; 0
+  /// picks the jerk that keeps the peak acceleration at `acceleration`.
+  ///
+  /// If the move is too short to reach `maxSpeed`, it accelerates for half the
+  /// move and decelerates for the other half.
+  ///
+  /// @return false if the engine is running, a parameter is 0, or a step
+  /// interval would not fit in 24 bits of timer ticks (the speed at the start
+  /// of the ramp, or `maxSpeed`, is too low for the timer frequency).  The
+  /// previous plan is discarded in the last case.
+  bool plan(int32_t steps, uint32_t maxSpeed, uint32_t acceleration,
+    DRV8461_Step_Profile profile = DRV8461_Step_Profile::DRV8461_PROFILE_TRAPEZOID,
+    uint32_t jerk = 0)
+  {
+    if (running || maxSpeed == 0 || acceleration == 0 || timerHz == 0) { return false; }
+
+    direction = steps >= 0;
+    uint32_t count = direction ? steps : -steps;
+
+    // Time to reach top speed, and the distance covered meanwhile.
+    float v = maxSpeed;
+    float rampTime;
+    if (profile == DRV8461_Step_Profile::DRV8461_PROFILE_SCURVE)
+    {
+      // Smoothstep velocity v(t) = V (3u^2 - 2u^3), u = t/T: peak acceleration
+      // 1.5 V/T, peak jerk 6 V/T^2.
+      rampTime = 1.5f * v / acceleration;
+      if (jerk)
+      {
+        float jerkTime = sqrtf(6.0f * v / jerk);
+        if (jerkTime > rampTime) { rampTime = jerkTime; }
+      }
+    }
+    else
+    {
+      rampTime = v / acceleration;
+    }
+    float rampDistance = v * rampTime / 2;
+    uint32_t rampSteps = rampDistance < 4294967040.0f ? (uint32_t)rampDistance : UINT32_MAX;
+    if (rampSteps == 0) { rampSteps = 1; }
+
+    uint32_t gaps = count ? count - 1 : 0;
+    accelSteps = rampSteps < gaps / 2 ? rampSteps : gaps / 2;
+    cruiseSteps = gaps - 2 * accelSteps;
+    remaining = 0;
+
+    // Use the finest table spacing that still covers the ramp.
+    groupShift = 16;
+    while (groupShift > 0 && coverage(groupShift) < rampSteps) { groupShift--; }
+    if (coverage(groupShift) < rampSteps) { return false; }
+
+    // Fill in the table, checking that every interval fits in Q24.8.
+    const float tickScale = 256.0f * timerHz;
+    const float maxInterval = 4294967040.0f;   // The largest float below 2^32.
+    uint32_t first = 0;
+    tableLength = 0;
+    while (first < rampSteps)
+    {
+      uint32_t last = first + span(tableLength);
+      if (last > rampSteps || last < first) { last = rampSteps; }
+      float interval = tickScale * rampDuration(profile, first, last, v, rampTime, acceleration) / (last - first);
+      if (!(interval <= maxInterval)) { return false; }
+      table[tableLength++] = (uint32_t)interval;
+      first = last;
+    }
+
+    float interval = tickScale / v;
+    if (!(interval <= maxInterval)) { return false; }
+    cruiseInterval = (uint32_t)interval;
+    if (accelSteps < rampSteps)
+    {
+      // Short move: the odd gap in the middle (if any) runs at the peak speed
+      // actually reached, not at maxSpeed.
+      uint16_t k = 0;
+      for (first = 0; first + span(k) <= accelSteps; k++) { first += span(k); }
+      cruiseInterval = table[k];
+    }
+
+    remaining = count;
+    return true;
+  }
+
+  /// Starts the planned move.  The first step is taken immediately, or
+  /// `delay` timer ticks after DIR is set if the driver needs DIR to settle
+  /// before a STEP edge.
+  void start(uint32_t delay = 0)
+  {
+    if (running || remaining == 0) { return; }
+
+    if (spiDriver)
+    {
+      spiSetDirection(spiDriver, direction);
+    }
+    else
+    {
+      hal.writeDir(direction);
+    }
+
+    tableIndex = 0;
+    tableUsed = 0;
+    accelLeft = accelSteps;
+    cruiseLeft = cruiseSteps;
+    fraction = 0;
+    phase = accelSteps ? DRV8461_Motion_Phase::DRV8461_PHASE_ACCEL : DRV8461_Motion_Phase::DRV8461_PHASE_CRUISE;
+    running = true;
+    if (delay) { hal.startTimer(delay); }
+    else { onTimer(); }
+  }
+
+  /// Stops immediately, without decelerating.
+  void stop()
+  {
+    hal.stopTimer();
+    running = false;
+    remaining = 0;
+    phase = DRV8461_Motion_Phase::DRV8461_PHASE_IDLE;
+  }
+
+  /// Takes one step and arms the timer for the next one.  Call this from the
+  /// timer interrupt.
+  void onTimer()
+  {
+    if (!running) { return; }
+
+    emitStep();
+    position = position + (direction ? 1 : -1);
+    uint32_t left = remaining - 1;
+    remaining = left;
+    if (left == 0)
+    {
+      hal.stopTimer();
+      running = false;
+      phase = DRV8461_Motion_Phase::DRV8461_PHASE_IDLE;
+      return;
+    }
+
+    uint32_t interval;
+    if (accelLeft)
+    {
+      accelLeft--;
+      interval = table[tableIndex];
+      if (++tableUsed == span(tableIndex)) { tableUsed = 0; tableIndex++; }
+    }
+    else if (cruiseLeft)
+    {
+      cruiseLeft--;
+      interval = cruiseInterval;
+      phase = DRV8461_Motion_Phase::DRV8461_PHASE_CRUISE;
+    }
+    else
+    {
+      // Walk the ramp backwards, mirroring the acceleration exactly.
+      if (tableUsed) { tableUsed--; }
+      else if (tableIndex) { tableIndex--; tableUsed = span(tableIndex) - 1; }
+      interval = table[tableIndex];
+      phase = DRV8461_Motion_Phase::DRV8461_PHASE_DECEL;
+    }
+
+    fraction += interval;
+    uint32_t ticks = fraction >> 8;
+    fraction &= 0xFF;
+    hal.startTimer(ticks);
+  }
+
+  /// Returns true while a move is in progress.
+  bool isRunning() const
+  {
+    return running;
+  }
+
+  /// Returns the part of the move the engine is in.  This is updated from
+  /// the timer interrupt and is a single byte, so it is safe to poll.
+  DRV8461_Motion_Phase getPhase() const
+  {
+    return phase;
+  }
+
+  /// Returns the number of steps taken since the engine was created, counting
+  /// backward steps as negative.
+  int32_t getPosition() const
+  {
+    return position;
+  }
+
+  /// Sets the position counter.
+  void setPosition(int32_t position)
+  {
+    this->position = position;
+  }
+
+private:
+
+  /// Returns the number of steps covered by table entry `k`: 1 for the first
+  /// 2^groupShift entries, 2 for the next ones, and so on.
+  uint32_t span(uint16_t k) const
+  {
+    return (uint32_t)1 << (k >> groupShift);
+  }
+
+  /// Returns the number of ramp steps a full table covers with the given
+  /// spacing (see span()), saturating at UINT32_MAX.
+  static uint32_t coverage(uint8_t shift)
+  {
+    uint64_t total = 0;
+    for (uint32_t k = 0; k < TableSize; k++)
+    {
+      if ((k >> shift) >= 32) { return UINT32_MAX; }
+      total += (uint64_t)1 << (k >> shift);
+      if (total >= UINT32_MAX) { return UINT32_MAX; }
+    }
+    return (uint32_t)total;
+  }
+
+  /// Returns the time (s) from step `first` to step `last` of the ramp.  Only
+  /// used while planning.
+  static float rampDuration(DRV8461_Step_Profile profile, uint32_t first, uint32_t last,
+    float v, float rampTime, float acceleration)
+  {
+    if (profile == DRV8461_Step_Profile::DRV8461_PROFILE_TRAPEZOID)
+    {
+      // sqrt(2 last / a) - sqrt(2 first / a), without the cancellation.
+      return sqrtf(2.0f / acceleration) * (last - first) / (sqrtf((float)last) + sqrtf((float)first));
+    }
+    return timeAtStep(profile, last, v, rampTime, acceleration) -
+      timeAtStep(profile, first, v, rampTime, acceleration);
+  }
+
+  /// Returns the time (s) at which step `i` of the ramp is taken, with step 0
+  /// at t = 0.  Only used while planning.
+  static float timeAtStep(DRV8461_Step_Profile profile, uint32_t i, float v, float rampTime, float acceleration)
+  {
+    if (profile == DRV8461_Step_Profile::DRV8461_PROFILE_TRAPEZOID)
+    {
+      return sqrtf(2.0f * i / acceleration);
+    }
+
+    // s(t) = V T (u^3 - u^4 / 2); solve s(t) = i for u by bisection.
+    float lo = 0, hi = 1;
+    for (uint8_t n = 0; n < 24; n++)
+    {
+      float u = (lo + hi) / 2;
+      float s = v * rampTime * (u * u * u - u * u * u * u / 2);
+      if (s < i) { lo = u; } else { hi = u; }
+    }
+    return rampTime * (lo + hi) / 2;
+  }
+
+  void emitStep()
+  {
+    if (spiDriver)
+    {
+      spiStep(spiDriver);
+    }
+    else if (dualEdge)
+    {
+      stepLevel = !stepLevel;
+      hal.writeStep(stepLevel);
+    }
+    else
+    {
+      hal.writeStep(true);
+      hal.writeStep(false);
+    }
+  }
+
+  Hal & hal;
+  uint32_t timerHz;
+  void * spiDriver = nullptr;
+  void (*spiStep)(void *) = nullptr;
+  void (*spiSetDirection)(void *, bool) = nullptr;
+  bool dualEdge = false;
+  bool stepLevel = false;
+
+  // Planned move.
+  bool direction = true;
+  uint32_t accelSteps = 0;
+  uint32_t cruiseSteps = 0;
+  uint32_t cruiseInterval = 0;
+  uint8_t groupShift = 16;
+  uint16_t tableLength = 0;
+  uint32_t table[TableSize];
+
+  // Progress through the move, updated from the timer interrupt.
+  volatile bool running = false;
+  volatile uint32_t remaining = 0;
+  volatile int32_t position = 0;
+  volatile DRV8461_Motion_Phase phase = DRV8461_Motion_Phase::DRV8461_PHASE_IDLE;
+  uint32_t accelLeft = 0;
+  uint32_t cruiseLeft = 0;
+  uint16_t tableIndex = 0;
+  uint32_t tableUsed = 0;
+  uint32_t fraction = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_STEPENGINE_H
@@ -0,0 +1,426 @@
+#ifndef DRV8461_TELEMETRY_H
+#define DRV8461_TELEMETRY_H
+
+/*  DRV8461_Telemetry.h
+
+    Fixed-rate register sampling into a lock-free ring, and a compact
+    delta/run-length encoded stream format for storing the samples.
+
+*/
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+#include "DRV8461_Registers.h"
+
+
+/// The most registers a telemetry recorder can sample.
+static const uint8_t DRV8461_TELEMETRY_MAX_CHANNELS = 16;
+
+/// One set of register values taken at one time.  Channel i holds the
+/// register given to the i-th DRV8461TelemetryRecorder::addChannel() call.
+struct DRV8461TelemetrySample
+{
+  uint32_t time;
+  uint8_t values[DRV8461_TELEMETRY_MAX_CHANNELS];
+};
+
+
+/// This class samples a chosen set of registers from a BasicDRV8434SSPI and
+/// queues the samples for another context to store.
+///
+/// sample() is meant to be called at a fixed rate from a timer interrupt or a
+/// real-time thread.  It reads every channel in one batch (see
+/// BasicDRV8434SSPI::transferBatch()) and copies the result into a ring of
+/// `Capacity` samples.  pop() takes samples out from the main loop or a
+/// lower-priority thread, typically to pass them to
+/// DRV8461TelemetryEncoder::add().
+///
+/// The ring has a single producer and a single consumer, and the indices are
+/// lock-free atomics, so neither side blocks the other.  If the consumer falls
+/// behind, new samples are dropped and counted rather than overwriting ones
+/// that are being read.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461TelemetryRecorder<DRV8434SSPI, 256> recorder(sd.driver);
+/// recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_DIAG2);
+/// recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_CTRL14);
+/// // In the timer interrupt:
+/// recorder.sample(micros());
+/// // In the main loop:
+/// DRV8461TelemetrySample s;
+/// while (recorder.pop(s)) { encoder.add(s); }
+/// ~~~
+template <class Driver, uint16_t Capacity = 256>
+class DRV8461TelemetryRecorder
+{
+  static_assert(Capacity >= 2 && Capacity <= 0x8000 && (Capacity & (Capacity - 1)) == 0,
+    "capacity must be a power of two no larger than 32768");
+
+public:
+  explicit DRV8461TelemetryRecorder(Driver & driver) : driver(driver)
+  {
+  }
+
+  /// Adds a register to the set sampled.  Channels should be set up before
+  /// sampling starts.
+  ///
+  /// @return false if there are already DRV8461_TELEMETRY_MAX_CHANNELS
+  /// channels.
+  bool addChannel(DRV8461_REG_ADDR address)
+  {
+    if (count >= DRV8461_TELEMETRY_MAX_CHANNELS) { return false; }
+    ops[count++] = DRV8461RegOp::read(address);
+    return true;
+  }
+
+  /// Returns the number of channels.
+  uint8_t channelCount() const
+  {
+    return count;
+  }
+
+  /// Returns the register sampled by the given channel.
+  DRV8461_REG_ADDR channelAddress(uint8_t channel) const
+  {
+    return (DRV8461_REG_ADDR)ops[channel].address;
+  }
+
+  /// Reads all channels and queues the values with the given time.
+  ///
+  /// @return false if the ring was full and the sample was dropped.  The bus
+  /// is not used in that case.
+  bool sample(uint32_t time)
+  {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    if ((uint16_t)(h - tail.load(std::memory_order_acquire)) >= Capacity)
+    {
+      dropped++;
+      return false;
+    }
+
+    DRV8461RegResult results[DRV8461_TELEMETRY_MAX_CHANNELS];
+    driver.transferBatch(ops, count, results);
+
+    DRV8461TelemetrySample & s = samples[h & (Capacity - 1)];
+    s.time = time;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      s.values[i] = results[i].data;
+    }
+    head.store((uint16_t)(h + 1), std::memory_order_release);
+    return true;
+  }
+
+  /// Takes the oldest sample out of the ring.
+  ///
+  /// @return false if the ring is empty.
+  bool pop(DRV8461TelemetrySample & sample)
+  {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) { return false; }
+
+    sample = samples[t & (Capacity - 1)];
+    tail.store((uint16_t)(t + 1), std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of samples waiting.
+  uint16_t pending() const
+  {
+    return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+
+  /// The number of samples dropped because the ring was full.
+  uint32_t dropped = 0;
+
+private:
+
+  Driver & driver;
+  DRV8461RegOp ops[DRV8461_TELEMETRY_MAX_CHANNELS];
+  uint8_t count = 0;
+
+  DRV8461TelemetrySample samples[Capacity];
+
+  // Free-running indices; the difference is the number of queued samples.
+  std::atomic<uint16_t> head{0};
+  std::atomic<uint16_t> tail{0};
+};
+
+
+// STREAM FORMAT *****************************************************************************************************//
+//
+// A telemetry stream is a header followed by records.
+//
+// Header:
+//   4 bytes  "D8TL"
+//   1 byte   format version (DRV8461_TELEMETRY_VERSION)
+//   1 byte   channel count N
+//   N x 3    per channel: register address, DRV8461_REG_GROUP, volatile mask
+//            (from DRV8461_Register_Table.h, so a reader can tell settings
+//            from live status without the library)
+//
+// Records, each starting with an unsigned LEB128 varint h:
+//   h odd    a run of (h >> 1) samples identical to the previous one: same
+//            time step, no channel changed
+//   h even   one sample, (h >> 1) time units after the previous one,
+//            followed by a change mask of ceil(N / 8) bytes (bit i, LSB
+//            first, set if channel i changed) and, for each changed channel,
+//            one byte holding the difference from its previous value
+//            (modulo 256)
+//
+// Before the first record, the time and all values are 0.
+
+/// The format version written by DRV8461TelemetryEncoder.
+static const uint8_t DRV8461_TELEMETRY_VERSION = 1;
+
+
+/// This class writes samples in the telemetry stream format to `Sink`, which
+/// must provide `void write(const uint8_t * data, size_t length)`.  See
+/// DRV8461_TelemetryFile.h for a file sink.
+///
+/// Only the channels that changed are stored, and a sample in which nothing
+/// changed since the last one (at the same sample interval) adds nothing
+/// until the run ends.  Status registers change rarely, so a long recording
+/// costs a few bytes per fault or speed change rather than per sample.
+template <class Sink>
+class DRV8461TelemetryEncoder
+{
+public:
+  explicit DRV8461TelemetryEncoder(Sink & sink) : sink(sink)
+  {
+  }
+
+  /// Writes the stream header for the channels of a recorder.
+  template <class Recorder>
+  void begin(const Recorder & recorder)
+  {
+    channels = recorder.channelCount();
+    uint8_t header[6 + 3 * DRV8461_TELEMETRY_MAX_CHANNELS] = { 'D', '8', 'T', 'L', DRV8461_TELEMETRY_VERSION, channels };
+    uint8_t length = 6;
+    for (uint8_t i = 0; i < channels; i++)
+    {
+      const DRV8461RegInfo & info = DRV8461_regInfo(recorder.channelAddress(i));
+      header[length++] = (uint8_t)recorder.channelAddress(i);
+      header[length++] = (uint8_t)info.group;
+      header[length++] = info.volatileMask;
+    }
+    sink.write(header, length);
+
+    previous = DRV8461TelemetrySample();
+    lastStep = 0;
+    run = 0;
+  }
+
+  /// Adds a sample to the stream.
+  void add(const DRV8461TelemetrySample & sample)
+  {
+    uint32_t step = sample.time - previous.time;
+
+    uint8_t mask[DRV8461_TELEMETRY_MAX_CHANNELS / 8] = {};
+    uint8_t deltas[DRV8461_TELEMETRY_MAX_CHANNELS];
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < channels; i++)
+    {
+      uint8_t delta = sample.values[i] - previous.values[i];
+      if (delta)
+      {
+        mask[i >> 3] |= 1 << (i & 7);
+        deltas[changed++] = delta;
+      }
+    }
+    previous = sample;
+
+    if (!changed && step == lastStep && run < maxRun)
+    {
+      run++;
+      return;
+    }
+    flushRun();
+
+    uint8_t record[5 + sizeof(mask) + sizeof(deltas)];
+    uint8_t length = putVarint(record, step << 1);
+    for (uint8_t i = 0; i < (channels + 7) / 8; i++)
+    {
+      record[length++] = mask[i];
+    }
+    for (uint8_t i = 0; i < changed; i++)
+    {
+      record[length++] = deltas[i];
+    }
+    sink.write(record, length);
+    lastStep = step;
+  }
+
+  /// Writes out any run still being counted.  Call this before closing the
+  /// sink.
+  void finish()
+  {
+    flushRun();
+  }
+
+private:
+
+  void flushRun()
+  {
+    if (!run) { return; }
+    uint8_t record[5];
+    sink.write(record, putVarint(record, (run << 1) | 1));
+    run = 0;
+  }
+
+  // Runs are limited to 31 bits so that the shifted value fits a 32-bit
+  // varint.  Time steps must be below 2^31 for the same reason.
+  static const uint32_t maxRun = 0x7FFFFFFF;
+
+  static uint8_t putVarint(uint8_t * out, uint32_t value)
+  {
+    uint8_t length = 0;
+    while (value >= 0x80)
+    {
+      out[length++] = (uint8_t)value | 0x80;
+      value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+  }
+
+  Sink & sink;
+  uint8_t channels = 0;
+  DRV8461TelemetrySample previous = {};
+  uint32_t lastStep = 0;
+  uint32_t run = 0;
+};
+
+
+/// This class reads samples back from a telemetry stream held in memory, for
+/// example a file mapped by DRV8461TelemetryFileReader.  It decodes in place,
+/// one sample per call to next(), so a recording of any length can be walked
+/// without copying or allocating.
+class DRV8461TelemetryDecoder
+{
+public:
+  /// Parses the header of the stream at `data`.
+  ///
+  /// @return false if the data does not start with a valid header.
+  bool attach(const uint8_t * data, size_t size)
+  {
+    begin = end = position = nullptr;
+    if (size < 6 || data[0] != 'D' || data[1] != '8' || data[2] != 'T' || data[3] != 'L' ||
+      data[4] != DRV8461_TELEMETRY_VERSION || data[5] > DRV8461_TELEMETRY_MAX_CHANNELS ||
+      size < 6 + 3 * (size_t)data[5])
+    {
+      return false;
+    }
+
+    channels = data[5];
+    header = data + 6;
+    begin = header + 3 * channels;
+    end = data + size;
+    rewind();
+    return true;
+  }
+
+  /// Goes back to the first sample.
+  void rewind()
+  {
+    position = begin;
+    current = DRV8461TelemetrySample();
+    lastStep = 0;
+    run = 0;
+  }
+
+  /// Returns the number of channels in the stream.
+  uint8_t channelCount() const
+  {
+    return channels;
+  }
+
+  /// Returns the register recorded by the given channel.
+  DRV8461_REG_ADDR channelAddress(uint8_t channel) const
+  {
+    return (DRV8461_REG_ADDR)header[3 * channel];
+  }
+
+  /// Returns the register group of the given channel, as recorded.
+  DRV8461_REG_GROUP channelGroup(uint8_t channel) const
+  {
+    return (DRV8461_REG_GROUP)header[3 * channel + 1];
+  }
+
+  /// Returns the volatile mask of the given channel, as recorded.
+  uint8_t channelVolatileMask(uint8_t channel) const
+  {
+    return header[3 * channel + 2];
+  }
+
+  /// Decodes the next sample and points `sample` at it.  The sample is owned
+  /// by the decoder and is overwritten by the next call.
+  ///
+  /// @return false at the end of the stream or if it is truncated.
+  bool next(const DRV8461TelemetrySample * & sample)
+  {
+    if (run)
+    {
+      run--;
+      current.time += lastStep;
+      sample = &current;
+      return true;
+    }
+
+    uint32_t h;
+    if (!getVarint(h)) { return false; }
+    if (h & 1)
+    {
+      run = h >> 1;
+      return next(sample);
+    }
+
+    uint8_t maskBytes = (channels + 7) / 8;
+    if ((size_t)(end - position) < maskBytes) { return false; }
+    const uint8_t * mask = position;
+    position += maskBytes;
+    for (uint8_t i = 0; i < channels; i++)
+    {
+      if (mask[i >> 3] & (1 << (i & 7)))
+      {
+        if (position == end) { return false; }
+        current.values[i] += *position++;
+      }
+    }
+
+    lastStep = h >> 1;
+    current.time += lastStep;
+    sample = &current;
+    return true;
+  }
+
+private:
+
+  bool getVarint(uint32_t & value)
+  {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7)
+    {
+      if (position == end) { return false; }
+      uint8_t b = *position++;
+      value |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) { return true; }
+    }
+    return false;
+  }
+
+  const uint8_t * header = nullptr;
+  const uint8_t * begin = nullptr;
+  const uint8_t * end = nullptr;
+  const uint8_t * position = nullptr;
+  uint8_t channels = 0;
+  DRV8461TelemetrySample current = {};
+  uint32_t lastStep = 0;
+  uint32_t run = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_TELEMETRY_H
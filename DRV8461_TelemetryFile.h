@@ -0,0 +1,159 @@
+#ifndef DRV8461_TELEMETRYFILE_H
+#define DRV8461_TELEMETRYFILE_H
+
+/*  DRV8461_TelemetryFile.h
+
+    Writing telemetry streams to files and reading them back through mmap, on
+    Linux.
+
+*/
+#pragma once
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DRV8461_Telemetry.h"
+
+
+/// A sink for DRV8461TelemetryEncoder that appends to a file through stdio,
+/// so records are buffered and written in large blocks.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461TelemetryFileSink file;
+/// if (!file.open("axis0.d8tl")) { return 1; }
+/// DRV8461TelemetryEncoder<DRV8461TelemetryFileSink> encoder(file);
+/// encoder.begin(recorder);
+/// // ... encoder.add() each sample popped from the recorder ...
+/// encoder.finish();
+/// file.close();
+/// ~~~
+class DRV8461TelemetryFileSink
+{
+public:
+  DRV8461TelemetryFileSink() = default;
+  DRV8461TelemetryFileSink(const DRV8461TelemetryFileSink &) = delete;
+  DRV8461TelemetryFileSink & operator=(const DRV8461TelemetryFileSink &) = delete;
+
+  ~DRV8461TelemetryFileSink()
+  {
+    close();
+  }
+
+  /// Creates (or truncates) the file.
+  ///
+  /// @return false if it could not be opened; errno is left set.
+  bool open(const char * path)
+  {
+    close();
+    file = fopen(path, "wb");
+    if (!file) { return false; }
+    setvbuf(file, nullptr, _IOFBF, 1 << 16);
+    return true;
+  }
+
+  /// Flushes and closes the file.
+  ///
+  /// @return false if any write failed.
+  bool close()
+  {
+    if (!file) { return true; }
+    bool ok = !failed && fclose(file) == 0;
+    file = nullptr;
+    failed = false;
+    return ok;
+  }
+
+  void write(const uint8_t * data, size_t length)
+  {
+    if (file && fwrite(data, 1, length, file) != length) { failed = true; }
+  }
+
+private:
+
+  FILE * file = nullptr;
+  bool failed = false;
+};
+
+
+/// This class maps a telemetry file into memory and decodes it with
+/// DRV8461TelemetryDecoder, so the samples are read straight from the page
+/// cache.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461TelemetryFileReader reader;
+/// if (!reader.open("axis0.d8tl")) { return 1; }
+/// const DRV8461TelemetrySample * s;
+/// while (reader.decoder.next(s)) { /* s->time, s->values[...] */ }
+/// ~~~
+class DRV8461TelemetryFileReader
+{
+public:
+  DRV8461TelemetryFileReader() = default;
+  DRV8461TelemetryFileReader(const DRV8461TelemetryFileReader &) = delete;
+  DRV8461TelemetryFileReader & operator=(const DRV8461TelemetryFileReader &) = delete;
+
+  ~DRV8461TelemetryFileReader()
+  {
+    close();
+  }
+
+  /// Maps the file and parses its header.
+  ///
+  /// @return false if the file could not be mapped or is not a telemetry
+  /// stream.
+  bool open(const char * path)
+  {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) { return false; }
+
+    data = p;
+    size = st.st_size;
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    if (!decoder.attach(static_cast<const uint8_t *>(data), size))
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  /// Unmaps the file.
+  void close()
+  {
+    if (data) { munmap(data, size); }
+    data = nullptr;
+    size = 0;
+  }
+
+  /// The decoder walking the mapped file.
+  DRV8461TelemetryDecoder decoder;
+
+private:
+
+  void * data = nullptr;
+  size_t size = 0;
+};
+
+#endif                                    // #if defined(__linux__)
+
+#endif                                    // #ifndef DRV8461_TELEMETRYFILE_H
@@ -0,0 +1,193 @@
+#ifndef DRV8461_VERIFIER_H
+#define DRV8461_VERIFIER_H
+
+/*  DRV8461_Verifier.h
+
+    Continuous verification of the DRV8461 settings a few registers at a
+    time, helped by the old data returned by ordinary writes.
+
+*/
+#pragma once
+
+#include "DRV8461_Registers.h"
+
+
+/// The settings registers found not to match the cache, reported by
+/// DRV8461SettingsVerifier.
+struct DRV8461MismatchEvent
+{
+  /// The time the first of them was found, from the verifier's clock
+  /// function.
+  uint32_t time;
+
+  /// One bit per register address.
+  uint64_t registers;
+
+  /// Returns true if the given register is one of them.
+  bool has(DRV8461_REG_ADDR address) const
+  {
+    return registers & ((uint64_t)1 << (uint8_t)address);
+  }
+};
+
+
+/// This class checks that the DRV8461 still holds the settings cached by a
+/// BasicDRV8434S, a few registers at a time, so a lost configuration is found
+/// soon without the long batch of verifySettings().
+///
+/// Each tick() reads the next `budget` settings registers round-robin in one
+/// batch.  attach() also makes the driver report the old data of every write
+/// it makes (and the results of verifySettings() and applySettings()), which
+/// confirms those registers for free; the next round skips registers
+/// confirmed that way.  Every register is thus read or confirmed at least
+/// once per round of worstCaseTicks() / 2 ticks, and a register that is lost
+/// is reported within worstCaseTicks() ticks.
+///
+/// Mismatches are gathered into one DRV8461MismatchEvent until the
+/// application takes it with poll().  Nothing is checked while a transaction
+/// is open, since the cache is then ahead of the device on purpose.
+///
+/// Example usage:
+/// ~~~{.cpp}
+/// DRV8461SettingsVerifier<DRV8434S> verifier(sd, millis, 2);
+/// verifier.attach();
+/// // In the control loop:
+/// verifier.tick();
+/// DRV8461MismatchEvent event;
+/// if (verifier.poll(event)) { sd.applySettings(); }
+/// ~~~
+template <class Driver>
+class DRV8461SettingsVerifier
+{
+public:
+  /// `clock` supplies the event timestamps (for example `millis` on
+  /// Arduino).  `budget` is the number of registers read per tick(), from 1
+  /// to 16.
+  DRV8461SettingsVerifier(Driver & sd, uint32_t (*clock)(), uint8_t budget = 2)
+    : sd(sd), clock(clock), budget(budget < 1 ? 1 : budget > maxBudget ? maxBudget : budget)
+  {
+  }
+
+  /// Makes the driver report the register contents it sees to this verifier.
+  void attach()
+  {
+    sd.setReadbackCallback(&DRV8461SettingsVerifier::readbackCallback, this);
+  }
+
+  /// Stops the driver from reporting to this verifier.
+  void detach()
+  {
+    sd.setReadbackCallback(nullptr);
+  }
+
+  /// Reads the next registers due for checking and compares them with the
+  /// cache.
+  ///
+  /// @return false if a mismatch was found.
+  bool tick()
+  {
+    if (sd.inTransaction()) { return true; }
+
+    DRV8461RegOp ops[maxBudget];
+    DRV8461RegResult results[maxBudget];
+    uint8_t count = 0;
+    for (uint8_t visited = 0; visited < Driver::settingsRegCount && count < budget; visited++)
+    {
+      DRV8461_REG_ADDR address = Driver::settingsReg(cursor);
+      if (++cursor == Driver::settingsRegCount) { cursor = 0; }
+
+      uint64_t bit = (uint64_t)1 << (uint8_t)address;
+      if (confirmed & bit)
+      {
+        confirmed &= ~bit;
+        continue;
+      }
+      ops[count++] = DRV8461RegOp::read(address);
+    }
+    if (!count) { return true; }
+
+    sd.driver.transferBatch(ops, count, results);
+    reads += count;
+
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      DRV8461_REG_ADDR address = (DRV8461_REG_ADDR)ops[i].address;
+      uint8_t mask = DRV8461_regInfo(address).settingsMask();
+      if ((results[i].data ^ sd.getCachedReg(address)) & mask)
+      {
+        mismatch(ops[i].address);
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+  /// Takes the pending mismatch event, if there is one.
+  ///
+  /// @return false if no mismatch has been found since the last call.
+  bool poll(DRV8461MismatchEvent & event)
+  {
+    if (!pending.registers) { return false; }
+    event = pending;
+    pending.registers = 0;
+    return true;
+  }
+
+  /// Returns the most ticks between a register being lost and it being
+  /// reported.
+  uint16_t worstCaseTicks() const
+  {
+    return 2 * ((Driver::settingsRegCount + budget - 1) / budget);
+  }
+
+  /// Returns the number of registers read by tick() so far.
+  uint32_t getReads() const
+  {
+    return reads;
+  }
+
+  /// Returns the number of registers confirmed by other traffic so far.
+  uint32_t getConfirmations() const
+  {
+    return confirmations;
+  }
+
+private:
+
+  /// The most registers one tick reads.
+  static const uint8_t maxBudget = 16;
+
+  static void readbackCallback(void * context, uint8_t address, bool matches)
+  {
+    DRV8461SettingsVerifier * self = static_cast<DRV8461SettingsVerifier *>(context);
+    if (matches)
+    {
+      self->confirmed |= (uint64_t)1 << address;
+      self->confirmations++;
+    }
+    else
+    {
+      self->mismatch(address);
+    }
+  }
+
+  void mismatch(uint8_t address)
+  {
+    if (!pending.registers) { pending.time = clock ? clock() : 0; }
+    pending.registers |= (uint64_t)1 << address;
+  }
+
+  Driver & sd;
+  uint32_t (*clock)();
+  uint8_t budget;
+
+  uint8_t cursor = 0;
+  uint64_t confirmed = 0;
+  DRV8461MismatchEvent pending = {};
+  uint32_t reads = 0;
+  uint32_t confirmations = 0;
+};
+
+
+#endif                                    // #ifndef DRV8461_VERIFIER_H
@@ -0,0 +1,147 @@
+#ifndef DRV8461_WAVETABLE_H
+#define DRV8461_WAVETABLE_H
+
+/*  DRV8461_Wavetable.h
+
+    Generation of custom microstep current tables (CUSTOM_CTRL2-9) for the
+    DRV8461, at compile time or at run time.
+
+*/
+#pragma once
+
+#include <cstdint>
+
+#include "DRV8461_Register_Address_Locations.h"
+
+
+/// The number of entries in a custom microstep table.
+static const uint8_t DRV8461_WAVETABLE_POINTS = 8;
+
+/// A custom microstep table: the coil current at each 1/8 step of the first
+/// quarter of an electrical cycle (0 to 90 degrees, not counting 0), as
+/// written to CUSTOM_CTRL2-9.  255 is full scale.  The driver mirrors the
+/// table to build the rest of the cycle and to drive the other coil.
+///
+/// Tables are built with DRV8461_sineWavetable(),
+/// DRV8461_harmonicWavetable() or DRV8461_pointsWavetable(), all of which can
+/// run at compile time, and uploaded with DRV8434S::setWavetable().
+struct DRV8461Wavetable
+{
+  uint8_t current[DRV8461_WAVETABLE_POINTS];
+};
+
+
+// CONSTEXPR MATH ****************************************************************************************************//
+
+constexpr double DRV8461_PI = 3.14159265358979323846;
+
+/// Returns sin(x), usable in constant expressions.  Accurate to about 1e-12,
+/// far more than the 8-bit table needs.
+constexpr double DRV8461_sin(double x)
+{
+  // Reduce to [-pi, pi], then to [-pi/2, pi/2] using sin(pi - x) = sin(x).
+  long turns = (long)(x / (2 * DRV8461_PI));
+  x -= turns * 2 * DRV8461_PI;
+  if (x > DRV8461_PI) { x -= 2 * DRV8461_PI; }
+  if (x < -DRV8461_PI) { x += 2 * DRV8461_PI; }
+  if (x > DRV8461_PI / 2) { x = DRV8461_PI - x; }
+  if (x < -DRV8461_PI / 2) { x = -DRV8461_PI - x; }
+
+  double term = x, sum = x;
+  for (int n = 1; n < 12; n++)
+  {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+/// Converts a current from 0.0 to 1.0 of full scale to a table entry,
+/// rounding to nearest and clipping.
+constexpr uint8_t DRV8461_wavetableEntry(double value)
+{
+  return value <= 0 ? 0 : value >= 1 ? 255 : (uint8_t)(value * 255 + 0.5);
+}
+
+
+// GENERATORS ********************************************************************************************************//
+
+/// Returns the table for a pure sine wave.  This matches the driver's
+/// built-in table and is a starting point for corrections.
+constexpr DRV8461Wavetable DRV8461_sineWavetable()
+{
+  DRV8461Wavetable t = {};
+  for (uint8_t k = 1; k <= DRV8461_WAVETABLE_POINTS; k++)
+  {
+    t.current[k - 1] = DRV8461_wavetableEntry(DRV8461_sin(k * DRV8461_PI / 2 / DRV8461_WAVETABLE_POINTS));
+  }
+  return t;
+}
+
+/// Returns the table for a sine wave with added 3rd and 5th harmonics, given
+/// in percent of the fundamental (a positive 3rd harmonic flattens the peak,
+/// a negative one sharpens it).  This is the usual way to cancel the detent torque
+/// ripple of a hybrid stepper.  The result is scaled so that its largest
+/// entry is full scale.
+constexpr DRV8461Wavetable DRV8461_harmonicWavetable(int8_t thirdPercent, int8_t fifthPercent)
+{
+  double values[DRV8461_WAVETABLE_POINTS] = {};
+  double peak = 0;
+  for (uint8_t k = 1; k <= DRV8461_WAVETABLE_POINTS; k++)
+  {
+    double theta = k * DRV8461_PI / 2 / DRV8461_WAVETABLE_POINTS;
+    double v = DRV8461_sin(theta) + thirdPercent / 100.0 * DRV8461_sin(3 * theta) +
+      fifthPercent / 100.0 * DRV8461_sin(5 * theta);
+    values[k - 1] = v;
+    if (v > peak) { peak = v; }
+  }
+
+  DRV8461Wavetable t = {};
+  for (uint8_t i = 0; i < DRV8461_WAVETABLE_POINTS; i++)
+  {
+    t.current[i] = DRV8461_wavetableEntry(peak > 0 ? values[i] / peak : 0);
+  }
+  return t;
+}
+
+/// Returns a table interpolated from measured or hand-tuned points.  The `N`
+/// points (at least 2) are currents from 0.0 to 1.0, spaced evenly from 0 to
+/// 90 degrees inclusive; they are interpolated linearly onto the table's
+/// eight positions.
+template <uint8_t N>
+constexpr DRV8461Wavetable DRV8461_pointsWavetable(const double (&points)[N])
+{
+  static_assert(N >= 2, "at least two points are needed");
+
+  DRV8461Wavetable t = {};
+  for (uint8_t k = 1; k <= DRV8461_WAVETABLE_POINTS; k++)
+  {
+    // Position of this entry in units of the point spacing.
+    double x = (double)k * (N - 1) / DRV8461_WAVETABLE_POINTS;
+    uint8_t i = (uint8_t)x;
+    if (i >= N - 1) { i = N - 2; }
+    double f = x - i;
+    t.current[k - 1] = DRV8461_wavetableEntry(points[i] + (points[i + 1] - points[i]) * f);
+  }
+  return t;
+}
+
+
+// GOLDEN VALUES *****************************************************************************************************//
+constexpr bool DRV8461_checkSineWavetable()
+{
+  const uint8_t golden[DRV8461_WAVETABLE_POINTS] = { 50, 98, 142, 180, 212, 236, 250, 255 };
+  DRV8461Wavetable t = DRV8461_sineWavetable();
+  for (uint8_t i = 0; i < DRV8461_WAVETABLE_POINTS; i++)
+  {
+    if (t.current[i] != golden[i]) { return false; }
+  }
+  return true;
+}
+
+static_assert(DRV8461_checkSineWavetable(), "sine table does not match round(255 sin(k * 11.25 deg))");
+static_assert(DRV8461_harmonicWavetable(0, 0).current[3] == 180, "no harmonics is a pure sine");
+static_assert(DRV8461_harmonicWavetable(10, 0).current[7] == 255, "the peak is scaled to full scale");
+static_assert(DRV8461_harmonicWavetable(10, 0).current[3] > 180, "a positive 3rd harmonic flattens the wave");
+
+#endif                                    // #ifndef DRV8461_WAVETABLE_H
@@ -0,0 +1,78 @@
+/*  DRV8461_bench.cpp
+
+    Host benchmark for the driver stack: runs the driver headers against
+    DRV8461SimBus and reports the CPU and bus cost of each operation.
+
+    Usage: drv8461_bench [--iterations N] [--clock HZ] [--json FILE] [--quiet]
+
+    The table goes to stderr and the JSON document to stdout, or to FILE with
+    --json, so two commits can be compared by diffing their output.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DRV8461_Benchmark.h"
+
+
+static void usage(const char * program)
+{
+  fprintf(stderr, "usage: %s [--iterations N] [--clock HZ] [--json FILE] [--quiet]\n", program);
+}
+
+int main(int argc, char ** argv)
+{
+  uint32_t iterations = 20000;
+  uint32_t clockHz = 5000000;
+  const char * jsonPath = nullptr;
+  bool quiet = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--iterations") && i + 1 < argc) { iterations = strtoul(argv[++i], nullptr, 0); }
+    else if (!strcmp(argv[i], "--clock") && i + 1 < argc) { clockHz = strtoul(argv[++i], nullptr, 0); }
+    else if (!strcmp(argv[i], "--json") && i + 1 < argc) { jsonPath = argv[++i]; }
+    else if (!strcmp(argv[i], "--quiet")) { quiet = true; }
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (iterations == 0 || clockHz == 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  DRV8461Benchmark bench;
+  DRV8461_benchmarkDriver(bench, iterations, clockHz);
+  DRV8461_benchmarkSpiDev(bench, iterations, clockHz);
+  DRV8461_benchmarkFields(bench, 100 * iterations);
+  DRV8461_benchmarkStepEngine(bench, 10 * iterations);
+  DRV8461_benchmarkMultiAxis(bench, 10 * iterations);
+  DRV8461_benchmarkWavetable(bench, iterations);
+  DRV8461_benchmarkTelemetry(bench, 10 * iterations);
+
+  if (!quiet) { bench.print(stderr); }
+
+  FILE * out = stdout;
+  if (jsonPath)
+  {
+    out = fopen(jsonPath, "w");
+    if (!out)
+    {
+      perror(jsonPath);
+      return 1;
+    }
+  }
+  if (!quiet || jsonPath) { bench.write(out); }
+  if (jsonPath && fclose(out) != 0)
+  {
+    perror(jsonPath);
+    return 1;
+  }
+  return 0;
+}
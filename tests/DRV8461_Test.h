@@ -0,0 +1,41 @@
+#ifndef DRV8461_TEST_H
+#define DRV8461_TEST_H
+
+/*  DRV8461_Test.h
+
+    A minimal check macro for the host tests, which run the library against
+    DRV8461SimBus.  Each test is a program whose exit status is the result.
+
+*/
+#pragma once
+
+#include <stdio.h>
+
+
+/// Returns the number of failed checks so far.
+inline int & DRV8461_testFailures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+/// Records a failure, with its place and text, if `condition` is false.
+#define DRV8461_CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      DRV8461_testFailures()++; \
+    } \
+  } while (0)
+
+/// Returns the exit status for main(): 0 if every check passed.
+inline int DRV8461_testResult()
+{
+  if (DRV8461_testFailures()) { fprintf(stderr, "%d check(s) failed\n", DRV8461_testFailures()); }
+  return DRV8461_testFailures() ? 1 : 0;
+}
+
+
+#endif                                    // #ifndef DRV8461_TEST_H
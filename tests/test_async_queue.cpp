@@ -0,0 +1,135 @@
+/*  test_async_queue.cpp
+
+    DRV8461AsyncQueue in front of a simulated slow bus: the caller's latency
+    does not grow with the queue, a service thread drains it correctly, and
+    the bus lock keeps service() off the bus.
+
+*/
+
+#include <thread>
+
+#include "DRV8461_AsyncQueue.h"
+#include "DRV8461_Benchmark.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+/// A DRV8461SimBus that takes `frameTime` ns of real time per frame, like a
+/// bus driven a byte at a time.
+class SlowBus : public DRV8461SimBus
+{
+public:
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    uint64_t end = DRV8461Benchmark::now() + (uint64_t)frameTime * frameCount;
+    while (DRV8461Benchmark::now() < end) {}
+    DRV8461SimBus::transfer(frames, frameLength, frameCount);
+  }
+
+  uint32_t frameTime = 20000;
+};
+
+typedef BasicDRV8434SSPI<SlowBus> Driver;
+typedef DRV8461AsyncQueue<Driver, 64> Queue;
+
+/// Returns the shortest time, over `runs` tries, of one submission made with
+/// `depth` requests already queued.
+static uint64_t submitLatency(Queue & queue, uint8_t depth, uint32_t runs)
+{
+  uint64_t best = UINT64_MAX;
+  for (uint32_t r = 0; r < runs; r++)
+  {
+    while (queue.pending() < depth) { queue.submitRead(DRV8461_REG_ADDR::DRV8461_REG_FAULT); }
+    uint64_t start = DRV8461Benchmark::now();
+    queue.submitWrite(DRV8461_REG_ADDR::DRV8461_REG_CTRL11, 0x80);
+    uint64_t elapsed = DRV8461Benchmark::now() - start;
+    if (elapsed < best) { best = elapsed; }
+    while (queue.pending()) { queue.service(); }
+  }
+  return best;
+}
+
+struct Completion
+{
+  uint32_t count;
+  uint32_t wrong;
+};
+
+static void onRead(void * context, const DRV8461RegResult & result)
+{
+  Completion & c = *static_cast<Completion *>(context);
+  if (result.data != (uint8_t)c.count) { c.wrong++; }
+  c.count++;
+}
+
+int main()
+{
+  // Latency: a direct read waits for the bus; a submission does not, and
+  // costs the same with 1 or 63 requests ahead of it.
+  {
+    Driver driver;
+    Queue queue(driver);
+
+    uint64_t start = DRV8461Benchmark::now();
+    driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+    uint64_t direct = DRV8461Benchmark::now() - start;
+    DRV8461_CHECK(direct >= driver.bus.frameTime);
+
+    uint64_t shallow = submitLatency(queue, 1, 200);
+    uint64_t deep = submitLatency(queue, 63, 200);
+    fprintf(stderr, "submit latency: %llu ns at depth 1, %llu ns at depth 63; direct read %llu ns\n",
+      (unsigned long long)shallow, (unsigned long long)deep, (unsigned long long)direct);
+    DRV8461_CHECK(deep < 4 * shallow + 200);
+    DRV8461_CHECK(deep * 10 < direct);
+  }
+
+  // A service thread drains requests submitted by the main thread, in
+  // order, with the right data.
+  {
+    Driver driver;
+    driver.bus.frameTime = 2000;
+    Queue queue(driver);
+    const uint32_t total = 2000;
+    Completion completion = {};
+    std::atomic<bool> stop{false};
+
+    std::thread consumer([&] {
+      while (!stop.load()) { queue.service(); }
+      while (queue.service()) {}
+    });
+    DRV8461AsyncResult last;
+    for (uint32_t i = 0; i < total; i++)
+    {
+      // CTRL11 (TRQ_DAC) is fully writable: write i, then read it back.
+      while (!queue.submitWrite(DRV8461_REG_ADDR::DRV8461_REG_CTRL11, (uint8_t)i)) {}
+      while (!queue.submitRead(DRV8461_REG_ADDR::DRV8461_REG_CTRL11, i + 1 == total ? &last : nullptr,
+        onRead, &completion)) {}
+    }
+    while (!last.complete()) {}
+    stop = true;
+    consumer.join();
+    DRV8461_CHECK(completion.count == total);
+    DRV8461_CHECK(completion.wrong == 0);
+    DRV8461_CHECK(last.data == (uint8_t)(total - 1));
+    DRV8461_CHECK(driver.bus.frames == 2 * total);
+  }
+
+  // While the bus is locked, service() leaves the queue alone.
+  {
+    Driver driver;
+    driver.bus.frameTime = 0;
+    Queue queue(driver);
+    DRV8461AsyncResult result;
+    queue.submitRead(DRV8461_REG_ADDR::DRV8461_REG_FAULT, &result);
+    queue.lockBus();
+    uint32_t frames = driver.bus.frames;
+    driver.writeReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL11, 0x40);
+    DRV8461_CHECK(queue.service() == 0);
+    DRV8461_CHECK(driver.bus.frames == frames + 1);
+    DRV8461_CHECK(!result.complete());
+    queue.unlockBus();
+    DRV8461_CHECK(queue.service() == 1);
+    DRV8461_CHECK(result.complete());
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,87 @@
+/*  test_atq.cpp
+
+    The auto-torque API of BasicDRV8434S against DRV8461SimBus: where the
+    setters put their values, how they clip them, and that learned constants
+    are cached and restored by applySettings().
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+
+static uint8_t reg(DRV8461SimBus & bus, DRV8461_REG_ADDR address)
+{
+  return bus.regs[(uint8_t)address];
+}
+
+int main()
+{
+  Driver sd;
+  DRV8461SimBus & bus = sd.driver.bus;
+  sd.applySettings();
+
+  // Limits: ATQ_LL in CTRL4, ATQ_UL in CTRL3.
+  sd.setATQLimits(20, 180);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL4) == 20);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL3) == 180);
+
+  // Gains: KP in CTRL5, KD in the low 4 bits of CTRL6 (clipped to 15),
+  // ATQ_D_THR in CTRL9.
+  sd.setATQGains(100, 7, 33);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL5) == 100);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL6) == 7);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL9) == 33);
+  sd.setATQGains(255, 0x1F, 0);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL5) == 255);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL6) == 15);
+  DRV8461_CHECK(sd.getField<DRV8461Fields::KD>() == 15);
+
+  // Current range: ATQ_TRQ_MIN in CTRL7, ATQ_TRQ_MAX in CTRL8; a minimum
+  // above the maximum is lowered to it.
+  sd.setATQCurrentRange(60, 200);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL7) == 60);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL8) == 200);
+  sd.setATQCurrentRange(200, 120);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL7) == 120);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL8) == 120);
+
+  // Learning: nothing to read until it has been started.
+  bus.learnedConst1 = 0x2A5;
+  bus.learnedConst2 = 0x15A;
+  DRV8461_CHECK(!sd.pollATQLearning());
+  DRV8461_CHECK(sd.getField<DRV8461Fields::LRN_CONST1>() == 0);
+
+  sd.startATQLearning(40, DRV8461_ATQ_Learn_Step::DRV8461_ATQ_LRN_STEP_4,
+    DRV8461_ATQ_Learn_Cycles::DRV8461_ATQ_LRN_CYCLES_16);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL11) == 40);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL16) == ((0b01 << 2) | 0b10));
+  DRV8461_CHECK(!DRV8461Fields::LRN_START::extract(sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL10)));
+
+  // Finished learning: the constants are copied into the cache.
+  DRV8461_CHECK(sd.pollATQLearning());
+  DRV8461_CHECK(sd.getField<DRV8461Fields::LRN_CONST1>() == 0x2A5);
+  DRV8461_CHECK(sd.getField<DRV8461Fields::LRN_CONST2>() == 0x15A);
+  DRV8461_CHECK(sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL12) == 0xA5);
+  DRV8461_CHECK(sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL13) == 0x02);
+  DRV8461_CHECK(sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL14) == 0x5A);
+  DRV8461_CHECK(sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL15) == 0x01);
+  sd.enableATQ();
+  DRV8461_CHECK(sd.verifySettings());
+
+  // After a power loss, applySettings() puts the learned constants and the
+  // rest of the ATQ settings back.
+  bus.powerOnReset();
+  DRV8461_CHECK(DRV8461Fields::LRN_CONST1::get(bus.regs) == 0);
+  DRV8461_CHECK(!sd.verifySettings());
+  sd.applySettings();
+  DRV8461_CHECK(sd.verifySettings());
+  DRV8461_CHECK(DRV8461Fields::LRN_CONST1::get(bus.regs) == 0x2A5);
+  DRV8461_CHECK(DRV8461Fields::LRN_CONST2::get(bus.regs) == 0x15A);
+  DRV8461_CHECK(DRV8461Fields::ATQ_EN::get(bus.regs));
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL3) == 180);
+  DRV8461_CHECK(reg(bus, DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL8) == 120);
+
+  return DRV8461_testResult();
+}
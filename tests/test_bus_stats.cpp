@@ -0,0 +1,83 @@
+/*  test_bus_stats.cpp
+
+    DRV8461BusStats on a driver talking to DRV8461SimBus, with a clock that
+    advances by a set amount per reading so every transfer has a known
+    latency.
+
+*/
+
+#include "DRV8461_Instrumentation.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+/// A clock that advances by `step` ticks each time it is read.  A transfer
+/// reads it twice, so each one takes `step` ticks.
+struct StepClock
+{
+  static uint32_t now()
+  {
+    return time += step;
+  }
+
+  static uint32_t time;
+  static uint32_t step;
+};
+
+uint32_t StepClock::time = 0;
+uint32_t StepClock::step = 0;
+
+typedef BasicDRV8434S<DRV8461SimBus, DRV8461BusStats<StepClock>> Driver;
+
+int main()
+{
+  Driver sd;
+  DRV8461BusStatsSnapshot s;
+
+  // Nothing yet.
+  sd.driver.stats.snapshot(s);
+  DRV8461_CHECK(s.transactions == 0 && s.frames == 0 && s.bytes == 0 && s.latencyMax == 0);
+  DRV8461_CHECK(s.latencyPercentile(99) == 0);
+
+  // One batch of writes, then reads of FAULT and CTRL1; the counts match
+  // what the device saw.
+  sd.applySettings();
+  for (uint8_t i = 0; i < 3; i++) { sd.readFault(); }
+  sd.driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+  sd.driver.stats.snapshot(s);
+  DRV8461_CHECK(s.transactions == 5);
+  DRV8461_CHECK(s.transactions == sd.driver.bus.transactions);
+  DRV8461_CHECK(s.frames == sd.driver.bus.frames);
+  DRV8461_CHECK(s.bytes == sd.driver.bus.bytes);
+  DRV8461_CHECK(s.frames == Driver::settingsRegCount + 4);
+  DRV8461_CHECK(s.reads[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] == 3);
+  DRV8461_CHECK(s.writes[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] == 0);
+  DRV8461_CHECK(s.reads[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1] == 1);
+  DRV8461_CHECK(s.writes[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1] == 1);
+  DRV8461_CHECK(s.bytesAt(DRV8461_REG_ADDR::DRV8461_REG_FAULT) == 6);
+  DRV8461_CHECK(s.bytesAt(DRV8461_REG_ADDR::DRV8461_REG_CTRL1) == 4);
+  DRV8461_CHECK(s.bytesAt(DRV8461_REG_ADDR::DRV8461_REG_CTRL2) == 2);
+  DRV8461_CHECK(s.latency[0] == 5 && s.latencyMax == 0);
+
+  // Latencies: 90 transfers of 3 ticks and 10 of 1000.  Percentiles are
+  // bucket upper bounds, capped at the largest latency seen.
+  sd.driver.stats.reset();
+  sd.driver.stats.snapshot(s);
+  DRV8461_CHECK(s.transactions == 0 && s.frames == 0 && s.reads[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] == 0);
+
+  StepClock::step = 3;
+  for (uint8_t i = 0; i < 90; i++) { sd.readFault(); }
+  StepClock::step = 1000;
+  for (uint8_t i = 0; i < 10; i++) { sd.readFault(); }
+  sd.driver.stats.snapshot(s);
+  DRV8461_CHECK(s.transactions == 100);
+  DRV8461_CHECK(s.latency[2] == 90);     // 2-3 ticks
+  DRV8461_CHECK(s.latency[10] == 10);    // 512-1023 ticks
+  DRV8461_CHECK(s.latencyMax == 1000);
+  DRV8461_CHECK(s.latencyPercentile(50) == 3);
+  DRV8461_CHECK(s.latencyPercentile(90) == 3);
+  DRV8461_CHECK(s.latencyPercentile(91) == 1000);
+  DRV8461_CHECK(s.latencyPercentile(100) == 1000);
+  DRV8461_CHECK(s.bytesAt(DRV8461_REG_ADDR::DRV8461_REG_FAULT) == 200);
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,140 @@
+/*  test_current.cpp
+
+    DRV8461CurrentTable lookups, and DRV8461CurrentScheduler switching the
+    run current of a DRV8461SimBus with the phases of a DRV8461StepEngine
+    move on a simulated timer.
+
+*/
+
+#include "DRV8461_Current.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+/// A DRV8461SimBus that counts the writes to CTRL11 (TRQ_DAC).
+class RecordingBus : public DRV8461SimBus
+{
+public:
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    for (uint8_t i = 0; i < frameCount; i++)
+    {
+      uint8_t command = frames[i * frameLength];
+      if (!DRV8461_commandIsRead(command) && DRV8461_commandAddress(command) == ctrl11) { trqDacWrites++; }
+    }
+    DRV8461SimBus::transfer(frames, frameLength, frameCount);
+  }
+
+  static const uint8_t ctrl11 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL11;
+  uint32_t trqDacWrites = 0;
+};
+
+typedef BasicDRV8434S<RecordingBus> Driver;
+typedef DRV8461StepEngine<DRV8461SimStepHal> Engine;
+typedef DRV8461CurrentScheduler<Driver, Engine> Scheduler;
+
+// A full current that is not a multiple of the resolution: the top of the
+// range still gives 255, and nothing below it rounds up.
+static constexpr DRV8461CurrentTable<1505> table;
+static_assert(DRV8461CurrentTable<1505>::size == 151, "one entry per 10 mA below the full current");
+static_assert(table.code(0) == 0 && table.code(9) == 0, "small currents give code 0");
+static_assert(table.code(1504) == DRV8461_currentToDac(1500, 1505), "rounded down to 1500 mA");
+static_assert(table.code(1505) == 255 && table.code(2000) == 255, "the full current and above give 255");
+static_assert(DRV8461CurrentTable<1500>::size == 150 && DRV8461CurrentTable<1500>().code(1500) == 255,
+  "an exact multiple has no unused last entry");
+
+static uint8_t trqDac(Driver & sd)
+{
+  return sd.driver.bus.regs[RecordingBus::ctrl11];
+}
+
+/// Runs the move one step at a time, ticking the scheduler after each step,
+/// and checks that the device's TRQ_DAC follows the phase with one write per
+/// change.
+///
+/// @return The number of phase changes seen after start().
+static uint32_t runMove(Driver & sd, DRV8461SimStepHal & hal, Engine & engine, Scheduler & currents,
+  const DRV8461PhaseCurrents & codes)
+{
+  uint32_t writes = sd.driver.bus.trqDacWrites;
+  currents.start();
+  DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes + 1);
+  DRV8461_CHECK(trqDac(sd) == codes.accel);
+  DRV8461_CHECK(hal.steps > 0);
+
+  uint32_t changes = 0;
+  bool matched = true;
+  DRV8461_Motion_Phase phase = DRV8461_Motion_Phase::DRV8461_PHASE_ACCEL;
+  while (engine.isRunning())
+  {
+    hal.run(engine, 1);
+    writes = sd.driver.bus.trqDacWrites;
+    bool wrote = currents.tick();
+    bool changed = engine.getPhase() != phase;
+    phase = engine.getPhase();
+    changes += changed;
+
+    uint8_t expected = phase == DRV8461_Motion_Phase::DRV8461_PHASE_ACCEL ? codes.accel :
+      phase == DRV8461_Motion_Phase::DRV8461_PHASE_CRUISE ? codes.cruise :
+      phase == DRV8461_Motion_Phase::DRV8461_PHASE_DECEL ? codes.decel : codes.hold;
+    matched = matched && trqDac(sd) == expected && wrote == (sd.driver.bus.trqDacWrites == writes + 1) &&
+      sd.driver.bus.trqDacWrites <= writes + 1 && (changed || !wrote);
+  }
+  DRV8461_CHECK(matched);
+  DRV8461_CHECK(phase == DRV8461_Motion_Phase::DRV8461_PHASE_IDLE);
+  DRV8461_CHECK(trqDac(sd) == codes.hold);
+
+  // Nothing more while idle.
+  writes = sd.driver.bus.trqDacWrites;
+  for (uint8_t i = 0; i < 10; i++) { DRV8461_CHECK(!currents.tick()); }
+  DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes);
+  return changes;
+}
+
+int main()
+{
+  const DRV8461PhaseCurrents codes = { table.code(1400), table.code(900), table.code(1100), table.code(300) };
+
+  // A trapezoid: accel, cruise, decel, idle, one write for each.
+  {
+    Driver sd;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    Scheduler currents(sd, engine, codes);
+
+    DRV8461_CHECK(engine.plan(4000, 8000, 40000));
+    uint32_t writes = sd.driver.bus.trqDacWrites;
+    DRV8461_CHECK(runMove(sd, hal, engine, currents, codes) == 3);
+    DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes + 4);
+    DRV8461_CHECK(currents.getSwitches() == 4);
+    DRV8461_CHECK(sd.getField<DRV8461Fields::TRQ_DAC>() == (DRV_Run_Current)codes.hold);
+
+    // A move too short to cruise (an even number of gaps): accel, decel,
+    // idle.
+    DRV8461_CHECK(engine.plan(-201, 8000, 40000));
+    writes = sd.driver.bus.trqDacWrites;
+    DRV8461_CHECK(runMove(sd, hal, engine, currents, codes) == 2);
+    DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes + 3);
+  }
+
+  // Phases that share a current cost no write when they change.
+  {
+    Driver sd;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    const DRV8461PhaseCurrents flat = { codes.accel, codes.accel, codes.accel, table.code(200) };
+    Scheduler currents(sd, engine, flat);
+
+    DRV8461_CHECK(engine.plan(4000, 8000, 40000));
+    uint32_t writes = sd.driver.bus.trqDacWrites;
+    runMove(sd, hal, engine, currents, flat);
+    DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes + 2);
+
+    // New currents are written at the next tick.
+    currents.setCurrents(codes);
+    DRV8461_CHECK(sd.driver.bus.trqDacWrites == writes + 2);
+    DRV8461_CHECK(currents.tick());
+    DRV8461_CHECK(trqDac(sd) == codes.hold);
+  }
+
+  return DRV8461_testResult();
+}
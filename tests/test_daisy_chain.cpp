@@ -0,0 +1,115 @@
+/*  test_daisy_chain.cpp
+
+    BasicDRV8461DaisyChain against a simulated chain of shift-register
+    devices (DRV8461SimChainBus).
+
+*/
+
+#include "DRV8461_DaisyChain.h"
+#include "DRV8461_Instrumentation.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+static const uint8_t N = 3;
+
+typedef BasicDRV8434S<DRV8461SimBus, DRV8461BusStats<DRV8461SteadyClock>> Device;
+typedef BasicDRV8461DaisyChain<DRV8461SimChainBus<N>, N, Device> Chain;
+
+static uint8_t seen[N];
+static uint32_t calls[N];
+
+static void onStatus(void * context, uint8_t status)
+{
+  uint8_t i = (uint8_t)(uintptr_t)context;
+  seen[i] = status;
+  calls[i]++;
+}
+
+static uint8_t reg(Chain & chain, uint8_t device, DRV8461_REG_ADDR address)
+{
+  return chain.bus.devices[device].regs[(uint8_t)address];
+}
+
+int main()
+{
+  Device devices[N];
+  Chain chain;
+  for (uint8_t i = 0; i < N; i++)
+  {
+    DRV8461_CHECK(chain.addDevice(devices[i]));
+    devices[i].driver.setStatusCallback(onStatus, (void *)(uintptr_t)i);
+  }
+  DRV8461_CHECK(!chain.addDevice(devices[0]));
+
+  // Each device gets its own register value from one frame.
+  const DRV8461_REG_ADDR ctrl11 = DRV8461_REG_ADDR::DRV8461_REG_CTRL11;
+  const uint8_t values[N] = { 0x11, 0x22, 0x33 };
+  uint8_t old[N];
+  uint32_t transactions = chain.bus.transactions;
+  chain.writeReg(ctrl11, values, old);
+  DRV8461_CHECK(chain.bus.transactions == transactions + 1);
+  DRV8461_CHECK(chain.bus.bytes == 2 * N + 2);
+  for (uint8_t i = 0; i < N; i++)
+  {
+    DRV8461_CHECK(reg(chain, i, ctrl11) == values[i]);
+    DRV8461_CHECK(old[i] == DRV8461_regInfo(ctrl11).resetValue);
+  }
+
+  uint8_t data[N];
+  chain.readReg(ctrl11, data);
+  for (uint8_t i = 0; i < N; i++) { DRV8461_CHECK(data[i] == values[i]); }
+
+  // Settings written from each device's cache, then verified.
+  devices[0].setStepMode(16);
+  devices[1].setStepMode(32);
+  devices[2].setDecayMode(DRV8461_Decay_Mode::DRV8461_DECAY_SMART_RIPPLE);
+  chain.applySettings();
+  for (uint8_t i = 0; i < N; i++)
+  {
+    for (uint8_t r = 0; r < Device::settingsRegCount; r++)
+    {
+      DRV8461_REG_ADDR address = Device::settingsReg(r);
+      uint8_t mask = DRV8461_regInfo(address).settingsMask();
+      DRV8461_CHECK(((reg(chain, i, address) ^ devices[i].getCachedReg(address)) & mask) == 0);
+    }
+  }
+  DRV8461_CHECK(chain.verifySettings());
+
+  // Bits the device changes by itself (VM_ADC) do not fail the check; lost
+  // settings do.
+  chain.bus.devices[1].regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL14] |= 0xF8;
+  DRV8461_CHECK(chain.verifySettings());
+  chain.bus.devices[2].corrupt(1);
+  DRV8461_CHECK(!chain.verifySettings());
+  chain.applySettings();
+  DRV8461_CHECK(chain.verifySettings());
+
+  // Each device's status byte reaches its own status callback.
+  chain.bus.devices[1].regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] =
+    (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT | (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OL;
+  for (uint8_t i = 0; i < N; i++) { calls[i] = 0; }
+  chain.readReg(ctrl11, data);
+  for (uint8_t i = 0; i < N; i++) { DRV8461_CHECK(calls[i] == 1); }
+  DRV8461_CHECK(seen[0] == 0xC0 && seen[2] == 0xC0);
+  DRV8461_CHECK(seen[1] == (0xC0 | (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OL));
+  DRV8461_CHECK(devices[1].driver.lastStatus == seen[1]);
+
+  // HDR2 CLR clears the faults on every device.
+  chain.clearFaults();
+  DRV8461_CHECK(reg(chain, 1, DRV8461_REG_ADDR::DRV8461_REG_FAULT) == 0);
+  chain.readReg(ctrl11, data);
+  DRV8461_CHECK(seen[1] == 0xC0);
+
+  // A frame built for a shorter chain is ignored by the devices it leaves
+  // out.
+  BasicDRV8461DaisyChain<DRV8461SimChainBus<N>, N, Device> partial;
+  partial.addDevice(devices[0]);
+  partial.addDevice(devices[1]);
+  const uint8_t two[2] = { 0x44, 0x55 };
+  partial.writeReg(ctrl11, two);
+  DRV8461_CHECK(reg(partial, 0, ctrl11) == 0x44);
+  DRV8461_CHECK(reg(partial, 1, ctrl11) == 0x55);
+  DRV8461_CHECK(reg(partial, 2, ctrl11) == DRV8461_regInfo(ctrl11).resetValue);
+
+  return DRV8461_testResult();
+}
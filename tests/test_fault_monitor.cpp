@@ -0,0 +1,136 @@
+/*  test_fault_monitor.cpp
+
+    DRV8461FaultMonitor against DRV8461SimBus: what it costs on the bus while
+    the status is steady, and the events it records when faults come and go.
+
+*/
+
+#include "DRV8461_FaultMonitor.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+typedef BasicDRV8434SSPI<DRV8461SimBus> DriverSPI;
+
+static const uint8_t FAULT = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT;
+static const uint8_t SPI_ERR = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR;
+static const uint8_t OCP = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OCP;
+static const uint8_t OL = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OL;
+static const uint8_t SUMMARY = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT;
+
+static uint32_t now = 0;
+static uint32_t ticks() { return now; }
+
+template <class Monitor>
+static bool popEvent(Monitor & monitor, uint8_t fault, bool active, uint32_t time)
+{
+  DRV8461FaultEvent event;
+  return monitor.pop(event) && (uint8_t)event.fault == fault && event.active == active && event.time == time;
+}
+
+int main()
+{
+  Driver sd;
+  DRV8461SimBus & bus = sd.driver.bus;
+  DRV8461FaultMonitor<DriverSPI, 16> monitor(sd.driver, ticks);
+  monitor.attach();
+
+  // A steady status costs nothing beyond the application's own frames.
+  {
+    uint32_t frames = bus.frames;
+    for (uint8_t i = 0; i < 100; i++)
+    {
+      sd.setStepMode(i & 1 ? 16 : 32);
+      sd.readFault();
+    }
+    sd.applySettings();
+    DRV8461_CHECK(monitor.reads == 0);
+    DRV8461_CHECK(bus.frames == frames + 200 + Driver::settingsRegCount);
+    DRV8461_CHECK(monitor.pending() == 0);
+  }
+
+  // A change in the status byte: one 4-frame refresh, one rise event (the
+  // summary bit is not reported), then nothing more while it stays.
+  {
+    now = 1000;
+    bus.regs[FAULT] = SUMMARY | OCP;
+    uint32_t frames = bus.frames, transactions = bus.transactions;
+    sd.readFault();
+    DRV8461_CHECK(monitor.reads == 1);
+    DRV8461_CHECK(bus.frames == frames + 1 + 4);
+    DRV8461_CHECK(bus.transactions == transactions + 2);
+    DRV8461_CHECK(monitor.getFault() == (SUMMARY | OCP));
+    DRV8461_CHECK(popEvent(monitor, OCP, true, 1000));
+    DRV8461_CHECK(monitor.pending() == 0);
+
+    for (uint8_t i = 0; i < 50; i++) { sd.readFault(); }
+    DRV8461_CHECK(monitor.reads == 1);
+  }
+
+  // SPI_ERR is not in the status byte: it is only seen when something else
+  // changes and FAULT is read.
+  {
+    now = 2000;
+    bus.regs[FAULT] |= SPI_ERR;
+    sd.readFault();
+    DRV8461_CHECK(monitor.reads == 1);
+    DRV8461_CHECK(monitor.pending() == 0);
+
+    now = 3000;
+    bus.regs[FAULT] |= OL;
+    sd.readFault();
+    DRV8461_CHECK(monitor.reads == 2);
+    DRV8461_CHECK(popEvent(monitor, SPI_ERR, true, 3000));
+    DRV8461_CHECK(popEvent(monitor, OL, true, 3000));
+    DRV8461_CHECK(monitor.pending() == 0);
+  }
+
+  // Clearing the faults: the CLR_FLT frame still carries the old status, so
+  // the fall events come with the next transfer, in bit order.
+  {
+    now = 4000;
+    sd.clearFaults();
+    DRV8461_CHECK(monitor.reads == 2);
+    sd.readFault();
+    DRV8461_CHECK(monitor.reads == 3);
+    DRV8461_CHECK(popEvent(monitor, SPI_ERR, false, 4000));
+    DRV8461_CHECK(popEvent(monitor, OCP, false, 4000));
+    DRV8461_CHECK(popEvent(monitor, OL, false, 4000));
+    DRV8461_CHECK(monitor.pending() == 0);
+    DRV8461_CHECK(monitor.getFault() == 0);
+  }
+
+  // A status byte whose top bits are not 11 (as from a failed transfer)
+  // forces a refresh even though the FAULT bits in it look unchanged.
+  {
+    now = 5000;
+    uint32_t frames = bus.frames;
+    sd.driver.reportStatus(0x00);
+    DRV8461_CHECK(monitor.reads == 4);
+    DRV8461_CHECK(bus.frames == frames + 4);
+    DRV8461_CHECK(monitor.pending() == 0);
+  }
+
+  // A full ring drops new events and counts them.
+  {
+    Driver sd2;
+    DRV8461FaultMonitor<DriverSPI, 4> small(sd2.driver, ticks);
+    small.attach();
+    for (uint8_t i = 0; i < 10; i++)
+    {
+      now = 6000 + i;
+      sd2.driver.bus.regs[FAULT] = i & 1 ? 0 : SUMMARY | OL;
+      sd2.readFault();
+    }
+    DRV8461_CHECK(small.reads == 10);
+    DRV8461_CHECK(small.pending() == 4);
+    DRV8461_CHECK(small.dropped == 6);
+    DRV8461_CHECK(popEvent(small, OL, true, 6000));
+    DRV8461_CHECK(popEvent(small, OL, false, 6001));
+    DRV8461_CHECK(popEvent(small, OL, true, 6002));
+    DRV8461_CHECK(popEvent(small, OL, false, 6003));
+    DRV8461_CHECK(small.pending() == 0);
+  }
+
+  return DRV8461_testResult();
+}
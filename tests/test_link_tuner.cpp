@@ -0,0 +1,88 @@
+/*  test_link_tuner.cpp
+
+    DRV8461LinkTuner against DRV8461SimBus, which garbles frames sent faster
+    than its maxReliableHz.
+
+*/
+
+#include "DRV8461_LinkTuner.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+
+static uint8_t fault(Driver & sd)
+{
+  return sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT];
+}
+
+int main()
+{
+  const uint8_t spiErr = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR;
+  const uint8_t ocp = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OCP;
+  const uint8_t summary = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT;
+
+  // The search stops below the error threshold and backs off by the margin;
+  // the SPI_ERR it provokes is cleared because nothing else is latched.
+  {
+    Driver sd;
+    sd.driver.bus.maxReliableHz = 4000000;
+    DRV8461LinkTuner<BasicDRV8434SSPI<DRV8461SimBus>> tuner(sd.driver);
+    uint8_t custom9 = sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL9];
+    uint32_t hz = tuner.calibrate(500000, 20000000);
+    DRV8461_CHECK(tuner.getStats().fastestGoodHz <= 4000000);
+    DRV8461_CHECK(tuner.getStats().fastestGoodHz > 4000000 * 100 / 125);
+    DRV8461_CHECK(hz < tuner.getStats().fastestGoodHz && hz >= 500000);
+    DRV8461_CHECK(sd.driver.bus.clockHz == hz);
+    DRV8461_CHECK(tuner.getStats().spiErrors > 0);
+    DRV8461_CHECK(fault(sd) == 0);
+    DRV8461_CHECK(tuner.getStats().unclearedFault == 0);
+    DRV8461_CHECK(sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL9] == custom9);
+  }
+
+  // A latched OCP is not cleared along with SPI_ERR.
+  {
+    Driver sd;
+    sd.driver.bus.maxReliableHz = 4000000;
+    sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] = ocp | summary;
+    DRV8461LinkTuner<BasicDRV8434SSPI<DRV8461SimBus>> tuner(sd.driver);
+    tuner.calibrate(500000, 20000000);
+    DRV8461_CHECK(fault(sd) == (ocp | summary | spiErr));
+    DRV8461_CHECK(tuner.getStats().unclearedFault == (ocp | summary | spiErr));
+  }
+
+  // Once attached, the tuner backs the clock off by itself when the link
+  // degrades, from ordinary driver traffic.
+  {
+    Driver sd;
+    sd.driver.bus.maxReliableHz = 8000000;
+    DRV8461LinkTuner<BasicDRV8434SSPI<DRV8461SimBus>> tuner(sd.driver);
+    uint32_t hz = tuner.calibrate(500000, 20000000);
+    tuner.attach();
+
+    sd.driver.bus.maxReliableHz = hz / 2;
+    for (uint16_t i = 0; i < 100; i++)
+    {
+      sd.setCurrentPercent(i % 2 ? 40 : 60);
+    }
+    DRV8461_CHECK(tuner.getStats().backoffs > 0);
+    DRV8461_CHECK(tuner.getStats().statusErrors > 0);
+    DRV8461_CHECK(tuner.getStats().spiErrors > 0);
+    DRV8461_CHECK(sd.driver.bus.clockHz <= hz / 2);
+
+    // Settled: no more errors, and SPI_ERR was cleared along the way.
+    DRV8461LinkStats before = tuner.getStats();
+    sd.applySettings();
+    DRV8461_CHECK(sd.verifySettings());
+    DRV8461_CHECK(tuner.getStats().statusErrors == before.statusErrors);
+    DRV8461_CHECK(fault(sd) == 0);
+
+    tuner.detach();
+    sd.driver.bus.maxReliableHz = 500000;
+    sd.readFault();
+    sd.readFault();
+    DRV8461_CHECK(tuner.getStats().statusErrors == before.statusErrors);
+  }
+
+  return DRV8461_testResult();
+}
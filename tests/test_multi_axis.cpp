@@ -0,0 +1,122 @@
+/*  test_multi_axis.cpp
+
+    DRV8461MultiAxis on a simulated timer (DRV8461SimMultiStepHal): 16 axes
+    stepping from one timebase, DIR setup before every step, arcs, and SPI
+    jobs kept between step events.
+
+*/
+
+#include <vector>
+
+#include "DRV8461_MultiAxis.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+typedef DRV8461SimMultiStepHal<16> Hal;
+typedef DRV8461MultiAxis<Driver, Hal, 16> Axes;
+
+static Driver drivers[17];
+
+struct Record
+{
+  std::vector<uint32_t> masks;
+};
+
+static void record(void * context, uint32_t mask, uint64_t)
+{
+  static_cast<Record *>(context)->masks.push_back(mask);
+}
+
+int main()
+{
+  Hal hal;
+  Axes axes(hal, 2000000);
+  for (uint8_t i = 0; i < 16; i++) { DRV8461_CHECK(axes.addAxis(drivers[i]) == i); }
+  DRV8461_CHECK(axes.addAxis(drivers[16]) == -1);
+
+  // A linear move of 16 axes: every step of every axis lands on the tick
+  // nearest its place on the line, and no axis steps as its DIR changes.
+  {
+    const uint32_t master = 4800;
+    int32_t target[16];
+    for (uint8_t i = 0; i < 16; i++)
+    {
+      target[i] = (int32_t)(master * (i + 1) / 16) * (i % 2 ? -1 : 1);
+    }
+    Record r;
+    hal.stepCallback = record;
+    hal.stepContext = &r;
+    DRV8461_CHECK(axes.moveLinear(target, 20000, 100000));
+    DRV8461_CHECK(!axes.moveLinear(target, 20000, 100000));
+    hal.run(axes);
+    DRV8461_CHECK(!axes.isRunning());
+    DRV8461_CHECK(r.masks.size() == master);
+    DRV8461_CHECK(hal.dirViolations == 0);
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+      DRV8461_CHECK(axes.getPosition(i) == target[i]);
+      DRV8461_CHECK(hal.position[i] == target[i]);
+
+      // Step k is due when the line crosses k - 1/2: at tick (k - 1/2) N / n,
+      // counting ticks from 1.  It may come up to one tick late.
+      uint32_t n = master * (i + 1) / 16, k = 0, worst = 0;
+      for (uint32_t m = 1; m <= master; m++)
+      {
+        if (!(r.masks[m - 1] & (1u << i))) { continue; }
+        k++;
+        int64_t late = 2 * (int64_t)m * n - (2 * (int64_t)k - 1) * master;
+        if (late < 0 || late >= 2 * (int64_t)n) { worst++; }
+      }
+      DRV8461_CHECK(k == n);
+      DRV8461_CHECK(worst == 0);
+    }
+    hal.stepCallback = nullptr;
+  }
+
+  // Back to the start: every DIR pin flips before the first step.
+  {
+    uint64_t before = hal.time;
+    int32_t target[16] = {};
+    DRV8461_CHECK(axes.moveLinear(target, 20000, 100000));
+    DRV8461_CHECK(hal.time == before);
+    hal.run(axes);
+    for (uint8_t i = 0; i < 16; i++) { DRV8461_CHECK(hal.position[i] == 0); }
+    DRV8461_CHECK(hal.dirViolations == 0);
+  }
+
+  // A full circle reverses each axis twice mid-move, between chords; the
+  // chord's DIR is set a step ahead and the circle closes exactly.
+  {
+    
+    axes.setDirSetup(4);
+    DRV8461_CHECK(axes.moveArc(0, 1, 0, 0, 400, 0, false, 8000, 40000, 16));
+    hal.run(axes);
+    DRV8461_CHECK(hal.dirViolations == 0);
+    DRV8461_CHECK(axes.getPosition(0) == 0 && axes.getPosition(1) == 0);
+    DRV8461_CHECK(hal.position[0] == 0 && hal.position[1] == 0);
+    for (uint8_t i = 2; i < 16; i++) { DRV8461_CHECK(hal.position[i] == 0); }
+  }
+
+  // Jobs run only while the next step is further away than their cost.
+  {
+    int32_t target[16] = {};
+    target[3] = 2000;
+    drivers[3].driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT] = 0x88;
+    DRV8461_CHECK(axes.moveLinear(target, 1000, 100000));
+    hal.run(axes, 20);
+    DRV8461_CHECK(axes.pollFault(3));
+    DRV8461_CHECK(axes.setCurrentPercent(3, 50));
+    axes.setJobCost(5000);
+    DRV8461_CHECK(axes.service() == 2);
+    DRV8461_CHECK(drivers[3].driver.bus.frames == 0);
+    axes.setJobCost(100);
+    DRV8461_CHECK(axes.service() == 0);
+    DRV8461_CHECK(axes.getFault(3) == 0x88);
+    hal.run(axes);
+    DRV8461_CHECK(hal.position[3] == 2000);
+  }
+
+  return DRV8461_testResult();
+}
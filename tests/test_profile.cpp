@@ -0,0 +1,119 @@
+/*  test_profile.cpp
+
+    Register profiles: saving, loading with the fewest writes, EN_OUT left
+    alone, rejection of damaged profiles, and profile files.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "DRV8461_Profile.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+
+static bool enabled(Driver & sd)
+{
+  return DRV8461Fields::EN_OUT::get(sd.driver.bus.regs);
+}
+
+int main()
+{
+  // A profile saved from an enabled driver does not store EN_OUT.
+  Driver a;
+  a.setStepMode(64);
+  a.setCurrentPercent(55);
+  a.setWavetable(DRV8461_harmonicWavetable(8, 0));
+  a.enableDriver();
+  a.applySettings();
+  DRV8461Profile profile;
+  DRV8461_saveProfile(a, profile);
+  DRV8461ProfileView view;
+  DRV8461_CHECK(view.attach(profile.data, sizeof(profile.data)));
+  DRV8461_CHECK(view.has((uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1));
+  DRV8461_CHECK(!(view.reg((uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1) & DRV8461Fields::EN_OUT::mask));
+
+  DRV8461Profile fromDevice;
+  DRV8461_saveProfile(a, fromDevice, true);
+  DRV8461_CHECK(!memcmp(profile.data, fromDevice.data, sizeof(profile.data)));
+
+  // Loading it onto a disabled driver applies the settings but leaves the
+  // outputs off.
+  {
+    Driver b;
+    b.applySettings();
+    DRV8461_CHECK(!enabled(b));
+    DRV8461_CHECK(DRV8461_loadProfile(b, profile));
+    DRV8461_CHECK(!enabled(b));
+    DRV8461_CHECK(!b.getField<DRV8461Fields::EN_OUT>());
+    DRV8461_CHECK(b.verifySettings());
+    DRV8461_CHECK(b.getWavetable().current[0] == a.getWavetable().current[0]);
+    for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+    {
+      uint8_t address = (uint8_t)Driver::settingsReg(i);
+      DRV8461_CHECK(((b.getCachedReg((DRV8461_REG_ADDR)address) ^ a.getCachedReg((DRV8461_REG_ADDR)address)) &
+        DRV8461_profileMask(address)) == 0);
+    }
+
+    // Loading it again writes nothing.
+    uint32_t writes = b.driver.bus.settingWrites;
+    DRV8461_CHECK(DRV8461_loadProfile(b, profile));
+    DRV8461_CHECK(b.driver.bus.settingWrites == writes);
+
+    // One changed setting costs one write.
+    b.setCurrentPercent(30);
+    writes = b.driver.bus.settingWrites;
+    DRV8461_CHECK(DRV8461_loadProfile(b, profile));
+    DRV8461_CHECK(b.driver.bus.settingWrites == writes + 1);
+  }
+
+  // A profile from a disabled driver does not switch off an enabled one.
+  {
+    Driver off;
+    off.setStepMode(8);
+    DRV8461Profile offProfile;
+    DRV8461_saveProfile(off, offProfile);
+    DRV8461_CHECK(DRV8461_loadProfile(a, offProfile));
+    DRV8461_CHECK(enabled(a));
+    DRV8461_CHECK(a.verifySettings());
+  }
+
+  // Damaged or truncated profiles are refused and change nothing.
+  {
+    Driver c;
+    c.applySettings();
+    uint32_t writes = c.driver.bus.settingWrites;
+    DRV8461Profile bad = profile;
+    bad.data[20] ^= 0x01;
+    DRV8461_CHECK(!DRV8461_loadProfile(c, bad));
+    DRV8461_CHECK(!DRV8461_loadProfile(c, profile.data, sizeof(profile.data) - 1));
+    DRV8461_CHECK(c.driver.bus.settingWrites == writes);
+  }
+
+  // A profile file, mapped and loaded in place.
+  {
+    char path[] = "/tmp/drv8461_profile_XXXXXX";
+    int fd = mkstemp(path);
+    DRV8461_CHECK(fd >= 0);
+    if (fd >= 0)
+    {
+      close(fd);
+      DRV8461_CHECK(DRV8461_writeProfileFile(path, profile));
+      DRV8461ProfileFileReader file;
+      DRV8461_CHECK(file.open(path));
+      Driver d;
+      d.applySettings();
+      DRV8461_CHECK(file.load(d));
+      const uint8_t ctrl2 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL2;
+      DRV8461_CHECK((d.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2) & DRV8461_profileMask(ctrl2)) == view.reg(ctrl2));
+      DRV8461_CHECK(d.verifySettings());
+      file.close();
+      unlink(path);
+    }
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,109 @@
+/*  test_restore.cpp
+
+    BasicDRV8434S::restoreSettings() against DRV8461SimBus after
+    DRV8461SimBus::corrupt() has changed random settings registers, and after
+    a power-on reset.
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+/// A DRV8461SimBus that remembers the address of the last register written.
+class RecordingBus : public DRV8461SimBus
+{
+public:
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    for (uint8_t i = 0; i < frameCount; i++)
+    {
+      if (!DRV8461_commandIsRead(frames[i * frameLength])) { lastWrite = DRV8461_commandAddress(frames[i * frameLength]); }
+    }
+    DRV8461SimBus::transfer(frames, frameLength, frameCount);
+  }
+
+  uint8_t lastWrite = 0xFF;
+};
+
+typedef BasicDRV8434S<RecordingBus> Driver;
+
+/// Returns the settings registers whose settings bits differ from the cache.
+static uint64_t mismatched(Driver & sd)
+{
+  uint64_t mask = 0;
+  for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+  {
+    uint8_t address = (uint8_t)Driver::settingsReg(i);
+    if ((sd.driver.bus.regs[address] ^ sd.getCachedReg((DRV8461_REG_ADDR)address)) &
+      DRV8461_regInfo(address).settingsMask())
+    {
+      mask |= (uint64_t)1 << address;
+    }
+  }
+  return mask;
+}
+
+static uint8_t bits(uint64_t mask)
+{
+  uint8_t n = 0;
+  for (; mask; mask &= mask - 1) { n++; }
+  return n;
+}
+
+int main()
+{
+  Driver sd;
+  RecordingBus & bus = sd.driver.bus;
+  sd.setStepMode(32);
+  sd.setCurrentPercent(70);
+  sd.enableDriver();
+  sd.applySettings();
+
+  // Nothing lost: one batch of reads, no writes.
+  {
+    uint32_t transactions = bus.transactions, writes = bus.settingWrites;
+    DRV8461RestoreReport report = sd.restoreSettings();
+    DRV8461_CHECK(report.count == 0 && report.drifted == 0);
+    DRV8461_CHECK(bus.transactions == transactions + 1);
+    DRV8461_CHECK(bus.settingWrites == writes);
+  }
+
+  // Random losses: exactly the registers that no longer match are
+  // rewritten, once each, in a second batch, with CTRL1 last.
+  uint32_t restored = 0;
+  for (uint32_t trial = 0; trial < 500; trial++)
+  {
+    bus.seed = trial + 1;
+    bus.corrupt(1 + trial % 6);
+    uint64_t lost = mismatched(sd);
+    uint32_t transactions = bus.transactions, writes = bus.settingWrites, frames = bus.frames;
+
+    DRV8461RestoreReport report = sd.restoreSettings();
+    DRV8461_CHECK(report.drifted == lost);
+    DRV8461_CHECK(report.count == bits(lost));
+    DRV8461_CHECK(bus.settingWrites - writes == report.count);
+    DRV8461_CHECK(bus.frames - frames == (uint32_t)(Driver::settingsRegCount + report.count));
+    DRV8461_CHECK(bus.transactions - transactions == (report.count ? 2u : 1u));
+    if (report.has(DRV8461_REG_ADDR::DRV8461_REG_CTRL1))
+    {
+      DRV8461_CHECK(bus.lastWrite == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    }
+    DRV8461_CHECK(mismatched(sd) == 0);
+    restored += report.count;
+  }
+  DRV8461_CHECK(restored > 500);
+  DRV8461_CHECK(sd.verifySettings());
+
+  // A brownout: every register that differs from its reset value comes back.
+  {
+    bus.powerOnReset();
+    uint64_t lost = mismatched(sd);
+    DRV8461_CHECK(lost & ((uint64_t)1 << (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1));
+    DRV8461RestoreReport report = sd.restoreSettings();
+    DRV8461_CHECK(report.drifted == lost);
+    DRV8461_CHECK(bus.lastWrite == (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL1);
+    DRV8461_CHECK(sd.verifySettings());
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,147 @@
+/*  test_silent_step.cpp
+
+    DRV8461SilentStepTuner sweeping DRV8461SimBus, whose motor keeps up with
+    a step rate that depends on SS_KP (see DRV8461SimBus::setStepRate()).
+
+*/
+
+#include <string.h>
+
+#include "DRV8461_SilentStep.h"
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+
+/// The emulated motor keeps up with 3000 steps/s plus 1000 for every 16 of
+/// SS_KP.
+static uint32_t maxStableRate(const uint8_t * regs)
+{
+  return 3000 + 1000 * DRV8461Fields::SS_KP::get(regs) / 16;
+}
+
+/// A stand-in for DRV8461StepEngine that runs each move in simulated
+/// milliseconds and tells the emulated device the step rate, so the sweep
+/// sees the load and stalls that rate causes.
+class SimEngine
+{
+public:
+  SimEngine(DRV8461SimBus & bus, const uint32_t & clock) : bus(bus), clock(clock)
+  {
+  }
+
+  bool plan(int32_t steps, uint32_t speed, uint32_t acceleration)
+  {
+    if (!speed || !acceleration) { return false; }
+    uint32_t count = steps < 0 ? -steps : steps;
+    uint32_t ramps = (uint64_t)speed * speed / acceleration;
+    duration = (uint32_t)((uint64_t)2000 * speed / acceleration +
+      (count > ramps ? (uint64_t)(count - ramps) * 1000 / speed : 0));
+    planned = steps;
+    rate = speed;
+    return true;
+  }
+
+  void start()
+  {
+    running = true;
+    end = clock + duration;
+    bus.setStepRate(rate);
+  }
+
+  void stop()
+  {
+    if (running) { finish(); }
+  }
+
+  bool isRunning()
+  {
+    if (running && (int32_t)(clock - end) >= 0)
+    {
+      travelled += planned;
+      finish();
+    }
+    return running;
+  }
+
+  int32_t travelled = 0;
+  uint32_t moves = 0;
+
+private:
+
+  void finish()
+  {
+    running = false;
+    moves++;
+    bus.setStepRate(0);
+  }
+
+  DRV8461SimBus & bus;
+  const uint32_t & clock;
+  int32_t planned = 0;
+  uint32_t rate = 0;
+  uint32_t duration = 0;
+  uint32_t end = 0;
+  bool running = false;
+};
+
+int main()
+{
+  static const uint32_t speeds[] = { 2000, 4000, 6000, 8000, 10000 };
+  const DRV8461SilentStepBands bands = { speeds, 5, 40000, 200, 600 };
+
+  Driver sd;
+  sd.driver.bus.maxStableRate = maxStableRate;
+  uint32_t now = 0;
+  SimEngine engine(sd.driver.bus, now);
+  DRV8461SilentStepTuner<Driver, SimEngine> tuner(sd, engine);
+
+  const DRV8461SilentStepSettings original = sd.getSilentStep();
+  DRV8461SilentStepResult table[] = {
+    { { true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_2US, 0, 8, 0, 0, 255 }, 0, 0 },
+    { { true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_2US, 32, 8, 0, 0, 255 }, 0, 0 },
+    { { true, DRV8461_SS_Sampling::DRV8461_SS_SMPL_4US, 64, 8, 1, 1, 255 }, 0, 0 },
+  };
+
+  DRV8461_CHECK(tuner.sweep(now, table, 3, bands));
+  DRV8461_CHECK(!tuner.sweep(now, table, 3, bands));
+  uint32_t ticks = 0;
+  while (tuner.tick(now) != DRV8461_SilentStep_State::DRV8461_SS_TUNE_DONE && ticks < 100000)
+  {
+    now += 2;
+    ticks++;
+  }
+  DRV8461_CHECK(tuner.getState() == DRV8461_SilentStep_State::DRV8461_SS_TUNE_DONE);
+
+  // Limits of 3000, 5000 and 7000 steps/s: the first row stalls at 4000, the
+  // others go over the load limit one band above their last stable one.
+  DRV8461_CHECK(table[0].maxStableSpeed == 2000);
+  DRV8461_CHECK(table[1].maxStableSpeed == 4000);
+  DRV8461_CHECK(table[2].maxStableSpeed == 6000);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    DRV8461_CHECK(table[i].peakLoad == sd.driver.bus.idleLoad);
+  }
+  DRV8461_CHECK(tuner.best(table, 3) == 2);
+
+  // Each failed band was stopped, the stall was cleared, the bands
+  // alternated direction, and the settings were put back.
+  DRV8461_CHECK(engine.moves == 1 + 2 + 3 + 3);
+  DRV8461_CHECK(engine.travelled >= 0 && engine.travelled <= 6000);
+  DRV8461_CHECK(!(sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2] &
+    (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL));
+  DRV8461_CHECK(!sd.getField<DRV8461Fields::EN_STL>());
+  DRV8461_CHECK(sd.getSilentStep().kp == original.kp && sd.getSilentStep().enabled == original.enabled);
+  DRV8461_CHECK(sd.verifySettings());
+
+  // The table is plain data: a saved copy reapplies the best row.
+  uint8_t saved[sizeof(table)];
+  memcpy(saved, table, sizeof(table));
+  DRV8461SilentStepResult loaded[3];
+  memcpy(loaded, saved, sizeof(saved));
+  sd.setSilentStep(loaded[DRV8461SilentStepTuner<Driver, SimEngine>::best(loaded, 3)].settings);
+  DRV8461_CHECK(DRV8461Fields::SS_KP::get(sd.driver.bus.regs) == 64);
+  DRV8461_CHECK(maxStableRate(sd.driver.bus.regs) == 7000);
+
+  return DRV8461_testResult();
+}
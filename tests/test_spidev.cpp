@@ -0,0 +1,85 @@
+/*  test_spidev.cpp
+
+    BasicDRV8461SpiDevBus against DRV8461SpiDevLoopback: how batches are packed
+    into spi_ioc_transfers and split into ioctls, and what a failed ioctl
+    returns.
+
+*/
+
+#include "DRV8461_SpiDev.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8461SpiDevBus<DRV8461SpiDevLoopback> LoopbackBus;
+typedef BasicDRV8434S<LoopbackBus> Driver;
+
+int main()
+{
+  // pack(): one transfer per frame, in place, chip select released after
+  // all but the last.
+  {
+    uint8_t frames[2 * 100];
+    struct spi_ioc_transfer xfers[LoopbackBus::maxTransfers];
+    uint8_t n = LoopbackBus::pack(xfers, frames, 2, 3, 1000000);
+    DRV8461_CHECK(n == 3);
+    for (uint8_t i = 0; i < n; i++)
+    {
+      DRV8461_CHECK(xfers[i].tx_buf == (unsigned long)(frames + 2 * i));
+      DRV8461_CHECK(xfers[i].rx_buf == xfers[i].tx_buf);
+      DRV8461_CHECK(xfers[i].len == 2 && xfers[i].speed_hz == 1000000 && xfers[i].bits_per_word == 8);
+      DRV8461_CHECK(xfers[i].cs_change == (i + 1 < n));
+    }
+
+    n = LoopbackBus::pack(xfers, frames, 2, 100, 1000000);
+    DRV8461_CHECK(n == LoopbackBus::maxTransfers);
+    DRV8461_CHECK(!xfers[n - 1].cs_change && xfers[n - 2].cs_change);
+
+    DRV8461_CHECK(LoopbackBus::pack(xfers, frames, 2, 1, 1000000) == 1 && !xfers[0].cs_change);
+  }
+
+  Driver sd;
+  DRV8461SpiDevLoopback & io = sd.driver.bus.io;
+
+  // A batch is one ioctl, and each frame reaches the device on its own.
+  sd.setStepMode(32);
+  sd.setCurrentPercent(70);
+  sd.enableDriver();
+  uint32_t messages = io.messages, frames = io.device.frames, transactions = io.device.transactions;
+  sd.applySettings();
+  DRV8461_CHECK(io.messages == messages + 1);
+  DRV8461_CHECK(io.device.frames == frames + Driver::settingsRegCount);
+  DRV8461_CHECK(io.device.transactions == transactions + Driver::settingsRegCount);
+  DRV8461_CHECK(sd.verifySettings());
+  DRV8461_CHECK(io.messages == messages + 2);
+  DRV8461_CHECK(sd.driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1) == sd.getCachedReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL1));
+  DRV8461_CHECK(sd.driver.lastStatus == io.device.statusByte());
+
+  // Longer batches are split at maxTransfers frames.
+  {
+    DRV8461RegOp ops[150];
+    DRV8461RegResult results[150];
+    for (uint8_t i = 0; i < 150; i++) { ops[i] = DRV8461RegOp::read((DRV8461_REG_ADDR)(i % 0x20)); }
+    messages = io.messages;
+    sd.driver.transferBatch(ops, 150, results);
+    DRV8461_CHECK(io.messages == messages + 3);
+    bool match = true;
+    for (uint8_t i = 0; i < 150; i++)
+    {
+      match = match && results[i].status == io.device.statusByte() && results[i].data == io.device.regs[i % 0x20];
+    }
+    DRV8461_CHECK(match);
+  }
+
+  // A failed ioctl returns status 0x00, never a transmitted byte.
+  io.fail = true;
+  uint8_t ctrl2 = sd.driver.readReg(DRV8461_REG_ADDR::DRV8461_REG_CTRL2);
+  DRV8461_CHECK(ctrl2 == 0);
+  DRV8461_CHECK(sd.driver.lastStatus == 0);
+  DRV8461_CHECK(sd.driver.bus.errorCount == 1);
+  io.fail = true;
+  DRV8461_CHECK(!sd.verifySettings());
+  DRV8461_CHECK(sd.driver.bus.errorCount == 2);
+  DRV8461_CHECK(sd.verifySettings());
+  DRV8461_CHECK(sd.driver.bus.errorCount == 2);
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,214 @@
+/*  test_stall.cpp
+
+    DRV8461StallHoming against DRV8461SimBus, with the motor stepped by a
+    DRV8461StepEngine on a simulated timer: learning, homing into a hard stop,
+    and what happens to faults that are not stalls.
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Stall.h"
+#include "DRV8461_StepEngine.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+typedef DRV8461StepEngine<DRV8461SimStepHal> Engine;
+typedef DRV8461StallHoming<Driver, Engine> Homing;
+
+static const uint8_t FAULT = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_FAULT;
+static const uint8_t DIAG2 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2;
+static const uint8_t OCP = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_OCP;
+static const uint8_t SUMMARY = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_FAULT;
+
+/// Runs the engine for up to `steps` steps between ticks until the sequence
+/// ends, or for at most `ticks` ticks.
+static DRV8461_Stall_State runSequence(Homing & homing, DRV8461SimStepHal & hal, Engine & engine,
+  uint32_t steps = 20, uint32_t ticks = 100000)
+{
+  DRV8461_Stall_State state = homing.getState();
+  for (uint32_t i = 0; i < ticks; i++)
+  {
+    hal.run(engine, steps);
+    if (!engine.isRunning()) { hal.now += 1000; }
+    state = homing.tick((uint32_t)hal.now);
+    if (state >= DRV8461_Stall_State::DRV8461_STALL_DONE) { break; }
+  }
+  return state;
+}
+
+static bool stallDetection(Driver & sd, bool enabled, bool reported)
+{
+  uint8_t ctrl4 = sd.driver.bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CTRL4];
+  return DRV8461Fields::EN_STL::extract(ctrl4) == enabled && DRV8461Fields::STL_REP::extract(ctrl4) == reported &&
+    sd.getField<DRV8461Fields::EN_STL>() == enabled && sd.getField<DRV8461Fields::STL_REP>() == reported;
+}
+
+int main()
+{
+  // Learning: the threshold reaches the cache once STL_LRN_OK is set.
+  {
+    Driver sd;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &sd.driver.bus;
+    Homing homing(sd, engine);
+    sd.driver.bus.learnedStallThreshold = 0x2B7;
+
+    DRV8461_CHECK(homing.learn(0, 2000, 10000, 100000, 50000, 200000));
+    DRV8461_CHECK(!homing.learn(0, 2000, 10000, 100000, 50000, 200000));
+    DRV8461_CHECK(runSequence(homing, hal, engine) == DRV8461_Stall_State::DRV8461_STALL_DONE);
+    DRV8461_CHECK(!engine.isRunning());
+    DRV8461_CHECK(hal.now >= 50000);
+    DRV8461_CHECK(sd.getStallThreshold() == 0x2B7);
+  }
+
+  // Learning that never reports STL_LRN_OK times out.
+  {
+    Driver sd;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &sd.driver.bus;
+    Homing homing(sd, engine);
+    uint16_t threshold = sd.getStallThreshold();
+
+    DRV8461_CHECK(homing.learn(0, 2000, 10000, 1000000, 50000, 200000));
+    DRV8461_Stall_State state = homing.getState();
+    for (uint32_t i = 0; i < 100000 && state < DRV8461_Stall_State::DRV8461_STALL_DONE; i++)
+    {
+      hal.run(engine, 20);
+      sd.driver.bus.regs[DIAG2] = 0;
+      state = homing.tick((uint32_t)hal.now);
+    }
+    DRV8461_CHECK(state == DRV8461_Stall_State::DRV8461_STALL_FAILED);
+    DRV8461_CHECK(!engine.isRunning());
+    DRV8461_CHECK(hal.now > 250000 && hal.now <= 261000);
+    DRV8461_CHECK(sd.getStallThreshold() == threshold);
+  }
+
+  // Homing forward into a stop, twice, with stall detection off and STL_REP
+  // clear beforehand: the stall is seen within one tick of steps, the motor
+  // backs off, the position is zeroed and EN_STL/STL_REP are put back.
+  {
+    Driver sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &bus;
+    Homing homing(sd, engine);
+    sd.setField<DRV8461Fields::STL_REP>(false);
+    bus.stallForward = 3000;
+    engine.setPosition(-5000);
+    bus.position = -5000;
+
+    for (uint8_t run = 0; run < 2; run++)
+    {
+      DRV8461_CHECK(homing.home((uint32_t)hal.now, true, 4000, 20000, 100000, 200));
+      DRV8461_CHECK(stallDetection(sd, true, true));
+      DRV8461_CHECK(runSequence(homing, hal, engine) == DRV8461_Stall_State::DRV8461_STALL_DONE);
+      int32_t stall = homing.getStats().lastStallPosition;
+      int32_t expected = run == 0 ? 3000 : 200;
+      DRV8461_CHECK(stall > expected && stall <= expected + 20);
+      DRV8461_CHECK(engine.getPosition() == 0);
+      DRV8461_CHECK(bus.position == 3000 - 200);
+      DRV8461_CHECK(bus.regs[FAULT] == 0);
+      DRV8461_CHECK(stallDetection(sd, false, false));
+    }
+    DRV8461_CHECK(homing.getStats().runs == 2);
+    DRV8461_CHECK(homing.getStats().minDeviation == homing.getStats().lastStallPosition - 200);
+  }
+
+  // Homing in reverse with no backoff and detection already on: the stall
+  // position is home, and detection stays as it was.
+  {
+    Driver sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &bus;
+    Homing homing(sd, engine);
+    sd.enableStallDetection(false);
+    bus.stallReverse = -1000;
+    uint32_t writes = bus.settingWrites;
+
+    DRV8461_CHECK(homing.home(0, false, 4000, 20000, 100000, 0));
+    DRV8461_CHECK(runSequence(homing, hal, engine) == DRV8461_Stall_State::DRV8461_STALL_DONE);
+    DRV8461_CHECK(homing.getStats().lastStallPosition < -1000);
+    DRV8461_CHECK(engine.getPosition() == 0 && !engine.isRunning());
+    DRV8461_CHECK(bus.position == -1000);
+    DRV8461_CHECK(stallDetection(sd, true, false));
+    DRV8461_CHECK(bus.settingWrites == writes + 1);   // CLR_FLT only
+  }
+
+  // No stall within maxTravel: homing fails when the move ends.
+  {
+    Driver sd;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &sd.driver.bus;
+    Homing homing(sd, engine);
+
+    DRV8461_CHECK(homing.home(0, true, 4000, 20000, 2000, 100));
+    DRV8461_CHECK(runSequence(homing, hal, engine) == DRV8461_Stall_State::DRV8461_STALL_FAILED);
+    DRV8461_CHECK(engine.getPosition() == 2000);
+    DRV8461_CHECK(stallDetection(sd, false, true));
+    DRV8461_CHECK(homing.getStats().runs == 0);
+  }
+
+  // A fault other than a stall stops the motor and is left latched, whether
+  // it comes alone or with a stall, and whether it shows in the status byte
+  // or only after an nFAULT edge and a FAULT read (SPI_ERR).  Homing then
+  // refuses to start again until it is cleared.
+  const uint8_t SPI_ERR = (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_SPI_ERR;
+  for (uint8_t variant = 0; variant < 4; variant++)
+  {
+    Driver sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &bus;
+    Homing homing(sd, engine);
+    bus.stallForward = 500;
+
+    DRV8461_CHECK(homing.home(0, true, 4000, 20000, 100000, 200));
+    hal.run(engine, 100);
+    DRV8461_CHECK(homing.tick((uint32_t)hal.now) == DRV8461_Stall_State::DRV8461_STALL_SEEKING);
+    bool stall = variant >= 2;
+    if (stall) { hal.run(engine, 1000); }
+    bus.regs[FAULT] |= variant & 1 ? SPI_ERR : SUMMARY | OCP;
+    if (variant == 1) { homing.onFaultEdge(); }
+    DRV8461_CHECK(bus.regs[DIAG2] == (stall ? (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL : 0));
+
+    uint8_t fault = bus.regs[FAULT];
+    DRV8461_CHECK(homing.tick((uint32_t)hal.now) == DRV8461_Stall_State::DRV8461_STALL_FAILED);
+    DRV8461_CHECK(!engine.isRunning());
+    DRV8461_CHECK(bus.regs[FAULT] == fault);
+    DRV8461_CHECK(stallDetection(sd, false, true));
+
+    // Still latched: the next attempt refuses to start and clears nothing.
+    DRV8461_CHECK(!homing.home((uint32_t)hal.now, true, 4000, 20000, 100000, 200));
+    DRV8461_CHECK(homing.getState() == DRV8461_Stall_State::DRV8461_STALL_FAILED);
+    DRV8461_CHECK(!engine.isRunning());
+    DRV8461_CHECK(bus.regs[FAULT] == fault);
+    DRV8461_CHECK(stallDetection(sd, false, true));
+  }
+
+  // A stall left latched from before is cleared when homing starts.
+  {
+    Driver sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    DRV8461SimStepHal hal;
+    Engine engine(hal, 1000000);
+    hal.motor = &bus;
+    Homing homing(sd, engine);
+    bus.stallForward = 500;
+    bus.regs[FAULT] = SUMMARY | (uint8_t)DRV8461_FAULT_Reg_Val::DRV8461_FAULT_STL;
+    bus.regs[DIAG2] = (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STALL;
+
+    DRV8461_CHECK(homing.home(0, true, 4000, 20000, 100000, 100));
+    DRV8461_CHECK(bus.regs[FAULT] == 0 && bus.regs[DIAG2] == 0);
+    DRV8461_CHECK(runSequence(homing, hal, engine) == DRV8461_Stall_State::DRV8461_STALL_DONE);
+    DRV8461_CHECK(homing.getStats().lastStallPosition > 500);
+  }
+
+  return DRV8461_testResult();
+}
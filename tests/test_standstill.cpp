@@ -0,0 +1,109 @@
+/*  test_standstill.cpp
+
+    DRV8461StandstillManager against DRV8461SimBus, with DIAG2 STSL set while
+    the emulated driver rests with standstill power saving enabled: the
+    entries, time and energy it counts, how often it reads DIAG2, and
+    wake().
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Standstill.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+typedef DRV8461StandstillManager<Driver> Manager;
+
+static const uint8_t DIAG2 = (uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2;
+static const uint8_t STSL = (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_STSL;
+
+/// Returns true if the emulated driver has EN_STSL set.
+static bool enabled(DRV8461SimBus & bus)
+{
+  return DRV8461Fields::EN_STSL::get(bus.regs);
+}
+
+/// Advances time to `end` one millisecond at a time, calling tick() and
+/// setting STSL as the driver would: while resting with EN_STSL set.
+static void runUntil(Manager & standstill, DRV8461SimBus & bus, uint32_t & now, uint32_t end, bool resting)
+{
+  while (now < end)
+  {
+    now++;
+    bus.regs[DIAG2] = resting && enabled(bus) ? STSL : 0;
+    standstill.tick(now);
+  }
+}
+
+int main()
+{
+  Driver sd;
+  DRV8461SimBus & bus = sd.driver.bus;
+  sd.setCurrentMilliamps(1500, 2000);
+  Manager standstill(sd, 2000, 1500);   // 2 A full scale, 1.5 ohm
+
+  // One batch with the timing, current and EN_STSL.
+  uint32_t transactions = bus.transactions;
+  standstill.configure(200, 4, 500);
+  DRV8461_CHECK(bus.transactions == transactions + 1);
+  DRV8461_CHECK(enabled(bus));
+  DRV8461_CHECK(sd.getField<DRV8461Fields::ISTSL>() == (DRV8461_Holding_Current)DRV8461_currentToDac(500, 2000));
+
+  // Moving, then resting for 2 s: DIAG2 is read every 100 ms, one frame
+  // each, and one entry is counted.  At 1.5 A run and 0.5 A hold in
+  // 1.5 ohm the coils dissipate 3 W less, so 6 J are saved.
+  uint32_t now = 0;
+  uint32_t frames = bus.frames;
+  runUntil(standstill, bus, now, 1000, false);
+  DRV8461_CHECK(bus.frames == frames + 10);
+  DRV8461_CHECK(!standstill.isInStandstill());
+  runUntil(standstill, bus, now, 3000, true);
+  DRV8461_CHECK(standstill.isInStandstill());
+  DRV8461_CHECK(standstill.getEntries() == 1);
+  runUntil(standstill, bus, now, 3500, false);
+  DRV8461_CHECK(!standstill.isInStandstill());
+  DRV8461_CHECK(bus.frames == frames + 35);
+  DRV8461_CHECK(standstill.getEntries() == 1);
+  DRV8461_CHECK(standstill.getStandstillTime() == 2000);
+  DRV8461_CHECK(standstill.getEnergySaved() == 6000);
+
+  // Resting again (seen from the poll at 3600), then woken ahead of a move
+  // at 4000: EN_STSL goes off at once, nothing is read while waking, and
+  // EN_STSL is back on after wakeTime.
+  runUntil(standstill, bus, now, 4000, true);
+  DRV8461_CHECK(standstill.getEntries() == 2);
+  uint32_t writes = bus.settingWrites;
+  frames = bus.frames;
+  standstill.wake(now);
+  DRV8461_CHECK(!enabled(bus));
+  DRV8461_CHECK(bus.settingWrites == writes + 1);
+  DRV8461_CHECK(!standstill.isInStandstill());
+  DRV8461_CHECK(standstill.getStandstillTime() == 2400);
+  DRV8461_CHECK(standstill.getEnergySaved() == 7200);
+
+  standstill.wake(now + 10);
+  DRV8461_CHECK(bus.settingWrites == writes + 1);
+  runUntil(standstill, bus, now, 4000 + 10 + standstill.wakeTime - 1, true);
+  DRV8461_CHECK(!enabled(bus));
+  DRV8461_CHECK(bus.frames == frames + 1);
+  runUntil(standstill, bus, now, 4000 + 10 + standstill.wakeTime, true);
+  DRV8461_CHECK(enabled(bus));
+  DRV8461_CHECK(bus.settingWrites == writes + 2);
+
+  // A DIAG2 value the application read itself is taken too: here it ends
+  // the rest seen by the poll at 4110.
+  runUntil(standstill, bus, now, 4200, true);
+  standstill.observe(now, 0);
+  DRV8461_CHECK(standstill.getEntries() == 3);
+  DRV8461_CHECK(!standstill.isInStandstill());
+
+  // Once disabled, nothing more is read.
+  standstill.disable();
+  DRV8461_CHECK(!enabled(bus));
+  frames = bus.frames;
+  runUntil(standstill, bus, now, 5000, true);
+  DRV8461_CHECK(bus.frames == frames);
+  DRV8461_CHECK(standstill.getEntries() == 3);
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,80 @@
+/*  test_status.cpp
+
+    DRV8434S::readStatus() and the single-register status reads against
+    DRV8461SimBus, including the registers above 0x1F (CTRL14, ATQ_CTRL2)
+    that a 5-bit address would alias onto lower ones.
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434S<DRV8461SimBus> Driver;
+
+static uint8_t & reg(Driver & sd, DRV8461_REG_ADDR address)
+{
+  return sd.driver.bus.regs[(uint8_t)address];
+}
+
+int main()
+{
+  // Every address survives the frame encoding.
+  for (uint8_t address = 0; address < 64; address++)
+  {
+    DRV8461_CHECK(DRV8461_commandAddress(DRV8461_readCommand(address)) == address);
+    DRV8461_CHECK(DRV8461_commandAddress(DRV8461_writeCommand(address)) == address);
+    DRV8461_CHECK(DRV8461_commandIsRead(DRV8461_readCommand(address)));
+    DRV8461_CHECK(!DRV8461_commandIsRead(DRV8461_writeCommand(address)));
+  }
+
+  // Each register reads back its own contents, not those of an alias.
+  {
+    Driver sd;
+    for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+    {
+      sd.driver.bus.regs[address] = address ^ 0xA5;
+    }
+    for (uint8_t address = 0; address < DRV8461_REG_ADDR_COUNT; address++)
+    {
+      DRV8461_CHECK(sd.driver.readReg((DRV8461_REG_ADDR)address) == (address ^ 0xA5));
+    }
+  }
+
+  // The snapshot decodes every field from its own register.
+  {
+    Driver sd;
+    reg(sd, DRV8461_REG_ADDR::DRV8461_REG_FAULT) = 0x81;
+    reg(sd, DRV8461_REG_ADDR::DRV8461_REG_DIAG1) = 0x02;
+    reg(sd, DRV8461_REG_ADDR::DRV8461_REG_DIAG2) = 0x40;
+    reg(sd, DRV8461_REG_ADDR::DRV8461_REG_DIAG3) = 0x10;
+    DRV8461Fields::TRQ_COUNT::set(sd.driver.bus.regs, 0xABC);
+    DRV8461Fields::VM_ADC::set(sd.driver.bus.regs, 0x17);
+    DRV8461Fields::ATQ_CNT::set(sd.driver.bus.regs, 0x5A3);
+
+    DRV8461DriverStatus status;
+    sd.readStatus(status, 1234);
+    DRV8461_CHECK(sd.driver.bus.transactions == 1);
+    DRV8461_CHECK(status.time == 1234);
+    DRV8461_CHECK(status.sampled == DRV8461_STATUS_ALL);
+    DRV8461_CHECK(status.fault == 0x81 && status.faulted());
+    DRV8461_CHECK(status.diag1 == 0x02 && status.overcurrent());
+    DRV8461_CHECK(status.diag2 == 0x40);
+    DRV8461_CHECK(status.diag3 == 0x10);
+    DRV8461_CHECK(status.torqueCount() == 0xABC);
+    DRV8461_CHECK(status.supplyVoltageADC() == 0x17);
+    DRV8461_CHECK(status.atqCount() == 0x5A3);
+
+    DRV8461_CHECK(sd.readSupplyVoltageADC() == 0x17);
+    DRV8461_CHECK(sd.readDiag3() == 0x10);
+    DRV8461_CHECK(sd.readLoadTorque() == 0x5A3);
+
+    // Registers left out of the selection read as 0.
+    sd.readStatus(status, 5, DRV8461_STATUS_VM_ADC | DRV8461_STATUS_ATQ_CNT);
+    DRV8461_CHECK(status.sampled == (DRV8461_STATUS_VM_ADC | DRV8461_STATUS_ATQ_CNT));
+    DRV8461_CHECK(status.fault == 0 && status.ctrl7 == 0);
+    DRV8461_CHECK(status.supplyVoltageADC() == 0x17);
+    DRV8461_CHECK(status.atqCount() == 0x5A3);
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,138 @@
+/*  test_step_engine.cpp
+
+    DRV8461StepEngine on a simulated timer (DRV8461SimStepHal).
+
+*/
+
+#include <math.h>
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_StepEngine.h"
+#include "DRV8461_Test.h"
+
+typedef DRV8461StepEngine<DRV8461SimStepHal> Engine;
+
+struct Steps
+{
+  static const uint32_t capacity = 200000;
+  uint64_t times[capacity];
+  uint32_t count;
+};
+
+static Steps steps;
+
+static void record(void *, uint64_t time)
+{
+  if (steps.count < Steps::capacity) { steps.times[steps.count] = time; }
+  steps.count++;
+}
+
+static void runMove(DRV8461SimStepHal & hal, Engine & engine)
+{
+  steps.count = 0;
+  hal.stepCallback = record;
+  engine.start();
+  hal.run(engine);
+}
+
+int main()
+{
+  DRV8461SimStepHal hal;
+
+  // Intervals that do not fit in Q24.8 are refused instead of wrapping.
+  {
+    Engine engine(hal, 72000000);
+    DRV8461_CHECK(!engine.plan(100, 20, 10));
+    DRV8461_CHECK(!engine.plan(100, 1, 100000));
+    engine.start();
+    DRV8461_CHECK(!engine.isRunning());
+    DRV8461_CHECK(engine.plan(100, 2000, 1000));
+  }
+
+  // A long ramp: the first intervals are exact, not averaged over an entry.
+  {
+    const uint32_t timerHz = 72000000;
+    Engine engine(hal, timerHz);
+    DRV8461_CHECK(engine.plan(100000, 2000, 100));
+    runMove(hal, engine);
+    DRV8461_CHECK(steps.count == 100000);
+    for (uint32_t i = 0; i < 10; i++)
+    {
+      double exact = timerHz * sqrt(2.0 / 100) * (sqrt(i + 1.0) - sqrt((double)i));
+      DRV8461_CHECK(fabs((double)(steps.times[i + 1] - steps.times[i]) - exact) < exact * 1e-4 + 2);
+    }
+  }
+
+  // Every interval of a trapezoid stays close to the exact one, the move
+  // takes the exact time, and deceleration mirrors acceleration.
+  {
+    const uint32_t timerHz = 10000000, count = 120000, speed = 40000, accel = 20000;
+    Engine engine(hal, timerHz);
+    DRV8461_CHECK(engine.plan(count, speed, accel));
+    runMove(hal, engine);
+    DRV8461_CHECK(steps.count == count);
+
+    const uint32_t ramp = speed * speed / accel / 2;
+    double worst = 0, total = 0;
+    for (uint32_t gap = 0; gap + 1 < count; gap++)
+    {
+      uint32_t i = gap < ramp ? gap : gap >= count - 1 - ramp ? count - 2 - gap : UINT32_MAX;
+      double exact = i == UINT32_MAX ? (double)timerHz / speed :
+        timerHz * sqrt(2.0 / accel) * (sqrt(i + 1.0) - sqrt((double)i));
+      double actual = (double)(steps.times[gap + 1] - steps.times[gap]);
+      if (fabs(actual - exact) / exact > worst) { worst = fabs(actual - exact) / exact; }
+      total += exact;
+    }
+    DRV8461_CHECK(worst < 0.03);
+    DRV8461_CHECK(fabs((double)(steps.times[count - 1] - steps.times[0]) - total) < total * 0.002);
+    for (uint32_t gap = 0; gap < ramp; gap++)
+    {
+      uint64_t up = steps.times[gap + 1] - steps.times[gap];
+      uint64_t down = steps.times[count - 1 - gap] - steps.times[count - 2 - gap];
+      DRV8461_CHECK(up + 1 >= down && down + 1 >= up);
+    }
+  }
+
+  // Short moves, S-curves, dual-edge stepping and the phase reported.
+  {
+    Engine engine(hal, 1000000);
+    DRV8461_CHECK(engine.plan(7, 20000, 50000));
+    runMove(hal, engine);
+    DRV8461_CHECK(steps.count == 7);
+    DRV8461_CHECK(engine.getPosition() == 7);
+
+    hal.dualEdge = true;
+    engine.setDualEdge(true);
+    DRV8461_CHECK(engine.plan(-5000, 8000, 20000, DRV8461_Step_Profile::DRV8461_PROFILE_SCURVE, 200000));
+    steps.count = 0;
+    engine.start();
+    DRV8461_CHECK(engine.getPhase() == DRV8461_Motion_Phase::DRV8461_PHASE_ACCEL);
+    bool cruised = false;
+    while (hal.run(engine, 1))
+    {
+      if (engine.getPhase() == DRV8461_Motion_Phase::DRV8461_PHASE_CRUISE) { cruised = true; }
+    }
+    DRV8461_CHECK(cruised);
+    DRV8461_CHECK(steps.count == 5000);
+    DRV8461_CHECK(engine.getPosition() == 7 - 5000);
+    DRV8461_CHECK(!hal.dir);
+    DRV8461_CHECK(engine.getPhase() == DRV8461_Motion_Phase::DRV8461_PHASE_IDLE);
+    hal.dualEdge = false;
+  }
+
+  // Stepping through SPI moves the emulated motor instead of the pins.
+  {
+    BasicDRV8434S<DRV8461SimBus> sd;
+    sd.enableSPIStep();
+    sd.enableSPIDirection();
+    Engine engine(hal, 1000000);
+    engine.setSPIStepping(sd);
+    uint32_t pinSteps = hal.steps;
+    DRV8461_CHECK(engine.plan(-300, 5000, 20000));
+    runMove(hal, engine);
+    DRV8461_CHECK(sd.driver.bus.position == -300);
+    DRV8461_CHECK(hal.steps == pinSteps);
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,141 @@
+/*  test_telemetry.cpp
+
+    DRV8461TelemetryRecorder sampling DRV8461SimBus at 10 kHz from a
+    real-time thread while the main thread drains the ring into a file, and
+    the file read back through DRV8461TelemetryFileReader.
+
+*/
+
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+#include "DRV8461_Benchmark.h"
+#include "DRV8461_Telemetry.h"
+#include "DRV8461_TelemetryFile.h"
+#include "DRV8461_Test.h"
+
+typedef BasicDRV8434SSPI<DRV8461SimBus> Driver;
+typedef DRV8461TelemetryRecorder<Driver, 1024> Recorder;
+
+static const uint32_t rateHz = 10000;
+static const uint32_t sampleCount = 5000;
+static const uint8_t channelCount = 4;
+
+/// Sets the emulated registers to what they hold at sample k: a slowly
+/// drifting supply, a load count that changes every few samples, and an
+/// occasional overtemperature warning.
+static void stage(DRV8461SimBus & bus, uint32_t k)
+{
+  DRV8461Fields::VM_ADC::set(bus.regs, (k / 500) % 32);
+  DRV8461Fields::ATQ_CNT::set(bus.regs, (k / 3) % 2048);
+  bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_DIAG2] =
+    (k / 1000) % 2 ? (uint8_t)DRV8461_DIAG2_Reg_Val::DRV8461_DIAG2_OTW : 0;
+}
+
+static uint64_t threadCpuTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main()
+{
+  char path[] = "/tmp/drv8461_telemetry_XXXXXX";
+  int fd = mkstemp(path);
+  DRV8461_CHECK(fd >= 0);
+  if (fd < 0) { return DRV8461_testResult(); }
+  close(fd);
+
+  Driver driver;
+  Recorder recorder(driver);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_FAULT);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_DIAG2);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_CTRL14);
+  recorder.addChannel(DRV8461_REG_ADDR::DRV8461_REG_ATQ_CTRL1);
+  DRV8461_CHECK(recorder.channelCount() == channelCount);
+
+  // The sampler wakes on an absolute 100 us schedule, like a timer
+  // interrupt, and owns the emulated device.
+  uint64_t samplerCpu = 0, samplerWall = 0;
+  uint32_t late = 0;
+  std::atomic<bool> done{false};
+  std::thread sampler([&] {
+    uint64_t cpuStart = threadCpuTime();
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t start = DRV8461Benchmark::now();
+    for (uint32_t k = 0; k < sampleCount; k++)
+    {
+      next.tv_nsec += 1000000000 / rateHz;
+      if (next.tv_nsec >= 1000000000) { next.tv_nsec -= 1000000000; next.tv_sec++; }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+
+      stage(driver.bus, k);
+      if (!recorder.sample(k)) { late++; }
+    }
+    samplerWall = DRV8461Benchmark::now() - start;
+    samplerCpu = threadCpuTime() - cpuStart;
+    done = true;
+  });
+
+  DRV8461TelemetryFileSink file;
+  DRV8461_CHECK(file.open(path));
+  DRV8461TelemetryEncoder<DRV8461TelemetryFileSink> encoder(file);
+  encoder.begin(recorder);
+  uint32_t drained = 0;
+  DRV8461TelemetrySample s;
+  while (!done.load() || recorder.pending())
+  {
+    if (recorder.pop(s))
+    {
+      encoder.add(s);
+      drained++;
+    }
+    else
+    {
+      usleep(1000);
+    }
+  }
+  sampler.join();
+  encoder.finish();
+  DRV8461_CHECK(file.close());
+
+  // Every sample was taken, on schedule, for a small share of one CPU.
+  double rate = (double)sampleCount * 1e9 / samplerWall;
+  double cpuShare = (double)samplerCpu / samplerWall;
+  fprintf(stderr, "sampled %u at %.0f Hz, sampler CPU %.1f%%, %u dropped\n",
+    sampleCount, rate, cpuShare * 100, late);
+  DRV8461_CHECK(late == 0 && recorder.dropped == 0);
+  DRV8461_CHECK(drained == sampleCount);
+  DRV8461_CHECK(rate >= rateHz * 0.95);
+  DRV8461_CHECK(cpuShare < 0.25);
+
+  // The file maps back to the same samples.
+  DRV8461TelemetryFileReader reader;
+  DRV8461_CHECK(reader.open(path));
+  DRV8461_CHECK(reader.decoder.channelCount() == channelCount);
+  DRV8461_CHECK(reader.decoder.channelAddress(2) == DRV8461_REG_ADDR::DRV8461_REG_CTRL14);
+  DRV8461_CHECK(reader.decoder.channelVolatileMask(0) != 0);
+  DRV8461SimBus expected;
+  const DRV8461TelemetrySample * sample;
+  uint32_t read = 0, wrong = 0;
+  while (reader.decoder.next(sample))
+  {
+    stage(expected, read);
+    if (sample->time != read) { wrong++; }
+    for (uint8_t i = 0; i < channelCount; i++)
+    {
+      if (sample->values[i] != expected.regs[(uint8_t)reader.decoder.channelAddress(i)]) { wrong++; }
+    }
+    read++;
+  }
+  DRV8461_CHECK(read == sampleCount);
+  DRV8461_CHECK(wrong == 0);
+  reader.close();
+  unlink(path);
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,184 @@
+/*  test_verifier.cpp
+
+    DRV8461SettingsVerifier against DRV8461SimBus after
+    DRV8461SimBus::corrupt() has changed random settings registers: how soon
+    a loss is reported, which registers it reads, and what it does while a
+    transaction is open.
+
+*/
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+#include "DRV8461_Verifier.h"
+
+/// A DRV8461SimBus that counts the reads of each register.
+class CountingBus : public DRV8461SimBus
+{
+public:
+  void transfer(uint8_t * frames, uint8_t frameLength, uint8_t frameCount)
+  {
+    for (uint8_t i = 0; i < frameCount; i++)
+    {
+      if (DRV8461_commandIsRead(frames[i * frameLength])) { readsAt[DRV8461_commandAddress(frames[i * frameLength])]++; }
+    }
+    DRV8461SimBus::transfer(frames, frameLength, frameCount);
+  }
+
+  uint32_t readsAt[DRV8461_REG_ADDR_COUNT] = {};
+};
+
+typedef BasicDRV8434S<CountingBus> Driver;
+typedef DRV8461SettingsVerifier<Driver> Verifier;
+
+static uint32_t now = 0;
+static uint32_t ticks() { return now; }
+
+/// Returns the settings registers whose settings bits differ from the cache.
+static uint64_t mismatched(Driver & sd)
+{
+  uint64_t mask = 0;
+  for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+  {
+    uint8_t address = (uint8_t)Driver::settingsReg(i);
+    if ((sd.driver.bus.regs[address] ^ sd.getCachedReg((DRV8461_REG_ADDR)address)) &
+      DRV8461_regInfo(address).settingsMask())
+    {
+      mask |= (uint64_t)1 << address;
+    }
+  }
+  return mask;
+}
+
+int main()
+{
+  const uint8_t ctrl2 = (uint8_t)DRV8461Fields::MICROSTEP_MODE::address;
+  const uint8_t ctrl11 = (uint8_t)DRV8461Fields::TRQ_DAC::address;
+
+  // Registers confirmed by the old data of writes are skipped in the next
+  // round, which reads each of the remaining settings registers.
+  {
+    Driver sd;
+    CountingBus & bus = sd.driver.bus;
+    sd.applySettings();
+    Verifier verifier(sd, ticks, 2);
+    verifier.attach();
+
+    sd.setStepMode(32);
+    sd.setCurrentPercent(40);
+    DRV8461_CHECK(verifier.getConfirmations() == 2);
+    for (uint8_t a = 0; a < DRV8461_REG_ADDR_COUNT; a++) { bus.readsAt[a] = 0; }
+    for (uint8_t t = 0; t < (Driver::settingsRegCount - 2 + 1) / 2; t++) { DRV8461_CHECK(verifier.tick()); }
+    DRV8461_CHECK(verifier.getReads() == (Driver::settingsRegCount - 2 + 1) / 2 * 2);
+    bool others = true;
+    for (uint8_t i = 0; i < Driver::settingsRegCount; i++)
+    {
+      uint8_t address = (uint8_t)Driver::settingsReg(i);
+      if (address != ctrl2 && address != ctrl11) { others = others && bus.readsAt[address] >= 1; }
+    }
+    DRV8461_CHECK(others);
+    DRV8461_CHECK(bus.readsAt[ctrl2] == 0 && bus.readsAt[ctrl11] == 0);
+
+    // Confirmation lasts one round only.
+    for (uint8_t t = 0; t < Driver::settingsRegCount / 2 + 1; t++) { verifier.tick(); }
+    DRV8461_CHECK(bus.readsAt[ctrl2] >= 1 && bus.readsAt[ctrl11] >= 1);
+
+    DRV8461MismatchEvent event = {};
+    DRV8461_CHECK(!verifier.poll(event));
+  }
+
+  // Random losses, with the application writing now and then: each loss is
+  // reported within worstCaseTicks() ticks, and nothing else is.
+  for (uint8_t budget = 1; budget <= 16; budget *= 4)
+  {
+    Driver sd;
+    CountingBus & bus = sd.driver.bus;
+    sd.applySettings();
+    Verifier verifier(sd, ticks, budget);
+    verifier.attach();
+    DRV8461MismatchEvent event = {};
+    uint16_t worst = 0;
+
+    for (uint32_t trial = 0; trial < 300; trial++)
+    {
+      // Some quiet ticks first, so the loss lands anywhere in a round.
+      for (uint32_t t = 0; t < trial % 23; t++)
+      {
+        if (t % 5 == 0) { sd.setStepMode(t % 2 ? 16 : 32); }
+        DRV8461_CHECK(verifier.tick());
+      }
+      DRV8461_CHECK(!verifier.poll(event));
+
+      bus.seed = trial + 1;
+      bus.corrupt(1 + trial % 3);
+      uint64_t lost = mismatched(sd);
+      if (!lost) { continue; }
+
+      now = 1000 * trial;
+      uint64_t reported = 0;
+      uint16_t t = 0;
+      for (; t < verifier.worstCaseTicks() && (reported & lost) != lost; t++)
+      {
+        if (t % 7 == 3) { sd.setStepMode(t % 2 ? 16 : 32); }
+        verifier.tick();
+        if (verifier.poll(event))
+        {
+          reported |= event.registers;
+          DRV8461_CHECK(event.time == now);
+        }
+      }
+      DRV8461_CHECK((reported & lost) == lost);
+      DRV8461_CHECK((reported & ~lost) == 0);
+      if (t > worst) { worst = t; }
+
+      // applySettings() sees the lost registers again in the old data.
+      sd.applySettings();
+      DRV8461_CHECK(mismatched(sd) == 0);
+      verifier.poll(event);
+    }
+    DRV8461_CHECK(worst <= verifier.worstCaseTicks());
+    DRV8461_CHECK(worst > verifier.worstCaseTicks() / 4);
+  }
+
+  // A write whose old data does not match the cache is reported at once,
+  // without a tick.
+  {
+    Driver sd;
+    CountingBus & bus = sd.driver.bus;
+    sd.applySettings();
+    Verifier verifier(sd, ticks, 2);
+    verifier.attach();
+    now = 77;
+    bus.regs[ctrl11] ^= 0x01;
+    sd.setCurrentPercent(50);
+    DRV8461MismatchEvent event = {};
+    DRV8461_CHECK(verifier.poll(event));
+    DRV8461_CHECK(event.registers == (uint64_t)1 << ctrl11 && event.time == 77);
+    DRV8461_CHECK(verifier.getReads() == 0);
+  }
+
+  // Nothing is read while a transaction is open, and the registers it
+  // changes are not taken for losses.
+  {
+    Driver sd;
+    CountingBus & bus = sd.driver.bus;
+    sd.applySettings();
+    Verifier verifier(sd, ticks, 4);
+    verifier.attach();
+
+    sd.beginTransaction();
+    sd.setStepMode(8);
+    sd.setCurrentPercent(30);
+    uint32_t frames = bus.frames;
+    for (uint8_t t = 0; t < 100; t++) { DRV8461_CHECK(verifier.tick()); }
+    DRV8461_CHECK(bus.frames == frames);
+    DRV8461_CHECK(verifier.getReads() == 0);
+    sd.commit();
+
+    for (uint8_t t = 0; t < verifier.worstCaseTicks(); t++) { DRV8461_CHECK(verifier.tick()); }
+    DRV8461MismatchEvent event = {};
+    DRV8461_CHECK(!verifier.poll(event));
+    DRV8461_CHECK(verifier.getReads() > 0);
+  }
+
+  return DRV8461_testResult();
+}
@@ -0,0 +1,118 @@
+/*  test_wavetable.cpp
+
+    The wavetable generators against golden tables (worked out independently
+    with libm), at compile time and at run time, and DRV8434S::setWavetable()
+    against DRV8461SimBus.
+
+*/
+
+#include <string.h>
+
+#include "DRV8461_SimBus.h"
+#include "DRV8461_Test.h"
+
+static bool equal(const DRV8461Wavetable & t, const uint8_t (&golden)[DRV8461_WAVETABLE_POINTS])
+{
+  return !memcmp(t.current, golden, DRV8461_WAVETABLE_POINTS);
+}
+
+static const uint8_t sine[] = { 50, 98, 142, 180, 212, 236, 250, 255 };
+static const uint8_t third8[] = { 66, 127, 176, 212, 235, 248, 253, 255 };
+static const uint8_t third10fifth5[] = { 40, 75, 104, 133, 169, 209, 242, 255 };
+static const uint8_t measured[] = { 38, 77, 117, 158, 187, 217, 236, 255 };
+
+static constexpr double points[] = { 0, 0.3, 0.62, 0.85, 1.0 };
+
+int main()
+{
+  // Compile time.
+  {
+    constexpr DRV8461Wavetable s = DRV8461_sineWavetable();
+    constexpr DRV8461Wavetable h = DRV8461_harmonicWavetable(8, 0);
+    constexpr DRV8461Wavetable hh = DRV8461_harmonicWavetable(-10, 5);
+    constexpr DRV8461Wavetable p = DRV8461_pointsWavetable(points);
+    DRV8461_CHECK(equal(s, sine));
+    DRV8461_CHECK(equal(h, third8));
+    DRV8461_CHECK(equal(hh, third10fifth5));
+    DRV8461_CHECK(equal(p, measured));
+  }
+
+  // Run time, from inputs the compiler cannot see.
+  {
+    volatile int8_t third = 8, fifth = 0;
+    DRV8461_CHECK(equal(DRV8461_harmonicWavetable(third, fifth), third8));
+    third = -10;
+    fifth = 5;
+    DRV8461_CHECK(equal(DRV8461_harmonicWavetable(third, fifth), third10fifth5));
+    double runtimePoints[5];
+    for (uint8_t i = 0; i < 5; i++) { runtimePoints[i] = *(volatile const double *)&points[i]; }
+    DRV8461_CHECK(equal(DRV8461_pointsWavetable(runtimePoints), measured));
+  }
+
+  // Entries clip to the register range.
+  {
+    static const double over[] = { -0.5, 1.5 };
+    DRV8461Wavetable t = DRV8461_pointsWavetable(over);
+    DRV8461_CHECK(t.current[0] == 0 && t.current[7] == 255);
+  }
+
+  // Upload: one batch of writes and readbacks, and only what changed.
+  {
+    BasicDRV8434S<DRV8461SimBus> sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    constexpr DRV8461Wavetable flat = DRV8461_harmonicWavetable(8, 0);
+
+    DRV8461_CHECK(sd.setWavetable(flat));
+    DRV8461_CHECK(bus.transactions == 1);
+    DRV8461_CHECK(memcmp(&bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL2], third8, 8) == 0);
+    DRV8461_CHECK(DRV8461Fields::EN_CUSTOM::get(bus.regs));
+    DRV8461_CHECK(equal(sd.getWavetable(), third8));
+
+    uint32_t frames = bus.frames;
+    DRV8461_CHECK(sd.setWavetable(flat));
+    DRV8461_CHECK(bus.frames == frames);
+
+    // Switching to a table that shares its last entry: 7 writes, 7 reads.
+    DRV8461_CHECK(sd.setWavetable(DRV8461_sineWavetable()));
+    DRV8461_CHECK(bus.transactions == 2);
+    DRV8461_CHECK(bus.frames == frames + 14);
+
+    DRV8461_CHECK(sd.setWavetable(DRV8461_sineWavetable(), false));
+    DRV8461_CHECK(!DRV8461Fields::EN_CUSTOM::get(bus.regs));
+  }
+
+  // Inside a transaction the table is only cached; commit() writes it once,
+  // with the rest of the transaction, and its readbacks all match.
+  {
+    BasicDRV8434S<DRV8461SimBus> sd;
+    DRV8461SimBus & bus = sd.driver.bus;
+    uint32_t mismatches = 0;
+    sd.setReadbackCallback([](void * context, uint8_t, bool matches) {
+      if (!matches) { (*(uint32_t *)context)++; }
+    }, &mismatches);
+
+    uint32_t frames = bus.frames;
+    sd.beginTransaction();
+    DRV8461_CHECK(sd.setWavetable(DRV8461_harmonicWavetable(8, 0)));
+    sd.setStepMode(32);
+    DRV8461_CHECK(bus.frames == frames);
+    DRV8461_CHECK(equal(sd.getWavetable(), third8));
+    sd.commit();
+    DRV8461_CHECK(bus.transactions == 1);
+    DRV8461_CHECK(bus.frames == frames + 8 + 1 + 1);
+    DRV8461_CHECK(memcmp(&bus.regs[(uint8_t)DRV8461_REG_ADDR::DRV8461_REG_CUSTOM_CTRL2], third8, 8) == 0);
+    DRV8461_CHECK(DRV8461Fields::EN_CUSTOM::get(bus.regs));
+    DRV8461_CHECK(mismatches == 0);
+    DRV8461_CHECK(sd.verifySettings());
+  }
+
+  // A failed write shows up in the readback.
+  {
+    BasicDRV8434S<DRV8461SimBus> sd;
+    sd.driver.bus.maxReliableHz = 1000000;
+    sd.driver.bus.setClock(4000000);
+    DRV8461_CHECK(!sd.setWavetable(DRV8461_harmonicWavetable(8, 0)));
+  }
+
+  return DRV8461_testResult();
+}